@@ -0,0 +1,28 @@
+/*
+ * Arquivo: arena.c
+ *
+ * Descrição: Implementação da arena de memória (ver arena.h).
+*/
+
+#include <stdint.h>
+
+#include "arena.h"
+
+void initArena (Arena *arena, void *memory, size_t size) {
+    arena->base = (uint8_t*) memory;
+    arena->size = memory != NULL ? size : 0;
+    arena->used = 0;
+}
+
+void *arenaAlloc (Arena *arena, size_t bytes) {
+    // O preenchimento é calculado sobre o endereço, pois o bloco pode não estar alinhado.
+    size_t padding = (size_t) (-(uintptr_t) (arena->base + arena->used)) & (ARENA_ALIGN - 1);
+    if (padding > arena->size - arena->used || bytes > arena->size - arena->used - padding) return NULL;
+    void *buffer = arena->base + arena->used + padding;
+    arena->used += padding + bytes;
+    return buffer;
+}
+
+size_t arenaSize (size_t bytes) {
+    return (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN + ARENA_ALIGN;
+}
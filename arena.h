@@ -0,0 +1,36 @@
+/*
+ * Arquivo: arena.h
+ *
+ * Descrição: Arena de memória: um bloco fornecido por quem chama, do qual buffers são retirados em sequência, sem
+ * nenhuma chamada a malloc. Os buffers não são liberados individualmente; o bloco inteiro pertence a quem o forneceu.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_ALIGN 64 // Alinhamento de cada buffer (uma linha de cache).
+
+typedef struct Arena {
+    uint8_t *base;  // Início do bloco.
+    size_t size;    // Tamanho do bloco, em bytes.
+    size_t used;    // Bytes já usados, incluindo o preenchimento de alinhamento.
+} Arena;
+
+/** @brief A função initArena inicia uma arena sobre o bloco de memória dado.
+  */
+void initArena (Arena *arena, void *memory, size_t size);
+
+/** @brief A função arenaAlloc retira da arena um buffer de bytes bytes, alinhado a ARENA_ALIGN.
+  * @return Retorna o buffer, ou NULL caso não haja espaço suficiente.
+  */
+void *arenaAlloc (Arena *arena, size_t bytes);
+
+/** @brief A função arenaSize retorna o espaço que arenaAlloc pode consumir para um buffer de bytes bytes, incluindo o
+  * pior caso de preenchimento de alinhamento. Somar arenaSize de todos os buffers dá um tamanho de bloco suficiente.
+  */
+size_t arenaSize (size_t bytes);
+
+#endif
@@ -0,0 +1,406 @@
+/*
+ * Arquivo: bench.c
+ *
+ * Descrição: Benchmark de cada etapa do algoritmo: leitura do PGM, histograma (completo e com a grade de passo 4),
+ * Otsu (Threshold), limiarização, erosão, dilatação, abertura, limiarização e abertura fundidas (binarizacao),
+ * rotulação, limiarização, abertura e rotulação fundidas (fundida), rotulação por sequências (ver runs.h), pintura,
+ * escrita do PGM, escrita em RLE, o preenchimento a partir do canto superior esquerdo (ver fill.h) e o processamento
+ * completo (pipelineProcess). Também são medidos o Otsu com três classes (multiThreshold) e as limiarizações locais de Bradley e
+ * Sauvola, com as configurações padrão, para comparação com histograma, otsu e limiarizacao. Cada etapa é repetida até
+ * somar o tempo mínimo, e é informada a mediana das repetições, em milissegundos, pixels por segundo e ciclos por pixel
+ * (contador de tempo do processador; disponível apenas em x86). Após as etapas, é informado o pico de uso da pilha do
+ * preenchimento (PROFILE_FILL_STACK), se a instrumentação estiver compilada.
+ *
+ * Uso: bench [-j threads] [-m milissegundos] [arquivo.pgm ...]
+ * Além dos arquivos dados, são medidas imagens sintéticas de 160x120, 640x480, 1920x1080 e 3840x2160.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#else
+#define HAVE_CYCLES 0
+#endif
+
+#include "fill.h"
+#include "image.h"
+#include "label.h"
+#include "morph.h"
+#include "parallel.h"
+#include "pgm.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "runs.h"
+#include "synthetic.h"
+#include "threshold.h"
+
+#define MAX_REPS 1000   // Máximo de repetições de uma etapa.
+#define MIN_REPS 3      // Mínimo de repetições de uma etapa.
+
+/*
+ * Estado de uma imagem durante o benchmark: os buffers de todas as etapas, criados uma única vez, de forma que apenas
+ * o processamento é medido.
+*/
+typedef struct BenchFrame {
+    const char *path;       // Arquivo PGM da imagem (para as sintéticas, um arquivo temporário).
+    Image gray;             // Imagem em tons de cinza.
+    Image decoded;          // Buffer da etapa de leitura.
+    Parallel parallel;
+    StructuringElement element;
+    Bitplane mask;
+    LabelImage labels;
+    Labeler labeler;
+    RunImage runs;
+    Filler filler;
+    Bitplane selection;     // Região da etapa de preenchimento.
+    ProfileFrame profile;   // Medidas das etapas (ver profile.h).
+    uint8_t *colors;
+    Image output;
+    int hist[256];
+    int threshold;
+    int count;
+    FILE *sink;             // Destino da etapa de escrita.
+    Pipeline pipeline;
+    void *arena;
+} BenchFrame;
+
+typedef struct Stage {
+    const char *name;
+    void (*prepare) (BenchFrame *frame);    // Executada antes de cada repetição, fora da medição (ou NULL).
+    void (*run) (BenchFrame *frame);
+} Stage;
+
+static int64_t nowNanoseconds (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t nowCycles (void) {
+#if HAVE_CYCLES
+    return (uint64_t) __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*---------------------------------------------INIT ETAPAS---------------------------------------------*/
+
+static void readStage (BenchFrame *frame) {
+    PgmMap map;
+    Image view;
+    if (mapPGM(frame->path, &map) != PGM_OK) return;
+    if (viewPGM(&map, &view) != PGM_OK) {
+        decodePGMInto(&map, &frame->decoded);
+    } else {
+        // Para medir também a passagem dos pixels pela memória, a imagem mapeada é copiada para o buffer.
+        resizeImage(&frame->decoded, view.width, view.height);
+        for (int h = 0; h < view.height; h++) memcpy(imageRow(&frame->decoded, h), imageRow(&view, h), view.width);
+    }
+    unmapPGM(&map);
+}
+
+static void histogramStage (BenchFrame *frame) {
+    parallelHistogram(&frame->parallel, &frame->gray, frame->hist);
+}
+
+static void sampledHistogramStage (BenchFrame *frame) {
+    int hist[256];
+    parallelSampledHistogram(&frame->parallel, &frame->gray, 4, hist);
+}
+
+static void otsuStage (BenchFrame *frame) {
+    frame->threshold = Threshold(frame->hist, frame->gray.width * frame->gray.height);
+}
+
+static void multiStage (BenchFrame *frame) {
+    int thresholds[THRESHOLD_MAX_CLASSES - 1];
+    multiThreshold(frame->hist, 3, thresholds);
+}
+
+static void thresholdStage (BenchFrame *frame) {
+    parallelThreshold(&frame->parallel, &frame->gray, frame->threshold, &frame->mask);
+}
+
+static void bradleyStage (BenchFrame *frame) {
+    ThresholdConfig config = defaultThresholdConfig(THRESHOLD_BRADLEY);
+    parallelLocalThreshold(&frame->parallel, &frame->gray, &config, &frame->mask);
+}
+
+static void sauvolaStage (BenchFrame *frame) {
+    ThresholdConfig config = defaultThresholdConfig(THRESHOLD_SAUVOLA);
+    parallelLocalThreshold(&frame->parallel, &frame->gray, &config, &frame->mask);
+}
+
+static void erodeStage (BenchFrame *frame) {
+    parallelMorph(&frame->parallel, &frame->mask, &frame->element, MORPH_ERODE);
+}
+
+static void dilateStage (BenchFrame *frame) {
+    parallelMorph(&frame->parallel, &frame->mask, &frame->element, MORPH_DILATE);
+}
+
+static void prepareLabels (BenchFrame *frame) {
+    // A rotulação (e, depois dela, a pintura) usa a imagem binária do algoritmo completo: limiarização e abertura.
+    parallelThreshold(&frame->parallel, &frame->gray, frame->threshold, &frame->mask);
+    parallelMorph(&frame->parallel, &frame->mask, &frame->element, MORPH_OPEN);
+}
+
+static void openStage (BenchFrame *frame) {
+    parallelMorph(&frame->parallel, &frame->mask, &frame->element, MORPH_OPEN);
+}
+
+static void binarizeStage (BenchFrame *frame) {
+    parallelBinarize(&frame->parallel, &frame->gray, frame->threshold, &frame->mask, &frame->element, MORPH_OPEN);
+}
+
+static void fusedStage (BenchFrame *frame) {
+    // Limiarização, abertura e rotulação fundidas, como em pipelineProcess; compare com a soma de limiarizacao,
+    // abertura e rotulacao.
+    parallelBinarizeLabel(&frame->parallel, &frame->labeler, &frame->gray, frame->threshold, &frame->mask,
+                          &frame->element, MORPH_OPEN, CONNECTIVITY_4, &frame->labels);
+    frame->count = parallelResolveLabels(&frame->parallel, &frame->labeler, &frame->mask, CONNECTIVITY_4,
+                                         &frame->labels, NULL);
+}
+
+static void labelStage (BenchFrame *frame) {
+    frame->count = parallelLabel(&frame->parallel, &frame->labeler, &frame->mask, CONNECTIVITY_4, &frame->labels, NULL);
+}
+
+static void runsStage (BenchFrame *frame) {
+    // Conversão da imagem binária em sequências e sua rotulação; compare com rotulacao.
+    extractRuns(&frame->mask, &frame->runs);
+    labelRuns(&frame->runs, CONNECTIVITY_4, NULL);
+}
+
+static void paintStage (BenchFrame *frame) {
+    componentColors(frame->count, frame->colors);
+    paintLabels(&frame->labels, frame->colors, &frame->output);
+}
+
+static void writeStage (BenchFrame *frame) {
+    rewind(frame->sink);
+    writePGMFrame(frame->sink, &frame->output);
+    fflush(frame->sink);
+}
+
+static void rleStage (BenchFrame *frame) {
+    rewind(frame->sink);
+    writeRLE(frame->sink, &frame->runs);
+    fflush(frame->sink);
+}
+
+static void clearSelection (BenchFrame *frame) {
+    clearBitplane(&frame->selection);
+}
+
+static void fillStage (BenchFrame *frame) {
+    // Com essa tolerância, a região a partir do canto é quase todo o fundo das imagens sintéticas.
+    FillResult result;
+    fillRegion(&frame->filler, &frame->gray, 0, 0, 64, CONNECTIVITY_4, &frame->selection, &result);
+    PROFILE_PEAK(&frame->profile, PROFILE_FILL_STACK, frame->filler.peak);
+}
+
+static void totalStage (BenchFrame *frame) {
+    PipelineResult result;
+    pipelineProcess(&frame->pipeline, &frame->gray, &result);
+}
+
+static const Stage stages[] = {
+    {"leitura", NULL, readStage},
+    {"histograma", NULL, histogramStage},
+    {"histograma/4", NULL, sampledHistogramStage},
+    {"otsu", NULL, otsuStage},
+    {"otsu3", NULL, multiStage},
+    {"limiarizacao", NULL, thresholdStage},
+    {"bradley", NULL, bradleyStage},
+    {"sauvola", NULL, sauvolaStage},
+    {"erosao", thresholdStage, erodeStage},
+    {"dilatacao", thresholdStage, dilateStage},
+    {"abertura", thresholdStage, openStage},
+    {"binarizacao", NULL, binarizeStage},
+    {"rotulacao", prepareLabels, labelStage},
+    {"fundida", NULL, fusedStage},
+    {"sequencias", prepareLabels, runsStage},
+    {"pintura", NULL, paintStage},
+    {"escrita", NULL, writeStage},
+    {"escrita rle", NULL, rleStage},
+    {"preenchimento", clearSelection, fillStage},
+    {"total", NULL, totalStage},
+};
+
+/*----------------------------------------------END ETAPAS----------------------------------------------*/
+
+static int compareInt64 (const void *a, const void *b) {
+    int64_t x = *(const int64_t*) a, y = *(const int64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/** @brief measureStage repete uma etapa até somar minNanoseconds (e ao menos MIN_REPS vezes) e imprime a mediana.
+  */
+static void measureStage (BenchFrame *frame, const char *name, const Stage *stage, int64_t minNanoseconds) {
+    static int64_t times[MAX_REPS];
+    static int64_t cycles[MAX_REPS];
+    int reps = 0;
+    int64_t spent = 0;
+    while (reps < MAX_REPS && (reps < MIN_REPS || spent < minNanoseconds)) {
+        if (stage->prepare != NULL) stage->prepare(frame);
+        uint64_t c0 = nowCycles();
+        int64_t t0 = nowNanoseconds();
+        stage->run(frame);
+        int64_t t1 = nowNanoseconds();
+        uint64_t c1 = nowCycles();
+        times[reps] = t1 - t0;
+        cycles[reps] = (int64_t) (c1 - c0);
+        spent += t1 - t0;
+        reps++;
+    }
+    qsort(times, (size_t) reps, sizeof(int64_t), compareInt64);
+    qsort(cycles, (size_t) reps, sizeof(int64_t), compareInt64);
+
+    double pixels = (double) frame->gray.width * frame->gray.height;
+    double ms = times[reps / 2] / 1e6;
+    double rate = times[reps / 2] > 0 ? pixels / (times[reps / 2] / 1e9) / 1e6 : 0;
+    printf("%-28s %-14s %6d %12.4f %12.1f", name, stage->name, reps, ms, rate);
+    if (HAVE_CYCLES) {
+        printf(" %12.3f\n", cycles[reps / 2] / pixels);
+    } else {
+        printf(" %12s\n", "-");
+    }
+}
+
+/** @brief setupFrame cria os buffers de todas as etapas para a imagem de frame->gray.
+  * @return Retorna 0 em caso de sucesso, -1 caso contrário.
+  */
+static int setupFrame (BenchFrame *frame, int threads) {
+    int width = frame->gray.width;
+    int height = frame->gray.height;
+    frame->element = crossElement();
+    if (createParallel(&frame->parallel, threads) != 0) return -1;
+    if (createBitplane(&frame->mask, width, height) != 0 || createLabelImage(&frame->labels, width, height) != 0 ||
+        createImage(&frame->output, width, height) != 0 || createRunImage(&frame->runs, width, height) != 0 ||
+        createBitplane(&frame->selection, width, height) != 0 || createFiller(&frame->filler, 0) != 0 ||
+        createLabelerWithCapacity(&frame->labeler, parallelTableSize(&frame->parallel, width, height)) != 0) {
+        return -1;
+    }
+    frame->colors = (uint8_t*) malloc(labelTableSize(width, height));
+    frame->sink = tmpfile();
+
+    PipelineConfig config = defaultPipelineConfig(width, height);
+    config.threads = threads;
+    size_t size = pipelineArenaSize(&config);
+    frame->arena = malloc(size);
+    if (frame->colors == NULL || frame->sink == NULL || frame->arena == NULL ||
+        createPipeline(&frame->pipeline, &config, frame->arena, size) != PIPELINE_OK) {
+        return -1;
+    }
+    return 0;
+}
+
+static void freeFrame (BenchFrame *frame) {
+    if (frame->arena != NULL) freePipeline(&frame->pipeline);
+    free(frame->arena);
+    if (frame->sink != NULL) fclose(frame->sink);
+    free(frame->colors);
+    freeFiller(&frame->filler);
+    freeBitplane(&frame->selection);
+    freeRunImage(&frame->runs);
+    freeLabeler(&frame->labeler);
+    freeImage(&frame->output);
+    freeLabelImage(&frame->labels);
+    freeBitplane(&frame->mask);
+    freeParallel(&frame->parallel);
+    freeImage(&frame->decoded);
+    freeImage(&frame->gray);
+}
+
+/** @brief benchFrame mede todas as etapas sobre a imagem já carregada em frame->gray.
+  */
+static int benchFrame (BenchFrame *frame, const char *name, int threads, int64_t minNanoseconds) {
+    if (setupFrame(frame, threads) != 0) {
+        fprintf(stderr, "%s: memoria insuficiente\n", name);
+        freeFrame(frame);
+        return -1;
+    }
+    int count = (int) (sizeof(stages) / sizeof(stages[0]));
+    resetProfileFrame(&frame->profile);
+    for (int i = 0; i < count; i++) measureStage(frame, name, &stages[i], minNanoseconds);
+    if (PROFILE_ENABLED) {
+        printf("%-28s %s: %llu\n", name, profileMetricName(PROFILE_FILL_STACK),
+               (unsigned long long) frame->profile.value[PROFILE_FILL_STACK]);
+    }
+    freeFrame(frame);
+    return 0;
+}
+
+int main (int argc, char *argv[]) {
+    int threads = 1;
+    int64_t minNanoseconds = 200 * 1000000LL;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-j") == 0) {
+            threads = atoi(argv[first + 1]);
+        } else if (strcmp(argv[first], "-m") == 0) {
+            minNanoseconds = atoll(argv[first + 1]) * 1000000LL;
+        } else {
+            break;
+        }
+        first += 2;
+    }
+    if (threads < 1 || minNanoseconds < 0 || (first < argc && argv[first][0] == '-')) {
+        fprintf(stderr, "Uso: %s [-j threads] [-m milissegundos] [arquivo.pgm ...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-28s %-14s %6s %12s %12s %12s\n", "imagem", "etapa", "reps", "ms", "Mpx/s", "ciclos/px");
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        BenchFrame frame;
+        memset(&frame, 0, sizeof(BenchFrame));
+        frame.path = argv[i];
+        int status = readPGM(argv[i], &frame.gray);
+        if (status != PGM_OK) {
+            fprintf(stderr, "%s: %s\n", argv[i], pgmError(status));
+            failures++;
+            continue;
+        }
+        const char *name = strrchr(argv[i], '/');
+        if (benchFrame(&frame, name != NULL ? name + 1 : argv[i], threads, minNanoseconds) != 0) failures++;
+    }
+
+    static const int sizes[][2] = {{160, 120}, {640, 480}, {1920, 1080}, {3840, 2160}};
+    for (int i = 0; i < 4; i++) {
+        BenchFrame frame;
+        memset(&frame, 0, sizeof(BenchFrame));
+        char name[64];
+        char path[] = "/tmp/bench-XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0 || createImage(&frame.gray, sizes[i][0], sizes[i][1]) != 0) {
+            fprintf(stderr, "%dx%d: falha ao criar a imagem\n", sizes[i][0], sizes[i][1]);
+            if (fd >= 0) close(fd);
+            failures++;
+            continue;
+        }
+        close(fd);
+        fillSynthetic(&frame.gray, (uint32_t) (i + 1));
+        frame.path = path;
+        snprintf(name, sizeof(name), "sintetica %dx%d", sizes[i][0], sizes[i][1]);
+        if (writePGM(path, &frame.gray) != PGM_OK) {
+            fprintf(stderr, "%s: falha ao escrever %s\n", name, path);
+            freeImage(&frame.gray);
+            failures++;
+        } else if (benchFrame(&frame, name, threads, minNanoseconds) != 0) {
+            failures++;
+        }
+        unlink(path);
+    }
+    return failures == 0 ? 0 : 1;
+}
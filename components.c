@@ -0,0 +1,90 @@
+/*
+ * Arquivo: components.c
+ *
+ * Descrição: Estatísticas de componentes conexas e sua exportação (ver components.h).
+*/
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "components.h"
+
+void resetComponentStats (ComponentStats *stats) {
+    stats->area = 0;
+    stats->minX = stats->minY = INT_MAX;
+    stats->maxX = stats->maxY = -1;
+    stats->perimeter = 0;
+    stats->sumX = stats->sumY = 0;
+    stats->sumXX = stats->sumYY = stats->sumXY = 0;
+}
+
+void mergeComponentStats (ComponentStats *into, const ComponentStats *from) {
+    into->area += from->area;
+    if (from->minX < into->minX) into->minX = from->minX;
+    if (from->minY < into->minY) into->minY = from->minY;
+    if (from->maxX > into->maxX) into->maxX = from->maxX;
+    if (from->maxY > into->maxY) into->maxY = from->maxY;
+    into->perimeter += from->perimeter;
+    into->sumX += from->sumX;
+    into->sumY += from->sumY;
+    into->sumXX += from->sumXX;
+    into->sumYY += from->sumYY;
+    into->sumXY += from->sumXY;
+}
+
+void translateComponentStats (ComponentStats *stats, int dx, int dy) {
+    if (stats->area == 0) return;
+    // As somas de x + dx são expandidas em termos das somas de x, com aritmética modular de 64 bits (exata, pois os
+    // resultados são não negativos e cabem em 64 bits).
+    uint64_t area = stats->area;
+    uint64_t ux = (uint64_t) (int64_t) dx;
+    uint64_t uy = (uint64_t) (int64_t) dy;
+    stats->minX += dx;
+    stats->maxX += dx;
+    stats->minY += dy;
+    stats->maxY += dy;
+    stats->sumXY += uy * stats->sumX + ux * stats->sumY + area * ux * uy;
+    stats->sumXX += 2 * ux * stats->sumX + area * ux * ux;
+    stats->sumYY += 2 * uy * stats->sumY + area * uy * uy;
+    stats->sumX += area * ux;
+    stats->sumY += area * uy;
+}
+
+ComponentMoments componentMoments (const ComponentStats *stats) {
+    ComponentMoments moments = {0, 0, 0, 0, 0};
+    if (stats->area == 0) return moments;
+    double area = (double) stats->area;
+    moments.centroidX = (double) stats->sumX / area;
+    moments.centroidY = (double) stats->sumY / area;
+    // Momentos centrais a partir das somas: E[x²] - E[x]², e assim por diante.
+    moments.mu20 = (double) stats->sumXX / area - moments.centroidX * moments.centroidX;
+    moments.mu02 = (double) stats->sumYY / area - moments.centroidY * moments.centroidY;
+    moments.mu11 = (double) stats->sumXY / area - moments.centroidX * moments.centroidY;
+    return moments;
+}
+
+int writeComponentsJSON (FILE *file, const ComponentStats *stats, int count) {
+    fprintf(file, "{\"count\": %d, \"components\": [", count);
+    for (int i = 1; i <= count; i++) {
+        const ComponentStats *s = &stats[i];
+        ComponentMoments m = componentMoments(s);
+        fprintf(file, "%s\n  {\"label\": %d, \"area\": %llu, \"bbox\": [%d, %d, %d, %d], \"centroid\": [%.3f, %.3f], "
+                "\"perimeter\": %llu, \"mu20\": %.3f, \"mu02\": %.3f, \"mu11\": %.3f}",
+                i > 1 ? "," : "", i, (unsigned long long) s->area, s->minX, s->minY, s->maxX, s->maxY,
+                m.centroidX, m.centroidY, (unsigned long long) s->perimeter, m.mu20, m.mu02, m.mu11);
+    }
+    fprintf(file, "%s]}\n", count > 0 ? "\n" : "");
+    return ferror(file) ? -1 : 0;
+}
+
+int writeComponentsCSV (FILE *file, const ComponentStats *stats, int count) {
+    fputs("label,area,min_x,min_y,max_x,max_y,centroid_x,centroid_y,perimeter,mu20,mu02,mu11\n", file);
+    for (int i = 1; i <= count; i++) {
+        const ComponentStats *s = &stats[i];
+        ComponentMoments m = componentMoments(s);
+        fprintf(file, "%d,%llu,%d,%d,%d,%d,%.3f,%.3f,%llu,%.3f,%.3f,%.3f\n",
+                i, (unsigned long long) s->area, s->minX, s->minY, s->maxX, s->maxY,
+                m.centroidX, m.centroidY, (unsigned long long) s->perimeter, m.mu20, m.mu02, m.mu11);
+    }
+    return ferror(file) ? -1 : 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Arquivo: components.h
+ *
+ * Descrição: Estatísticas de componentes conexas (área, retângulo envolvente, centróide, perímetro e momentos de
+ * segunda ordem), acumuladas durante a rotulação (ver label.h), e sua exportação em JSON ou CSV. Assim, quem usa o
+ * resultado não precisa varrer a imagem novamente para encontrar o tamanho e a posição de cada objeto.
+ *
+ * Coordenadas seguem a convenção da imagem: x é a coluna e y é a linha, com (0, 0) no canto superior esquerdo.
+*/
+
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Somas acumuladas de uma componente. Todos os campos são somas ou extremos, de forma que as estatísticas de duas
+ * partes de uma mesma componente podem ser combinadas com mergeComponentStats.
+*/
+typedef struct ComponentStats {
+    uint64_t area;          // Quantidade de pixels.
+    int minX, minY;         // Canto superior esquerdo do retângulo envolvente.
+    int maxX, maxY;         // Canto inferior direito do retângulo envolvente (inclusivo).
+    uint64_t perimeter;     // Quantidade de arestas entre um pixel da componente e um pixel de fundo (ou fora da imagem).
+    uint64_t sumX, sumY;    // Somas das coordenadas.
+    uint64_t sumXX, sumYY;  // Somas dos quadrados das coordenadas.
+    uint64_t sumXY;         // Soma dos produtos x * y.
+} ComponentStats;
+
+/*
+ * Medidas derivadas das somas: centróide e momentos centrais de segunda ordem, normalizados pela área (ou seja, as
+ * variâncias e a covariância das coordenadas dos pixels).
+*/
+typedef struct ComponentMoments {
+    double centroidX, centroidY;
+    double mu20;    // Variância em x.
+    double mu02;    // Variância em y.
+    double mu11;    // Covariância entre x e y.
+} ComponentMoments;
+
+/** @brief A função resetComponentStats prepara as estatísticas de uma componente ainda sem pixels.
+  */
+void resetComponentStats (ComponentStats *stats);
+
+/** @brief A função addComponentPixel acumula um pixel nas estatísticas de uma componente.
+  * @param *stats Estatísticas da componente.
+  * @param x Coluna do pixel.
+  * @param y Linha do pixel.
+  * @param exposedEdges Quantidade de vizinhos (em cima, em baixo, à esquerda e à direita) que são fundo.
+  */
+static inline void addComponentPixel (ComponentStats *stats, int x, int y, int exposedEdges) {
+    stats->area++;
+    if (x < stats->minX) stats->minX = x;
+    if (x > stats->maxX) stats->maxX = x;
+    if (y < stats->minY) stats->minY = y;
+    if (y > stats->maxY) stats->maxY = y;
+    stats->perimeter += (uint64_t) exposedEdges;
+    stats->sumX += (uint64_t) x;
+    stats->sumY += (uint64_t) y;
+    stats->sumXX += (uint64_t) x * (uint64_t) x;
+    stats->sumYY += (uint64_t) y * (uint64_t) y;
+    stats->sumXY += (uint64_t) x * (uint64_t) y;
+}
+
+/** @brief A função mergeComponentStats acumula as estatísticas de from em into.
+  */
+void mergeComponentStats (ComponentStats *into, const ComponentStats *from);
+
+/** @brief A função translateComponentStats desloca as estatísticas de uma componente de dx colunas e dy linhas (por
+  * exemplo, de uma componente rotulada em uma janela da imagem para as coordenadas da imagem inteira).
+  */
+void translateComponentStats (ComponentStats *stats, int dx, int dy);
+
+/** @brief A função componentMoments calcula o centróide e os momentos centrais de uma componente com área não nula.
+  */
+ComponentMoments componentMoments (const ComponentStats *stats);
+
+/** @brief A função writeComponentsJSON escreve as estatísticas das componentes 1 a count em JSON, no formato
+  * {"count": N, "components": [{"label": 1, "area": ..., "bbox": [minX, minY, maxX, maxY], "centroid": [x, y],
+  * "perimeter": ..., "mu20": ..., "mu02": ..., "mu11": ...}, ...]}.
+  * @param *file Arquivo de saída.
+  * @param *stats Estatísticas, indexadas pelo rótulo (a posição 0, do fundo, é ignorada).
+  * @param count Quantidade de componentes.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro de escrita.
+  */
+int writeComponentsJSON (FILE *file, const ComponentStats *stats, int count);
+
+/** @brief A função writeComponentsCSV escreve as estatísticas das componentes 1 a count em CSV, com uma linha de
+  * cabeçalho e uma linha por componente.
+  * @param *file Arquivo de saída.
+  * @param *stats Estatísticas, indexadas pelo rótulo (a posição 0, do fundo, é ignorada).
+  * @param count Quantidade de componentes.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro de escrita.
+  */
+int writeComponentsCSV (FILE *file, const ComponentStats *stats, int count);
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * Arquivo: fill.c
+ *
+ * Descrição: Preenchimento por sequências a partir de uma semente (ver fill.h).
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fill.h"
+#include "label.h"
+
+#define FILL_STACK 1024 // Entradas iniciais da pilha, quando não informadas.
+
+int createFiller (Filler *filler, size_t capacity) {
+    memset(filler, 0, sizeof(Filler));
+    if (capacity == 0) capacity = FILL_STACK;
+    filler->stack = (FillSpan*) malloc(capacity * sizeof(FillSpan));
+    if (filler->stack == NULL) return -1;
+    filler->capacity = capacity;
+    return 0;
+}
+
+void freeFiller (Filler *filler) {
+    free(filler->stack);
+    memset(filler, 0, sizeof(Filler));
+}
+
+/*
+ * Estado de um preenchimento. Um pixel está dentro da região se não está marcado e se seu valor está entre low e
+ * low + range.
+*/
+typedef struct FillState {
+    Filler *filler;
+    const Image *gray;
+    Bitplane *filled;
+    int low;
+    unsigned range;
+    int reach;          // 1 com 8-conectividade: as sequências vizinhas incluem as diagonais.
+    size_t top;         // Entradas na pilha.
+    FillResult *result;
+} FillState;
+
+static inline int inside (const FillState *state, const uint8_t *row, const uint64_t *bits, int x) {
+    return (unsigned) (row[x] - state->low) <= state->range && !((bits[x >> 6] >> (x & 63)) & 1);
+}
+
+/** @brief markSpan marca as colunas left a right de uma linha da seleção, palavra a palavra.
+  */
+static void markSpan (uint64_t *bits, int left, int right) {
+    int first = left >> 6, last = right >> 6;
+    uint64_t head = UINT64_MAX << (left & 63);
+    uint64_t tail = UINT64_MAX >> (63 - (right & 63));
+    if (first == last) {
+        bits[first] |= head & tail;
+        return;
+    }
+    bits[first] |= head;
+    for (int i = first + 1; i < last; i++) bits[i] = UINT64_MAX;
+    bits[last] |= tail;
+}
+
+/** @brief pushSpan empilha a sequência [left, right] da linha y - dy, para que seus vizinhos na linha y sejam
+  * examinados. Linhas fora da imagem são descartadas.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+static int pushSpan (FillState *state, int y, int left, int right, int dy) {
+    if (y < 0 || y >= state->gray->height) return 0;
+    Filler *filler = state->filler;
+    if (state->top == filler->capacity) {
+        size_t capacity = filler->capacity > 0 ? filler->capacity * 2 : FILL_STACK;
+        FillSpan *stack = (FillSpan*) realloc(filler->stack, capacity * sizeof(FillSpan));
+        if (stack == NULL) return -1;
+        filler->stack = stack;
+        filler->capacity = capacity;
+    }
+    FillSpan *span = &filler->stack[state->top++];
+    span->y = y;
+    span->left = left;
+    span->right = right;
+    span->dy = dy;
+    if (state->top > filler->peak) filler->peak = state->top;
+    return 0;
+}
+
+/** @brief fillSpan estende, para os dois lados, a sequência de pixels dentro da região que contém a coluna x da linha
+  * y, marca-a e empilha seus vizinhos: sempre na linha seguinte, no sentido dy, e também na linha anterior se ela
+  * ultrapassa a sequência [parentLeft, parentRight] da qual veio (as demais colunas dessa linha já foram examinadas).
+  * @return Retorna a última coluna da sequência, ou -2 caso falte memória.
+  */
+static int fillSpan (FillState *state, int x, int y, int dy, int parentLeft, int parentRight) {
+    const uint8_t *row = imageRow(state->gray, y);
+    uint64_t *bits = bitplaneRow(state->filled, y);
+    int left = x, right = x;
+    while (left > 0 && inside(state, row, bits, left - 1)) left--;
+    while (right < state->gray->width - 1 && inside(state, row, bits, right + 1)) right++;
+    markSpan(bits, left, right);
+
+    FillResult *result = state->result;
+    result->area += (uint64_t) (right - left + 1);
+    if (left < result->minX) result->minX = left;
+    if (right > result->maxX) result->maxX = right;
+    if (y < result->minY) result->minY = y;
+    if (y > result->maxY) result->maxY = y;
+
+    if (pushSpan(state, y + dy, left, right, dy) != 0) return -2;
+    if ((left < parentLeft || right > parentRight) && pushSpan(state, y - dy, left, right, -dy) != 0) return -2;
+    return right;
+}
+
+int fillRegion (Filler *filler, const Image *gray, int x, int y, int tolerance, int connectivity, Bitplane *filled,
+                FillResult *result) {
+    int width = gray->width;
+    int height = gray->height;
+    if (x < 0 || y < 0 || x >= width || y >= height || tolerance < 0 || tolerance > 255 ||
+        (connectivity != CONNECTIVITY_4 && connectivity != CONNECTIVITY_8) || filled->width != width ||
+        filled->height != height) {
+        return -1;
+    }
+    FillState state;
+    int seed = imageRow(gray, y)[x];
+    int high = seed + tolerance > 255 ? 255 : seed + tolerance;
+    state.filler = filler;
+    state.gray = gray;
+    state.filled = filled;
+    state.low = seed - tolerance < 0 ? 0 : seed - tolerance;
+    state.range = (unsigned) (high - state.low);
+    state.reach = connectivity == CONNECTIVITY_8 ? 1 : 0;
+    state.top = 0;
+    state.result = result;
+    result->area = 0;
+    result->minX = width;
+    result->minY = height;
+    result->maxX = result->maxY = -1;
+    filler->peak = 0;
+    if (!inside(&state, imageRow(gray, y), bitplaneRow(filled, y), x)) return 0;
+
+    // A sequência da semente não tem origem (o intervalo vazio), então seus vizinhos são examinados nos dois sentidos.
+    if (fillSpan(&state, x, y, 1, width, -1) == -2) return -1;
+
+    while (state.top > 0) {
+        FillSpan span = filler->stack[--state.top];
+        const uint8_t *row = imageRow(gray, span.y);
+        const uint64_t *bits = bitplaneRow(filled, span.y);
+        // Vizinhos da sequência de origem na linha span.y; com 8-conectividade, também as diagonais.
+        int from = span.left - state.reach > 0 ? span.left - state.reach : 0;
+        int to = span.right + state.reach < width - 1 ? span.right + state.reach : width - 1;
+        for (int w = from; w <= to; w++) {
+            if (!inside(&state, row, bits, w)) continue;
+            w = fillSpan(&state, w, span.y, span.dy, span.left, span.right);
+            if (w == -2) return -1;
+        }
+    }
+    return 0;
+}
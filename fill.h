@@ -0,0 +1,75 @@
+/*
+ * Arquivo: fill.h
+ *
+ * Descrição: Preenchimento a partir de um pixel semente (como o balde de tinta de um editor de imagens), por
+ * sequências horizontais (scanline): cada linha da região é preenchida de uma vez, e apenas as sequências vizinhas,
+ * nas linhas de cima e de baixo, passam pela pilha. A pilha pertence a um Filler, cresce quando necessário e é
+ * reaproveitada entre os preenchimentos, de forma que, após os primeiros, nenhuma memória é alocada, e nenhum pixel
+ * da região deixa de ser preenchido por falta de espaço.
+ *
+ * Uso típico:
+ *     Filler filler;
+ *     createFiller(&filler, 0);
+ *     clearBitplane(&selection);
+ *     fillRegion(&filler, &gray, x, y, 10, CONNECTIVITY_4, &selection, &result);
+ *     freeFiller(&filler);
+*/
+
+#ifndef FILL_H
+#define FILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/*
+ * Uma entrada da pilha: a sequência [left, right] já preenchida na linha y - dy, cujos vizinhos na linha y ainda
+ * devem ser examinados.
+*/
+typedef struct FillSpan {
+    int y;
+    int left, right;
+    int dy;         // 1 ou -1: sentido em que a região está sendo percorrida.
+} FillSpan;
+
+typedef struct Filler {
+    FillSpan *stack;    // Pilha de sequências, reaproveitada entre os preenchimentos.
+    size_t capacity;    // Posições alocadas na pilha.
+    size_t peak;        // Maior quantidade de entradas na pilha durante o último preenchimento.
+} Filler;
+
+typedef struct FillResult {
+    uint64_t area;          // Pixels preenchidos.
+    int minX, minY;         // Canto superior esquerdo do retângulo envolvente da região.
+    int maxX, maxY;         // Canto inferior direito do retângulo envolvente (inclusivo).
+} FillResult;
+
+/** @brief A função createFiller aloca a pilha de um Filler.
+  * @param capacity Entradas iniciais da pilha, ou 0 para um valor padrão. A pilha cresce se necessário.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int createFiller (Filler *filler, size_t capacity);
+
+/** @brief A função freeFiller libera a pilha de um Filler.
+  */
+void freeFiller (Filler *filler);
+
+/** @brief A função fillRegion marca em filled a região conexa que contém o pixel (x, y) e cujos pixels diferem do
+  * valor da semente em no máximo tolerance. Pixels já marcados em filled são tratados como borda, de forma que várias
+  * regiões podem ser acumuladas na mesma seleção (para uma seleção nova, filled deve ser limpo com clearBitplane).
+  * @param *gray Imagem em tons de cinza (uma imagem binária com tolerance 0 preenche uma componente).
+  * @param x Coluna da semente.
+  * @param y Linha da semente.
+  * @param tolerance Diferença máxima, de 0 a 255, entre um pixel da região e a semente.
+  * @param connectivity CONNECTIVITY_4 ou CONNECTIVITY_8 (ver label.h).
+  * @param *filled Seleção, com as mesmas dimensões de gray.
+  * @param *result Área e retângulo envolvente dos pixels marcados, retornados por referência (área 0 se a semente já
+  *        estava marcada).
+  * @return Retorna 0 em caso de sucesso, -1 caso os parâmetros sejam inválidos ou falte memória para a pilha (neste
+  *         caso, a região pode ter sido marcada apenas em parte).
+  */
+int fillRegion (Filler *filler, const Image *gray, int x, int y, int tolerance, int connectivity, Bitplane *filled,
+                FillResult *result);
+
+#endif
@@ -0,0 +1,511 @@
+/*
+ * Arquivo: golden.c
+ *
+ * Descrição: Verificação de saída (golden). Cada imagem é processada pela implementação de referência do algoritmo
+ * original (ver reference.h) e pela biblioteca (ver pipeline.h), com uma e com várias threads; o limiar, a quantidade de
+ * componentes, a cor final, o rótulo de cada pixel e a imagem pintada devem ser idênticos. Com várias threads, as
+ * estatísticas das componentes também são acumuladas, e a área de cada uma é conferida com a referência. A imagem
+ * binária também é rotulada por sequências (ver runs.h): os rótulos, as estatísticas e a imagem pintada devem ser os
+ * mesmos de labelComponents e da biblioteca, e as sequências devem sobreviver a uma ida e volta pelo formato RLE.
+ *
+ * O preenchimento por sequências (ver fill.h) é conferido com uma busca em largura, pixel a pixel, a partir de várias
+ * sementes, com várias tolerâncias, nas duas conectividades e com pixels já marcados na seleção.
+ * Sequências de quadros sintéticos, alterados por discos a cada quadro, são processadas pelo modo incremental (ver
+ * incremental.h), com os retângulos alterados e com a comparação tile a tile, e cada quadro é conferido com a
+ * biblioteca sobre o quadro inteiro: a imagem binária, a quantidade de componentes, a partição dos pixels em
+ * componentes (os rótulos estáveis são uma renumeração dos da varredura) e as estatísticas de cada componente devem ser
+ * idênticas.
+ *
+ * Uso: golden [-j threads] [arquivo.pgm ...]
+ * Além dos arquivos dados, são verificadas imagens sintéticas de 160x120, 640x480 e 1920x1080. Retorna 0 se todas as
+ * verificações passarem, 1 caso contrário.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fill.h"
+#include "image.h"
+#include "incremental.h"
+#include "pgm.h"
+#include "pipeline.h"
+#include "reference.h"
+#include "runs.h"
+#include "synthetic.h"
+
+#define INCREMENTAL_FRAMES 24   // Quadros de cada sequência do modo incremental.
+#define FILL_SEEDS 12           // Sementes de cada verificação do preenchimento.
+
+/** @brief compareResult compara o resultado da biblioteca com o da referência.
+  * @return Retorna NULL se forem idênticos, ou a descrição da primeira diferença.
+  */
+static const char *compareResult (const ReferenceResult *reference, const PipelineResult *result) {
+    if (result->threshold != reference->threshold) return "limiar";
+    if (result->components != reference->components) return "quantidade de componentes";
+    if (result->targetColor != reference->targetColor) return "cor final";
+    for (int h = 0; h < reference->height; h++) {
+        const uint32_t *labels = labelRow(result->labels, h);
+        const uint8_t *output = imageRow(result->output, h);
+        size_t offset = (size_t) h * (size_t) reference->width;
+        if (memcmp(labels, reference->labels + offset, (size_t) reference->width * sizeof(uint32_t)) != 0) {
+            return "rotulos";
+        }
+        if (memcmp(output, reference->output + offset, (size_t) reference->width) != 0) return "imagem pintada";
+    }
+    if (result->stats != NULL) {
+        uint64_t *areas = (uint64_t*) calloc((size_t) reference->components + 1, sizeof(uint64_t));
+        if (areas == NULL) return "memoria insuficiente";
+        size_t pixels = (size_t) reference->width * (size_t) reference->height;
+        for (size_t i = 0; i < pixels; i++) areas[reference->labels[i]]++;
+        int same = 1;
+        for (int i = 1; i <= reference->components; i++) same &= result->stats[i].area == areas[i];
+        free(areas);
+        if (!same) return "estatisticas";
+    }
+    return NULL;
+}
+
+/** @brief sameRuns indica se dois conjuntos de sequências rotuladas são idênticos.
+  */
+static int sameRuns (const RunImage *a, const RunImage *b) {
+    if (a->width != b->width || a->height != b->height || a->components != b->components || a->count != b->count) {
+        return 0;
+    }
+    for (int h = 0; h <= a->height; h++) {
+        if (a->rows[h] != b->rows[h]) return 0;
+    }
+    for (size_t i = 0; i < a->count; i++) {
+        const Run *x = &a->runs[i], *y = &b->runs[i];
+        if (x->x != y->x || x->length != y->length || x->label != y->label) return 0;
+    }
+    return 1;
+}
+
+/** @brief compareRuns rotula por sequências a imagem binária de um contexto e compara o resultado com o da biblioteca
+  * (rótulos e imagem pintada) e com o de labelComponents (estatísticas), e as sequências lidas de volta de um arquivo
+  * RLE temporário com as escritas.
+  * @return Retorna NULL se forem idênticos, ou a descrição da primeira diferença.
+  */
+static const char *compareRuns (const Pipeline *pipeline, const PipelineResult *result) {
+    const Bitplane *mask = &pipeline->mask;
+    int connectivity = pipeline->config.connectivity;
+    RunImage runs, copy;
+    Labeler labeler;
+    LabelImage labels;
+    Image output;
+    memset(&runs, 0, sizeof(RunImage));
+    memset(&copy, 0, sizeof(RunImage));
+    memset(&labeler, 0, sizeof(Labeler));
+    memset(&labels, 0, sizeof(LabelImage));
+    memset(&output, 0, sizeof(Image));
+    const char *error = NULL;
+    ComponentStats *stats, *expected;
+    int count = -1;
+    if (createLabeler(&labeler, mask->width, mask->height) != 0 ||
+        createLabelImage(&labels, mask->width, mask->height) != 0 ||
+        createImage(&output, mask->width, mask->height) != 0 || extractRuns(mask, &runs) != 0 ||
+        (count = labelRuns(&runs, connectivity, &stats)) < 0) {
+        error = "memoria insuficiente";
+    } else if (count != result->components) {
+        error = "sequencias: quantidade de componentes";
+    }
+
+    for (int h = 0; h < mask->height && error == NULL; h++) {
+        const uint32_t *row = labelRow(result->labels, h);
+        for (size_t i = runs.rows[h]; i < runs.rows[h + 1] && error == NULL; i++) {
+            const Run *run = &runs.runs[i];
+            for (int w = run->x; w < run->x + run->length; w++) {
+                if (row[w] != run->label) {
+                    error = "sequencias: rotulos";
+                    break;
+                }
+            }
+        }
+    }
+    if (error == NULL) {
+        paintRuns(&runs, pipeline->colors, &output);
+        for (int h = 0; h < mask->height && error == NULL; h++) {
+            if (memcmp(imageRow(&output, h), imageRow(result->output, h), (size_t) mask->width) != 0) {
+                error = "sequencias: imagem pintada";
+            }
+        }
+    }
+    if (error == NULL) {
+        if (labelComponents(&labeler, mask, connectivity, &labels, &expected) != count) {
+            error = "sequencias: quantidade de componentes";
+        } else if (memcmp(stats + 1, expected + 1, (size_t) count * sizeof(ComponentStats)) != 0) {
+            error = "sequencias: estatisticas";
+        }
+    }
+
+    if (error == NULL) {
+        FILE *file = tmpfile();
+        if (file == NULL) {
+            error = "arquivo temporario";
+        } else {
+            if (writeRLE(file, &runs) != 0 || fflush(file) != 0) {
+                error = "escrita RLE";
+            } else if ((size_t) ftell(file) != rleSize(&runs)) {
+                error = "tamanho RLE";
+            } else {
+                rewind(file);
+                if (readRLE(file, &copy) != 0) error = "leitura RLE";
+                else if (!sameRuns(&runs, &copy)) error = "ida e volta RLE";
+            }
+            fclose(file);
+        }
+    }
+    freeRunImage(&runs);
+    freeRunImage(&copy);
+    freeLabeler(&labeler);
+    freeLabelImage(&labels);
+    freeImage(&output);
+    return error;
+}
+
+/** @brief checkImage verifica uma imagem com uma thread e com threads threads.
+  * @return Retorna a quantidade de verificações que falharam.
+  */
+static int checkImage (const char *name, const Image *gray, int threads) {
+    ReferenceResult reference;
+    if (referenceAlgorithm(gray, &reference) != 0) {
+        printf("%s: memoria insuficiente para a referencia\n", name);
+        return 1;
+    }
+
+    int failures = 0;
+    int counts[2] = {1, threads};
+    for (int i = 0; i < 2; i++) {
+        if (i == 1 && threads == 1) break;
+        PipelineConfig config = defaultPipelineConfig(gray->width, gray->height);
+        config.threads = counts[i];
+        config.stats = counts[i] > 1;
+        size_t size = pipelineArenaSize(&config);
+        void *arena = malloc(size);
+        Pipeline pipeline;
+        PipelineResult result;
+        int status = arena != NULL ? createPipeline(&pipeline, &config, arena, size) : PIPELINE_ERR_ARENA;
+        const char *error = NULL;
+        if (status == PIPELINE_OK) {
+            status = pipelineProcess(&pipeline, gray, &result);
+            error = status == PIPELINE_OK ? compareResult(&reference, &result) : pipelineError(status);
+            if (error == NULL && i == 0) error = compareRuns(&pipeline, &result);
+            freePipeline(&pipeline);
+        } else {
+            error = pipelineError(status);
+        }
+        free(arena);
+
+        if (error != NULL) {
+            printf("%s, %d thread(s): DIFERENTE (%s)\n", name, counts[i], error);
+            failures++;
+        } else {
+            printf("%s, %d thread(s): ok (t = %d, connectedComps = %d, targetColor = %d)\n", name, counts[i],
+                   reference.threshold, reference.components, reference.targetColor);
+        }
+    }
+    freeReferenceResult(&reference);
+    return failures;
+}
+
+/** @brief drawDisk pinta um disco de raio r e centro (cx, cy) com o nível dado, e retorna seu retângulo envolvente.
+  */
+static DirtyRect drawDisk (Image *gray, int cx, int cy, int r, uint8_t level) {
+    for (int y = cy - r; y <= cy + r; y++) {
+        if (y < 0 || y >= gray->height) continue;
+        uint8_t *row = imageRow(gray, y);
+        for (int x = cx - r; x <= cx + r; x++) {
+            if (x >= 0 && x < gray->width && (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r) row[x] = level;
+        }
+    }
+    DirtyRect rect = {cx - r, cy - r, 2 * r + 1, 2 * r + 1};
+    return rect;
+}
+
+/** @brief referenceFill é o preenchimento mais simples possível: uma busca em largura, pixel a pixel, que marca em
+  * filled os pixels não marcados, conexos à semente e que diferem dela em no máximo tolerance.
+  * @param *queue Fila com uma posição por pixel.
+  * @return Retorna a quantidade de pixels marcados.
+  */
+static uint64_t referenceFill (const Image *gray, int x, int y, int tolerance, int connectivity, Bitplane *filled,
+                               int *queue) {
+    static const int dx[] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int dy[] = {0, 0, 1, -1, 1, -1, 1, -1};
+    int seed = imageRow(gray, y)[x];
+    if (getBit(filled, y, x)) return 0;
+    size_t head = 0, tail = 0;
+    setBit(filled, y, x);
+    queue[tail++] = y * gray->width + x;
+    while (head < tail) {
+        int px = queue[head] % gray->width, py = queue[head] / gray->width;
+        head++;
+        for (int k = 0; k < connectivity; k++) {
+            int nx = px + dx[k], ny = py + dy[k];
+            if (nx < 0 || ny < 0 || nx >= gray->width || ny >= gray->height || getBit(filled, ny, nx)) continue;
+            int value = imageRow(gray, ny)[nx];
+            if (value < seed - tolerance || value > seed + tolerance) continue;
+            setBit(filled, ny, nx);
+            queue[tail++] = ny * gray->width + nx;
+        }
+    }
+    return (uint64_t) tail;
+}
+
+/** @brief checkFill confere fillRegion com referenceFill em uma imagem: para cada conectividade e tolerância, uma
+  * coluna inteira e alguns pixels esparsos são marcados antes, e as regiões de várias sementes são acumuladas na mesma
+  * seleção, que deve ser idêntica à da referência após cada semente.
+  * @return Retorna a quantidade de verificações que falharam.
+  */
+static int checkFill (const char *name, const Image *gray) {
+    static const int tolerances[] = {0, 10, 60};
+    Filler filler;
+    Bitplane filled, expected;
+    int *queue = (int*) malloc((size_t) gray->width * (size_t) gray->height * sizeof(int));
+    if (queue == NULL || createFiller(&filler, 16) != 0) {
+        printf("%s, preenchimento: memoria insuficiente\n", name);
+        free(queue);
+        return 1;
+    }
+    if (createBitplane(&filled, gray->width, gray->height) != 0 ||
+        createBitplane(&expected, gray->width, gray->height) != 0) {
+        printf("%s, preenchimento: memoria insuficiente\n", name);
+        freeFiller(&filler);
+        free(queue);
+        return 1;
+    }
+
+    int failures = 0;
+    size_t peak = 0;
+    for (int c = 0; c < 2; c++) {
+        int connectivity = c == 0 ? CONNECTIVITY_4 : CONNECTIVITY_8;
+        for (int t = 0; t < 3; t++) {
+            uint32_t state = (uint32_t) (3 * c + t + 1);
+            clearBitplane(&filled);
+            clearBitplane(&expected);
+            for (int h = 0; h < gray->height; h++) {
+                setBit(&filled, h, gray->width / 3);
+                setBit(&expected, h, gray->width / 3);
+            }
+            for (int i = 0; i < gray->width * gray->height / 50; i++) {
+                int x = (int) (nextRandom(&state) % (uint32_t) gray->width);
+                int y = (int) (nextRandom(&state) % (uint32_t) gray->height);
+                setBit(&filled, y, x);
+                setBit(&expected, y, x);
+            }
+
+            const char *error = NULL;
+            for (int i = 0; i < FILL_SEEDS && error == NULL; i++) {
+                int x = (int) (nextRandom(&state) % (uint32_t) gray->width);
+                int y = (int) (nextRandom(&state) % (uint32_t) gray->height);
+                FillResult result;
+                uint64_t area = referenceFill(gray, x, y, tolerances[t], connectivity, &expected, queue);
+                if (fillRegion(&filler, gray, x, y, tolerances[t], connectivity, &filled, &result) != 0) {
+                    error = "falha no preenchimento";
+                } else if (result.area != area) {
+                    error = "area";
+                }
+                for (int h = 0; h < gray->height && error == NULL; h++) {
+                    if (memcmp(bitplaneRow(&filled, h), bitplaneRow(&expected, h),
+                               (size_t) filled.words * sizeof(uint64_t)) != 0) {
+                        error = "selecao";
+                    }
+                }
+                if (filler.peak > peak) peak = filler.peak;
+            }
+            if (error != NULL) {
+                printf("%s, preenchimento %d-conexo, tolerancia %d: DIFERENTE (%s)\n", name, connectivity,
+                       tolerances[t], error);
+                failures++;
+            }
+        }
+    }
+    if (failures == 0) printf("%s, preenchimento: ok (pilha de ate %zu sequencias)\n", name, peak);
+    freeBitplane(&filled);
+    freeBitplane(&expected);
+    freeFiller(&filler);
+    free(queue);
+    return failures;
+}
+
+/** @brief compareIncremental compara o resultado do modo incremental com o da biblioteca sobre o quadro inteiro. Os
+  * rótulos estáveis não seguem a ordem da varredura, então cada rótulo da referência deve corresponder a um único
+  * rótulo estável, e vice-versa.
+  * @return Retorna NULL se forem equivalentes, ou a descrição da primeira diferença.
+  */
+static const char *compareIncremental (const Incremental *incremental, const IncrementalResult *result,
+                                       const Pipeline *pipeline, const PipelineResult *reference) {
+    const Bitplane *mask = &pipeline->mask;
+    for (int h = 0; h < mask->height; h++) {
+        if (memcmp(bitplaneRow(&incremental->mask, h), bitplaneRow(mask, h), (size_t) mask->words * sizeof(uint64_t))) {
+            return "imagem binaria";
+        }
+    }
+    if (result->components != reference->components) return "quantidade de componentes";
+
+    uint32_t *forward = (uint32_t*) calloc((size_t) reference->components + 1, sizeof(uint32_t));
+    uint32_t *backward = (uint32_t*) calloc((size_t) result->maxLabel + 1, sizeof(uint32_t));
+    const char *error = NULL;
+    if (forward == NULL || backward == NULL) error = "memoria insuficiente";
+    for (int h = 0; h < mask->height && error == NULL; h++) {
+        const uint32_t *expected = labelRow(reference->labels, h);
+        const uint32_t *labels = labelRow(result->labels, h);
+        for (int w = 0; w < mask->width; w++) {
+            uint32_t a = expected[w], b = labels[w];
+            if ((a == 0) != (b == 0) || b > result->maxLabel) {
+                error = "rotulos";
+                break;
+            }
+            if (a == 0) continue;
+            if (forward[a] == 0) forward[a] = b;
+            if (backward[b] == 0) backward[b] = a;
+            if (forward[a] != b || backward[b] != a) {
+                error = "particao em componentes";
+                break;
+            }
+        }
+    }
+    for (int i = 1; i <= reference->components && error == NULL; i++) {
+        if (memcmp(&reference->stats[i], &result->stats[forward[i]], sizeof(ComponentStats)) != 0) {
+            error = "estatisticas";
+        }
+    }
+    // Os rótulos livres, sem componente, têm área 0.
+    int live = 0;
+    for (uint32_t i = 1; i <= result->maxLabel && error == NULL; i++) live += result->stats[i].area > 0;
+    if (error == NULL && live != reference->components) error = "rotulos livres";
+    free(forward);
+    free(backward);
+    return error;
+}
+
+/** @brief checkIncremental processa uma sequência de quadros pelo modo incremental e confere cada um com a biblioteca.
+  * Os quadros ímpares informam os retângulos alterados, e os pares são comparados tile a tile; o limiar global é
+  * recalculado a cada 8 quadros, de forma que a maioria dos quadros é atualizada apenas em parte.
+  * @return Retorna a quantidade de verificações que falharam (0 ou 1).
+  */
+static int checkIncremental (const char *name, const PipelineConfig *incrementalConfig, uint32_t seed) {
+    PipelineConfig config = *incrementalConfig;
+    config.threads = 1;
+    config.stats = 1;
+    Image gray;
+    Incremental incremental;
+    Pipeline pipeline;
+    size_t size = pipelineArenaSize(&config);
+    void *arena = malloc(size);
+    if (arena == NULL || createImage(&gray, config.maxWidth, config.maxHeight) != 0) {
+        printf("%s: memoria insuficiente\n", name);
+        free(arena);
+        return 1;
+    }
+    int status = createPipeline(&pipeline, &config, arena, size);
+    if (status != PIPELINE_OK || createIncremental(&incremental, &config) != 0) {
+        printf("%s: %s\n", name, status != PIPELINE_OK ? pipelineError(status) : "memoria insuficiente");
+        if (status == PIPELINE_OK) freePipeline(&pipeline);
+        freeImage(&gray);
+        free(arena);
+        return 1;
+    }
+
+    uint32_t state = seed;
+    fillSynthetic(&gray, seed);
+    const char *error = NULL;
+    int frame, partial = 0, threshold = 0;
+    for (frame = 0; frame < INCREMENTAL_FRAMES && error == NULL; frame++) {
+        DirtyRect rects[3];
+        int count = frame > 0 ? 1 + (int) (nextRandom(&state) % 3) : 0;
+        for (int i = 0; i < count; i++) {
+            int cx = (int) (nextRandom(&state) % (uint32_t) gray.width);
+            int cy = (int) (nextRandom(&state) % (uint32_t) gray.height);
+            int r = 1 + (int) (nextRandom(&state) % 24);
+            // Discos claros criam ou unem componentes; escuros apagam ou dividem.
+            uint8_t level = nextRandom(&state) % 2 ? (uint8_t) 220 : (uint8_t) 40;
+            rects[i] = drawDisk(&gray, cx, cy, r, level);
+        }
+        if (frame % 8 == 0) threshold = pipelineThreshold(&pipeline, &gray);
+
+        PipelineResult reference;
+        IncrementalResult result;
+        status = pipelineBinarize(&pipeline, &gray, threshold);
+        if (status == PIPELINE_OK) status = pipelineLabel(&pipeline, &reference);
+        if (status != PIPELINE_OK) {
+            error = pipelineError(status);
+        } else if (incrementalUpdate(&incremental, &gray, threshold, frame % 2 ? rects : NULL, count, &result) != 0) {
+            error = "falha na atualizacao";
+        } else {
+            error = compareIncremental(&incremental, &result, &pipeline, &reference);
+            partial += !result.full;
+        }
+    }
+    freeIncremental(&incremental);
+    freePipeline(&pipeline);
+    freeImage(&gray);
+    free(arena);
+
+    if (error != NULL) {
+        printf("%s: DIFERENTE (quadro %d: %s)\n", name, frame - 1, error);
+        return 1;
+    }
+    printf("%s: ok (%d quadros, %d atualizados em parte)\n", name, INCREMENTAL_FRAMES, partial);
+    return 0;
+}
+
+int main (int argc, char *argv[]) {
+    int threads = 4;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        threads = atoi(argv[2]);
+        first = 3;
+    }
+    if (threads < 1) {
+        fprintf(stderr, "Uso: %s [-j threads] [arquivo.pgm ...]\n", argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        Image gray;
+        int status = readPGM(argv[i], &gray);
+        if (status != PGM_OK) {
+            printf("%s: %s\n", argv[i], pgmError(status));
+            failures++;
+            continue;
+        }
+        failures += checkImage(argv[i], &gray, threads);
+        freeImage(&gray);
+    }
+
+    static const int sizes[][2] = {{160, 120}, {640, 480}, {1920, 1080}};
+    for (int i = 0; i < 3; i++) {
+        Image gray;
+        char name[64];
+        if (createImage(&gray, sizes[i][0], sizes[i][1]) != 0) {
+            printf("%dx%d: memoria insuficiente\n", sizes[i][0], sizes[i][1]);
+            failures++;
+            continue;
+        }
+        fillSynthetic(&gray, (uint32_t) (i + 1));
+        snprintf(name, sizeof(name), "sintetica %dx%d", sizes[i][0], sizes[i][1]);
+        failures += checkImage(name, &gray, threads);
+        if (i < 2) failures += checkFill(name, &gray);
+        freeImage(&gray);
+    }
+
+    // Limiar de Otsu com abertura e 4-conectividade (o padrão), fechamento com 8-conectividade e limiar local.
+    for (int i = 0; i < 3; i++) {
+        static const char *names[] = {"incremental, otsu", "incremental, fechamento 8-conexo", "incremental, sauvola"};
+        PipelineConfig config = defaultPipelineConfig(320, 240);
+        if (i == 1) {
+            config.connectivity = CONNECTIVITY_8;
+            config.operation = MORPH_CLOSE;
+            rectElement(5, 3, &config.element);
+        } else if (i == 2) {
+            config.thresholding = defaultThresholdConfig(THRESHOLD_SAUVOLA);
+            config.thresholding.radius = 7;
+        }
+        failures += checkIncremental(names[i], &config, (uint32_t) (i + 7));
+    }
+
+    printf("%s: %d falha(s)\n", failures == 0 ? "OK" : "FALHOU", failures);
+    return failures == 0 ? 0 : 1;
+}
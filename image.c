@@ -0,0 +1,278 @@
+/*
+ * Arquivo: image.c
+ *
+ * Descrição: Alocação e liberação dos tipos Image, LabelImage e Bitplane, histograma e limiarização (ver image.h).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image.h"
+
+/*
+ * O stride é arredondado para um múltiplo de 64 bytes, para que toda linha comece alinhada a uma linha de cache.
+*/
+#define IMAGE_STRIDE_ALIGN 64
+
+int createImage (Image *image, int width, int height) {
+    image->width = image->height = image->stride = 0;
+    image->data = NULL;
+    image->capacity = 0;
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return -1;
+
+    int stride = (width + IMAGE_STRIDE_ALIGN - 1) / IMAGE_STRIDE_ALIGN * IMAGE_STRIDE_ALIGN;
+    if ((size_t) stride > SIZE_MAX / (size_t) height) return -1; // Evita overflow no tamanho.
+
+    uint8_t *data = (uint8_t*) calloc((size_t) stride * (size_t) height, 1);
+    if (data == NULL) return -1;
+
+    image->width = width;
+    image->height = height;
+    image->stride = stride;
+    image->data = data;
+    image->capacity = (size_t) stride * (size_t) height;
+    return 0;
+}
+
+int resizeImage (Image *image, int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return -1;
+
+    int stride = (width + IMAGE_STRIDE_ALIGN - 1) / IMAGE_STRIDE_ALIGN * IMAGE_STRIDE_ALIGN;
+    if ((size_t) stride > SIZE_MAX / (size_t) height) return -1;
+
+    size_t size = (size_t) stride * (size_t) height;
+    if (size > image->capacity) {
+        // O conteúdo não precisa ser preservado, então um novo buffer evita a cópia feita por realloc.
+        uint8_t *data = (uint8_t*) malloc(size);
+        if (data == NULL) return -1;
+        free(image->data);
+        image->data = data;
+        image->capacity = size;
+    }
+    image->width = width;
+    image->height = height;
+    image->stride = stride;
+    return 0;
+}
+
+void freeImage (Image *image) {
+    free(image->data);
+    image->data = NULL;
+    image->width = image->height = image->stride = 0;
+    image->capacity = 0;
+}
+
+int createLabelImage (LabelImage *labels, int width, int height) {
+    labels->width = labels->height = labels->stride = 0;
+    labels->data = NULL;
+    labels->capacity = 0;
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return -1;
+
+    // Mesmo alinhamento, em bytes, das imagens em tons de cinza.
+    int perLine = IMAGE_STRIDE_ALIGN / (int) sizeof(uint32_t);
+    int stride = (width + perLine - 1) / perLine * perLine;
+    if ((size_t) stride > SIZE_MAX / sizeof(uint32_t) / (size_t) height) return -1;
+
+    uint32_t *data = (uint32_t*) calloc((size_t) stride * (size_t) height, sizeof(uint32_t));
+    if (data == NULL) return -1;
+
+    labels->width = width;
+    labels->height = height;
+    labels->stride = stride;
+    labels->data = data;
+    labels->capacity = (size_t) stride * (size_t) height;
+    return 0;
+}
+
+int resizeLabelImage (LabelImage *labels, int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return -1;
+
+    int perLine = IMAGE_STRIDE_ALIGN / (int) sizeof(uint32_t);
+    int stride = (width + perLine - 1) / perLine * perLine;
+    if ((size_t) stride > SIZE_MAX / sizeof(uint32_t) / (size_t) height) return -1;
+
+    size_t size = (size_t) stride * (size_t) height;
+    if (size > labels->capacity) {
+        uint32_t *data = (uint32_t*) malloc(size * sizeof(uint32_t));
+        if (data == NULL) return -1;
+        free(labels->data);
+        labels->data = data;
+        labels->capacity = size;
+    }
+    labels->width = width;
+    labels->height = height;
+    labels->stride = stride;
+    return 0;
+}
+
+void freeLabelImage (LabelImage *labels) {
+    free(labels->data);
+    labels->data = NULL;
+    labels->width = labels->height = labels->stride = 0;
+    labels->capacity = 0;
+}
+
+int createBitplane (Bitplane *plane, int width, int height) {
+    plane->width = plane->height = plane->words = 0;
+    plane->bits = NULL;
+    plane->capacity = 0;
+    if (width <= 0 || height <= 0 || width > INT32_MAX - 63) return -1;
+
+    int words = (width + 63) / 64;
+    if ((size_t) words > SIZE_MAX / sizeof(uint64_t) / (size_t) height) return -1;
+
+    uint64_t *bits = (uint64_t*) calloc((size_t) words * (size_t) height, sizeof(uint64_t));
+    if (bits == NULL) return -1;
+
+    plane->width = width;
+    plane->height = height;
+    plane->words = words;
+    plane->bits = bits;
+    plane->capacity = (size_t) words * (size_t) height;
+    return 0;
+}
+
+int resizeBitplane (Bitplane *plane, int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - 63) return -1;
+
+    int words = (width + 63) / 64;
+    if ((size_t) words > SIZE_MAX / sizeof(uint64_t) / (size_t) height) return -1;
+
+    size_t size = (size_t) words * (size_t) height;
+    if (size > plane->capacity) {
+        uint64_t *bits = (uint64_t*) malloc(size * sizeof(uint64_t));
+        if (bits == NULL) return -1;
+        free(plane->bits);
+        plane->bits = bits;
+        plane->capacity = size;
+    }
+    plane->width = width;
+    plane->height = height;
+    plane->words = words;
+    return 0;
+}
+
+void freeBitplane (Bitplane *plane) {
+    free(plane->bits);
+    plane->bits = NULL;
+    plane->width = plane->height = plane->words = 0;
+    plane->capacity = 0;
+}
+
+void clearBitplane (Bitplane *plane) {
+    memset(plane->bits, 0, (size_t) plane->words * (size_t) plane->height * sizeof(uint64_t));
+}
+
+void histogramRows (const Image *image, int rowStart, int rowEnd, int *hist) {
+    sampledHistogramRows(image, rowStart, rowEnd, 1, hist);
+}
+
+void sampledHistogramRows (const Image *image, int rowStart, int rowEnd, int step, int *hist) {
+    // Histogramas intercalados: pixels vizinhos incrementam contadores diferentes, de forma que cores repetidas (regiões
+    // uniformes) não criam uma cadeia de dependências sobre a mesma posição da memória. São somados ao final.
+    uint32_t banks[HISTOGRAM_BANKS][256];
+    memset(banks, 0, sizeof(banks));
+    int first = (rowStart + step - 1) / step * step;   // As linhas amostradas são múltiplas de step na imagem inteira.
+    for (int h = first; h < rowEnd; h += step) {
+        const uint8_t *row = imageRow(image, h);
+        int w = 0;
+        if (step == 1) {
+            // Oito pixels por leitura, como em thresholdRow, um em cada histograma.
+            for (; w + 8 <= image->width; w += 8) {
+                uint64_t x;
+                memcpy(&x, row + w, sizeof(uint64_t));
+                banks[0][x & 255]++;
+                banks[1][(x >> 8) & 255]++;
+                banks[2][(x >> 16) & 255]++;
+                banks[3][(x >> 24) & 255]++;
+                banks[4][(x >> 32) & 255]++;
+                banks[5][(x >> 40) & 255]++;
+                banks[6][(x >> 48) & 255]++;
+                banks[7][x >> 56]++;
+            }
+        }
+        for (int bank = 0; w < image->width; w += step, bank = (bank + 1) % HISTOGRAM_BANKS) {
+            banks[bank][row[w]]++;      // Incrementamos a cor do pixel atual no histograma.
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        uint32_t total = 0;
+        for (int bank = 0; bank < HISTOGRAM_BANKS; bank++) total += banks[bank][i];
+        hist[i] += (int) total;
+    }
+}
+
+void thresholdRow (const uint8_t *row, int width, int threshold, uint64_t *bits) {
+    const uint64_t high = 0x8080808080808080ull;
+    const uint64_t limit = 0x0101010101010101ull * (uint64_t) (threshold & 255);
+    int words = (width + 63) / 64;
+    for (int i = 0; i < words; i++) {
+        int end = (i + 1) * 64 < width ? 64 : width - i * 64;
+        uint64_t word = 0;
+        int b = 0;
+        if (threshold > 255) {
+            end = 0;    // Nenhum pixel atinge o limiar.
+        } else if (threshold > 0) {
+            // Oito pixels por vez: o bit mais alto de cada byte de ge indica se o pixel é maior ou igual ao limiar
+            // (comparação sem sinal byte a byte, sem vai-um entre bytes), e a multiplicação junta os oito bits.
+            for (; b + 8 <= end; b += 8) {
+                uint64_t x;
+                memcpy(&x, row + i * 64 + b, sizeof(uint64_t));
+                uint64_t d = (x | high) - (limit & ~high);
+                uint64_t ge = ((x & ~limit) | (~(x ^ limit) & d)) & high;
+                word |= (((ge >> 7) * 0x0102040810204080ull) >> 56) << b;
+            }
+        }
+        for (; b < end; b++) {
+            word |= (uint64_t) (row[i * 64 + b] >= threshold) << b;
+        }
+        bits[i] = word;
+    }
+}
+
+void thresholdRows (const Image *image, int threshold, Bitplane *mask, int rowStart, int rowEnd) {
+    for (int h = rowStart; h < rowEnd; h++) {
+        thresholdRow(imageRow(image, h), image->width, threshold, bitplaneRow(mask, h));
+    }
+}
+
+/*------------------------------------------INIT BUFFERS EXTERNOS------------------------------------------*/
+
+size_t imageBufferSize (int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return 0;
+    int stride = (width + IMAGE_STRIDE_ALIGN - 1) / IMAGE_STRIDE_ALIGN * IMAGE_STRIDE_ALIGN;
+    return (size_t) stride * (size_t) height;
+}
+
+size_t labelImageBufferSize (int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - IMAGE_STRIDE_ALIGN) return 0;
+    int perLine = IMAGE_STRIDE_ALIGN / (int) sizeof(uint32_t);
+    int stride = (width + perLine - 1) / perLine * perLine;
+    return (size_t) stride * (size_t) height * sizeof(uint32_t);
+}
+
+size_t bitplaneBufferSize (int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT32_MAX - 63) return 0;
+    return (size_t) ((width + 63) / 64) * (size_t) height * sizeof(uint64_t);
+}
+
+void attachImage (Image *image, void *buffer, size_t bytes) {
+    image->width = image->height = image->stride = 0;
+    image->data = (uint8_t*) buffer;
+    image->capacity = bytes;
+}
+
+void attachLabelImage (LabelImage *labels, void *buffer, size_t bytes) {
+    labels->width = labels->height = labels->stride = 0;
+    labels->data = (uint32_t*) buffer;
+    labels->capacity = bytes / sizeof(uint32_t);
+}
+
+void attachBitplane (Bitplane *plane, void *buffer, size_t bytes) {
+    plane->width = plane->height = plane->words = 0;
+    plane->bits = (uint64_t*) buffer;
+    plane->capacity = bytes / sizeof(uint64_t);
+}
+
+/*-------------------------------------------END BUFFERS EXTERNOS-------------------------------------------*/
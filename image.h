@@ -0,0 +1,217 @@
+/*
+ * Arquivo: image.h
+ *
+ * Descrição: Define os tipos Image e Bitplane, usados por todas as etapas do algoritmo (leitura, limiarização, erosão,
+ * dilatação e Flood Fill). Ambos guardam sua largura, altura e stride, e seus dados ficam em um único buffer alocado no
+ * heap, de forma que imagens de qualquer resolução (160x120, 640x480, 1920x1080...) possam ser processadas sem estourar
+ * a pilha.
+ *
+ * Imagens em tons de cinza (Image) usam um byte por pixel. Imagens de rótulos (LabelImage) guardam, para cada pixel,
+ * o número da componente conexa a que ele pertence (0 para o fundo). Imagens binárias, como a imagem limiarizada e a matriz de
+ * visitados, são Bitplanes: cada pixel ocupa um único bit, e cada linha é formada por palavras de 64 bits. Isso reduz
+ * em 8 vezes a memória em relação a uma imagem de bytes, e em 32 vezes em relação a uma matriz de int.
+*/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Image {
+    int width;      // Largura da imagem, em pixels.
+    int height;     // Altura da imagem, em pixels.
+    int stride;     // Distância, em bytes, entre o início de uma linha e o início da próxima (stride >= width).
+    uint8_t *data;  // Buffer único, com height * stride bytes, alocado no heap.
+    size_t capacity;// Tamanho, em bytes, do buffer alocado (0 se a imagem apenas aponta para dados de terceiros).
+} Image;
+
+typedef struct LabelImage {
+    int width;      // Largura da imagem, em pixels.
+    int height;     // Altura da imagem, em pixels.
+    int stride;     // Distância, em rótulos, entre o início de uma linha e o início da próxima (stride >= width).
+    uint32_t *data; // Buffer único, com height * stride rótulos, alocado no heap.
+    size_t capacity;// Tamanho, em rótulos, do buffer alocado.
+} LabelImage;
+
+typedef struct Bitplane {
+    int width;      // Largura da imagem, em pixels.
+    int height;     // Altura da imagem, em pixels.
+    int words;      // Quantidade de palavras de 64 bits por linha.
+    uint64_t *bits; // Buffer único, com height * words palavras. O pixel w de uma linha é o bit (w % 64) da palavra
+                    // (w / 64). Os bits após a largura da imagem, na última palavra de cada linha, são sempre 0.
+    size_t capacity;// Tamanho, em palavras, do buffer alocado.
+} Bitplane;
+
+/** @brief A função createImage aloca o buffer de uma imagem de dimensões width x height, iniciada com 0s.
+  * @param *image Ponteiro para a imagem a ser inicializada.
+  * @param width Largura da imagem.
+  * @param height Altura da imagem.
+  * @return Retorna 0 em caso de sucesso, -1 caso as dimensões sejam inválidas ou falte memória.
+  */
+int createImage (Image *image, int width, int height);
+
+/** @brief A função resizeImage muda as dimensões de uma imagem criada por createImage (ou zerada), reaproveitando
+  * o buffer se ele for grande o suficiente. Assim, processar várias imagens com a mesma estrutura só aloca memória
+  * quando aparece uma imagem maior que todas as anteriores. O conteúdo da imagem após a chamada é indefinido.
+  * @return Retorna 0 em caso de sucesso, -1 caso as dimensões sejam inválidas ou falte memória (a imagem não é
+  * alterada).
+  */
+int resizeImage (Image *image, int width, int height);
+
+/** @brief A função freeImage libera o buffer de uma imagem criada por createImage.
+  * @param *image Ponteiro para a imagem.
+  */
+void freeImage (Image *image);
+
+/** @brief A função imageRow retorna um ponteiro para o início da linha h da imagem.
+  * @param *image Ponteiro para a imagem.
+  * @param h Índice da linha.
+  */
+static inline uint8_t *imageRow (const Image *image, int h) {
+    return image->data + (size_t) h * (size_t) image->stride;
+}
+
+/** @brief A função createLabelImage aloca uma imagem de rótulos de dimensões width x height, iniciada com 0s.
+  * @param *labels Ponteiro para a imagem de rótulos a ser inicializada.
+  * @param width Largura da imagem.
+  * @param height Altura da imagem.
+  * @return Retorna 0 em caso de sucesso, -1 caso as dimensões sejam inválidas ou falte memória.
+  */
+int createLabelImage (LabelImage *labels, int width, int height);
+
+/** @brief A função resizeLabelImage é análoga à resizeImage, para imagens de rótulos.
+  */
+int resizeLabelImage (LabelImage *labels, int width, int height);
+
+/** @brief A função freeLabelImage libera o buffer de uma imagem de rótulos criada por createLabelImage.
+  * @param *labels Ponteiro para a imagem de rótulos.
+  */
+void freeLabelImage (LabelImage *labels);
+
+/** @brief A função labelRow retorna um ponteiro para o início da linha h da imagem de rótulos.
+  * @param *labels Ponteiro para a imagem de rótulos.
+  * @param h Índice da linha.
+  */
+static inline uint32_t *labelRow (const LabelImage *labels, int h) {
+    return labels->data + (size_t) h * (size_t) labels->stride;
+}
+
+/** @brief A função createBitplane aloca uma imagem binária de dimensões width x height, com todos os bits em 0.
+  * @param *plane Ponteiro para o bitplane a ser inicializado.
+  * @param width Largura da imagem.
+  * @param height Altura da imagem.
+  * @return Retorna 0 em caso de sucesso, -1 caso as dimensões sejam inválidas ou falte memória.
+  */
+int createBitplane (Bitplane *plane, int width, int height);
+
+/** @brief A função resizeBitplane é análoga à resizeImage, para bitplanes. O conteúdo após a chamada é indefinido,
+  * inclusive os bits após a largura da imagem, que devem ser zerados por quem escrever as linhas.
+  */
+int resizeBitplane (Bitplane *plane, int width, int height);
+
+/** @brief A função freeBitplane libera o buffer de um bitplane criado por createBitplane.
+  * @param *plane Ponteiro para o bitplane.
+  */
+void freeBitplane (Bitplane *plane);
+
+/** @brief A função clearBitplane atribui 0 a todos os bits de um bitplane.
+  * @param *plane Ponteiro para o bitplane.
+  */
+void clearBitplane (Bitplane *plane);
+
+/** @brief A função bitplaneRow retorna um ponteiro para a primeira palavra da linha h do bitplane.
+  * @param *plane Ponteiro para o bitplane.
+  * @param h Índice da linha.
+  */
+static inline uint64_t *bitplaneRow (const Bitplane *plane, int h) {
+    return plane->bits + (size_t) h * (size_t) plane->words;
+}
+
+/** @brief A função getBit retorna o valor (0 ou 1) do pixel (h, w) de um bitplane.
+  */
+static inline int getBit (const Bitplane *plane, int h, int w) {
+    return (int) ((bitplaneRow(plane, h)[w >> 6] >> (w & 63)) & 1u);
+}
+
+/** @brief A função setBit atribui 1 ao pixel (h, w) de um bitplane.
+  */
+static inline void setBit (Bitplane *plane, int h, int w) {
+    bitplaneRow(plane, h)[w >> 6] |= (uint64_t) 1 << (w & 63);
+}
+
+/** @brief A função clearBit atribui 0 ao pixel (h, w) de um bitplane.
+  */
+static inline void clearBit (Bitplane *plane, int h, int w) {
+    bitplaneRow(plane, h)[w >> 6] &= ~((uint64_t) 1 << (w & 63));
+}
+
+/*
+ * Buffers externos: as imagens também podem usar buffers fornecidos por quem chama (por exemplo, de uma arena). Após
+ * attachImage, attachLabelImage ou attachBitplane, as dimensões são definidas com resizeImage, resizeLabelImage ou
+ * resizeBitplane, que não alocam memória enquanto o buffer for grande o suficiente. Essas imagens não devem ser
+ * passadas às funções free*, nem redimensionadas além do tamanho do buffer.
+*/
+
+/** @brief A função imageBufferSize retorna o tamanho, em bytes, do buffer de uma imagem de width x height pixels
+  * (0 se as dimensões forem inválidas).
+  */
+size_t imageBufferSize (int width, int height);
+
+/** @brief A função labelImageBufferSize é análoga à imageBufferSize, para imagens de rótulos.
+  */
+size_t labelImageBufferSize (int width, int height);
+
+/** @brief A função bitplaneBufferSize é análoga à imageBufferSize, para bitplanes.
+  */
+size_t bitplaneBufferSize (int width, int height);
+
+/** @brief A função attachImage inicia uma imagem vazia (0 x 0) sobre um buffer externo de bytes bytes.
+  */
+void attachImage (Image *image, void *buffer, size_t bytes);
+
+/** @brief A função attachLabelImage inicia uma imagem de rótulos vazia sobre um buffer externo de bytes bytes.
+  */
+void attachLabelImage (LabelImage *labels, void *buffer, size_t bytes);
+
+/** @brief A função attachBitplane inicia um bitplane vazio sobre um buffer externo de bytes bytes.
+  */
+void attachBitplane (Bitplane *plane, void *buffer, size_t bytes);
+
+/** @brief A função histogramRows soma ao histograma as cores dos pixels das linhas rowStart a rowEnd - 1.
+  * @param *image Imagem em tons de cinza.
+  * @param rowStart Primeira linha.
+  * @param rowEnd Linha seguinte à última.
+  * @param *hist Histograma com 256 posições, que não é zerado pela função.
+  */
+void histogramRows (const Image *image, int rowStart, int rowEnd, int *hist);
+
+#define HISTOGRAM_BANKS 8   // Histogramas intercalados usados por sampledHistogramRows.
+
+/** @brief A função sampledHistogramRows é análoga à histogramRows, contando apenas os pixels de uma grade: as linhas e
+  * colunas múltiplas de step. Para imagens grandes, o histograma amostrado dá um limiar aproximado a uma fração do
+  * custo. Com step = 1, conta todos os pixels (é o que histogramRows faz).
+  * @param step Passo da grade, no mínimo 1.
+  */
+void sampledHistogramRows (const Image *image, int rowStart, int rowEnd, int step, int *hist);
+
+/** @brief A função thresholdRow gera uma linha da imagem binária a partir de uma linha da imagem em tons de cinza:
+  * pixels maiores ou iguais ao limiar são brancos (1); os demais, pretos (0).
+  * @param *row Linha da imagem em tons de cinza.
+  * @param width Largura da linha, em pixels.
+  * @param threshold Limiar.
+  * @param *bits Linha de saída, com (width + 63) / 64 palavras.
+  */
+void thresholdRow (const uint8_t *row, int width, int threshold, uint64_t *bits);
+
+/** @brief A função thresholdRows gera as linhas rowStart a rowEnd - 1 da imagem binária: pixels maiores ou iguais ao
+  * limiar são brancos (1); os demais, pretos (0).
+  * @param *image Imagem em tons de cinza.
+  * @param threshold Limiar.
+  * @param *mask Imagem binária, com as mesmas dimensões da imagem.
+  * @param rowStart Primeira linha.
+  * @param rowEnd Linha seguinte à última.
+  */
+void thresholdRows (const Image *image, int threshold, Bitplane *mask, int rowStart, int rowEnd);
+
+#endif
@@ -0,0 +1,445 @@
+/*
+ * Arquivo: incremental.c
+ *
+ * Descrição: Processamento incremental de quadros consecutivos (ver incremental.h).
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "incremental.h"
+#include "morph.h"
+#include "threshold.h"
+
+// Estados de um tile.
+#define TILE_DIRTY  1   // Pixels em tons de cinza alterados desde o quadro anterior.
+#define TILE_REGION 2   // Imagem binária e rótulos recalculados: os tiles alterados e os vizinhos alcançados por eles.
+
+static int tileCount (int pixels) {
+    return (pixels + INCREMENTAL_TILE - 1) / INCREMENTAL_TILE;
+}
+
+/** @brief reachOf retorna a distância, em pixels, que a mudança de um pixel em tons de cinza alcança na imagem
+  * binária: o alcance vertical e horizontal da operação morfológica, somado ao raio das janelas da limiarização local.
+  * @return Retorna o alcance, ou -1 caso a operação seja inválida.
+  */
+static int reachOf (const PipelineConfig *config) {
+    int above, below;
+    if (morphHalo(&config->element, config->operation, &above, &below) != 0) return -1;
+    int side = 0;
+    for (int i = 0; i < config->element.rows; i++) {
+        const MorphSpan *span = &config->element.spans[i];
+        if (span->left > side) side = span->left;
+        if (span->right > side) side = span->right;
+    }
+    if (config->operation == MORPH_OPEN || config->operation == MORPH_CLOSE) side *= 2;
+    int reach = above > below ? above : below;
+    if (side > reach) reach = side;
+    if (isLocalThreshold(config->thresholding.method)) reach += config->thresholding.radius;
+    return reach;
+}
+
+int createIncremental (Incremental *incremental, const PipelineConfig *config) {
+    memset(incremental, 0, sizeof(Incremental));
+    incremental->config = *config;
+    int width = config->maxWidth;
+    int height = config->maxHeight;
+    if (width <= 0 || height <= 0 || !validThresholdConfig(&config->thresholding)) return -1;
+    if (config->connectivity != CONNECTIVITY_4 && config->connectivity != CONNECTIVITY_8) return -1;
+    incremental->margin = reachOf(config);
+    if (incremental->margin < 0) return -1;
+
+    size_t tiles = (size_t) tileCount(width) * (size_t) tileCount(height);
+    size_t capacity = labelTableSize(width, height);
+    size_t scratch = morphScratchWords(&config->element, config->operation, (width + 63) / 64) + 1;
+    incremental->capacity = capacity;
+    incremental->tiles = (uint8_t*) calloc(tiles, 1);
+    incremental->runs = (DirtyRect*) malloc(tiles * sizeof(DirtyRect));
+    incremental->stats = (ComponentStats*) malloc(capacity * sizeof(ComponentStats));
+    incremental->freeLabels = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+    incremental->marks = (uint8_t*) calloc(capacity, 1);
+    incremental->affected = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+    incremental->map = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+    incremental->scratch = (uint64_t*) malloc(scratch * sizeof(uint64_t));
+    if (isLocalThreshold(config->thresholding.method)) {
+        incremental->window = (uint32_t*) malloc(localThresholdWords(width) * sizeof(uint32_t));
+        if (incremental->window == NULL) {
+            freeIncremental(incremental);
+            return -1;
+        }
+    }
+    if (incremental->tiles == NULL || incremental->runs == NULL || incremental->stats == NULL ||
+        incremental->freeLabels == NULL || incremental->marks == NULL || incremental->affected == NULL ||
+        incremental->map == NULL || incremental->scratch == NULL ||
+        createImage(&incremental->previous, width, height) != 0 ||
+        createBitplane(&incremental->mask, width, height) != 0 ||
+        createLabelImage(&incremental->labels, width, height) != 0 ||
+        createBitplane(&incremental->region, width, height) != 0 ||
+        createLabelImage(&incremental->regionLabels, width, height) != 0 ||
+        createLabeler(&incremental->labeler, width, height) != 0) {
+        freeIncremental(incremental);
+        return -1;
+    }
+    return 0;
+}
+
+void freeIncremental (Incremental *incremental) {
+    freeLabeler(&incremental->labeler);
+    freeLabelImage(&incremental->regionLabels);
+    freeBitplane(&incremental->region);
+    freeLabelImage(&incremental->labels);
+    freeBitplane(&incremental->mask);
+    freeImage(&incremental->previous);
+    free(incremental->window);
+    free(incremental->scratch);
+    free(incremental->map);
+    free(incremental->affected);
+    free(incremental->marks);
+    free(incremental->freeLabels);
+    free(incremental->stats);
+    free(incremental->runs);
+    free(incremental->tiles);
+    memset(incremental, 0, sizeof(Incremental));
+}
+
+void resetIncremental (Incremental *incremental) {
+    incremental->valid = 0;
+}
+
+/** @brief binarize limiariza uma imagem (ou uma janela de uma imagem) e aplica a operação morfológica.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro.
+  */
+static int binarize (Incremental *incremental, const Image *gray, int threshold, Bitplane *mask) {
+    const PipelineConfig *config = &incremental->config;
+    if (isLocalThreshold(config->thresholding.method)) {
+        if (localThresholdRows(gray, &config->thresholding, mask, 0, gray->height, incremental->window) != 0) {
+            return -1;
+        }
+        return morphStrip(mask, &config->element, config->operation, 0, mask->height, NULL, NULL,
+                          incremental->scratch);
+    }
+    return morphThresholdStrip(gray, threshold, mask, &config->element, config->operation, 0, gray->height,
+                               incremental->scratch, NULL, NULL);
+}
+
+/*--------------------------------------------INIT QUADRO INTEIRO--------------------------------------------*/
+
+/** @brief updateFull processa o quadro por inteiro, como pipelineProcess, e descarta os rótulos anteriores.
+  * @return Retorna a quantidade de tiles, ou -1 em caso de erro.
+  */
+static int updateFull (Incremental *incremental, const Image *gray, int threshold) {
+    int width = gray->width;
+    int height = gray->height;
+    if (resizeImage(&incremental->previous, width, height) != 0 ||
+        resizeBitplane(&incremental->mask, width, height) != 0 ||
+        resizeLabelImage(&incremental->labels, width, height) != 0) {
+        return -1;
+    }
+    for (int h = 0; h < height; h++) memcpy(imageRow(&incremental->previous, h), imageRow(gray, h), (size_t) width);
+    incremental->tilesX = tileCount(width);
+    incremental->tilesY = tileCount(height);
+
+    PROFILE_START(start);
+    int status = binarize(incremental, gray, threshold, &incremental->mask);
+    PROFILE_STOP(&incremental->profile, PROFILE_BINARIZE, start);
+    if (status != 0) return -1;
+
+    PROFILE_START(label);
+    ComponentStats *stats;
+    int count = labelComponents(&incremental->labeler, &incremental->mask, incremental->config.connectivity,
+                                &incremental->labels, &stats);
+    if (count < 0) return -1;
+    memcpy(incremental->stats + 1, stats + 1, (size_t) count * sizeof(ComponentStats));
+    incremental->maxLabel = (uint32_t) count;
+    incremental->components = count;
+    incremental->freeCount = 0;
+    PROFILE_STOP(&incremental->profile, PROFILE_LABEL, label);
+    return incremental->tilesX * incremental->tilesY;
+}
+
+/*---------------------------------------------END QUADRO INTEIRO---------------------------------------------*/
+
+/*----------------------------------------------INIT TILES----------------------------------------------*/
+
+/** @brief markRects marca como alterados os tiles que tocam os retângulos dados.
+  */
+static void markRects (Incremental *incremental, const Image *gray, const DirtyRect *rects, int count) {
+    for (int i = 0; i < count; i++) {
+        int x0 = rects[i].x > 0 ? rects[i].x : 0;
+        int y0 = rects[i].y > 0 ? rects[i].y : 0;
+        int x1 = rects[i].x + rects[i].width < gray->width ? rects[i].x + rects[i].width : gray->width;
+        int y1 = rects[i].y + rects[i].height < gray->height ? rects[i].y + rects[i].height : gray->height;
+        if (x0 >= x1 || y0 >= y1) continue;
+        for (int ty = y0 / INCREMENTAL_TILE; ty <= (y1 - 1) / INCREMENTAL_TILE; ty++) {
+            for (int tx = x0 / INCREMENTAL_TILE; tx <= (x1 - 1) / INCREMENTAL_TILE; tx++) {
+                incremental->tiles[ty * incremental->tilesX + tx] |= TILE_DIRTY;
+            }
+        }
+    }
+}
+
+/** @brief diffTiles marca como alterados os tiles com algum pixel diferente do quadro anterior. A imagem é percorrida
+  * linha a linha, e cada tile deixa de ser comparado assim que uma diferença é encontrada.
+  */
+static void diffTiles (Incremental *incremental, const Image *gray) {
+    for (int h = 0; h < gray->height; h++) {
+        uint8_t *tiles = incremental->tiles + (h / INCREMENTAL_TILE) * incremental->tilesX;
+        const uint8_t *row = imageRow(gray, h);
+        const uint8_t *previous = imageRow(&incremental->previous, h);
+        for (int tx = 0; tx < incremental->tilesX; tx++) {
+            if (tiles[tx] & TILE_DIRTY) continue;
+            int x = tx * INCREMENTAL_TILE;
+            int columns = gray->width - x < INCREMENTAL_TILE ? gray->width - x : INCREMENTAL_TILE;
+            if (memcmp(row + x, previous + x, (size_t) columns) != 0) tiles[tx] |= TILE_DIRTY;
+        }
+    }
+}
+
+/** @brief markRegion copia os tiles alterados para o quadro anterior e marca como recalculados os tiles a até
+  * margin pixels deles, agrupando-os em sequências horizontais (runs).
+  * @return Retorna a quantidade de tiles recalculados.
+  */
+static int markRegion (Incremental *incremental, const Image *gray) {
+    int tilesX = incremental->tilesX;
+    int tilesY = incremental->tilesY;
+    int spread = (incremental->margin + INCREMENTAL_TILE - 1) / INCREMENTAL_TILE;
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (!(incremental->tiles[ty * tilesX + tx] & TILE_DIRTY)) continue;
+            int x = tx * INCREMENTAL_TILE;
+            int columns = gray->width - x < INCREMENTAL_TILE ? gray->width - x : INCREMENTAL_TILE;
+            int rowEnd = (ty + 1) * INCREMENTAL_TILE < gray->height ? (ty + 1) * INCREMENTAL_TILE : gray->height;
+            for (int h = ty * INCREMENTAL_TILE; h < rowEnd; h++) {
+                memcpy(imageRow(&incremental->previous, h) + x, imageRow(gray, h) + x, (size_t) columns);
+            }
+            for (int ny = ty - spread; ny <= ty + spread; ny++) {
+                for (int nx = tx - spread; nx <= tx + spread; nx++) {
+                    if (ny >= 0 && ny < tilesY && nx >= 0 && nx < tilesX) {
+                        incremental->tiles[ny * tilesX + nx] |= TILE_REGION;
+                    }
+                }
+            }
+        }
+    }
+
+    int tiles = 0;
+    incremental->runCount = 0;
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; ) {
+            if (!(incremental->tiles[ty * tilesX + tx] & TILE_REGION)) {
+                tx++;
+                continue;
+            }
+            int end = tx;
+            while (end < tilesX && (incremental->tiles[ty * tilesX + end] & TILE_REGION)) end++;
+            DirtyRect *run = &incremental->runs[incremental->runCount++];
+            run->x = tx * INCREMENTAL_TILE;
+            run->y = ty * INCREMENTAL_TILE;
+            run->width = (end * INCREMENTAL_TILE < gray->width ? end * INCREMENTAL_TILE : gray->width) - run->x;
+            run->height = ((ty + 1) * INCREMENTAL_TILE < gray->height ? (ty + 1) * INCREMENTAL_TILE : gray->height) -
+                          run->y;
+            tiles += end - tx;
+            tx = end;
+        }
+    }
+    return tiles;
+}
+
+/** @brief binarizeRun recalcula a imagem binária de uma sequência de tiles. A janela processada inclui margin linhas
+  * acima e abaixo e margin colunas (arredondadas para palavras) de cada lado, de forma que os pixels da sequência são
+  * idênticos aos do processamento do quadro inteiro, e são copiados palavra a palavra.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro.
+  */
+static int binarizeRun (Incremental *incremental, const Image *gray, int threshold, const DirtyRect *run) {
+    int margin = incremental->margin;
+    int side = (margin + 63) / 64 * 64;
+    int x0 = run->x - side > 0 ? run->x - side : 0;
+    int x1 = run->x + run->width + side < gray->width ? run->x + run->width + side : gray->width;
+    int y0 = run->y - margin > 0 ? run->y - margin : 0;
+    int y1 = run->y + run->height + margin < gray->height ? run->y + run->height + margin : gray->height;
+    Image view = {x1 - x0, y1 - y0, gray->stride, imageRow(gray, y0) + x0, 0};
+    if (resizeBitplane(&incremental->region, view.width, view.height) != 0) return -1;
+    if (binarize(incremental, &view, threshold, &incremental->region) != 0) return -1;
+
+    int words = (run->width + 63) / 64;
+    for (int h = run->y; h < run->y + run->height; h++) {
+        memcpy(bitplaneRow(&incremental->mask, h) + run->x / 64,
+               bitplaneRow(&incremental->region, h - y0) + (run->x - x0) / 64, (size_t) words * sizeof(uint64_t));
+    }
+    return 0;
+}
+
+/*
+ * Rotulação dos tiles recalculados. As componentes afetadas são as que têm algum pixel nos tiles recalculados ou
+ * vizinho a eles: fora desses tiles a imagem binária não muda, então qualquer outra componente continua igual. Os
+ * pixels a rotular novamente são os da imagem binária nos tiles recalculados e os das componentes afetadas fora
+ * deles; nenhum outro pixel de foreground é vizinho desses, então eles são rotulados sozinhos, em uma janela que
+ * contém todos eles. As estatísticas de cada componente da janela (inclusive o perímetro, pois os vizinhos de fora da
+ * janela são fundo) são deslocadas para as coordenadas da imagem.
+*/
+
+/** @brief relabel rotula novamente as componentes afetadas pelos tiles recalculados.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro.
+  */
+static int relabel (Incremental *incremental) {
+    LabelImage *labels = &incremental->labels;
+    ComponentStats *stats = incremental->stats;
+    uint8_t *marks = incremental->marks;
+    int width = labels->width;
+    int height = labels->height;
+    int tilesX = incremental->tilesX;
+
+    // Componentes afetadas e a janela que as contém.
+    size_t affected = 0;
+    int x0 = width, y0 = height, x1 = 0, y1 = 0;
+    for (int i = 0; i < incremental->runCount; i++) {
+        const DirtyRect *run = &incremental->runs[i];
+        int left = run->x > 0 ? run->x - 1 : 0;
+        int top = run->y > 0 ? run->y - 1 : 0;
+        int right = run->x + run->width < width ? run->x + run->width + 1 : width;
+        int bottom = run->y + run->height < height ? run->y + run->height + 1 : height;
+        if (left < x0) x0 = left;
+        if (top < y0) y0 = top;
+        if (right > x1) x1 = right;
+        if (bottom > y1) y1 = bottom;
+        for (int h = top; h < bottom; h++) {
+            const uint32_t *row = labelRow(labels, h);
+            for (int w = left; w < right; w++) {
+                uint32_t label = row[w];
+                if (label != 0 && !marks[label]) {
+                    marks[label] = 1;
+                    incremental->affected[affected++] = label;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < affected; i++) {
+        const ComponentStats *s = &stats[incremental->affected[i]];
+        if (s->minX < x0) x0 = s->minX;
+        if (s->minY < y0) y0 = s->minY;
+        if (s->maxX + 1 > x1) x1 = s->maxX + 1;
+        if (s->maxY + 1 > y1) y1 = s->maxY + 1;
+    }
+    x0 = x0 / 64 * 64;  // A janela começa em uma palavra, para que suas linhas sejam copiadas palavra a palavra.
+
+    // Pixels a rotular: a imagem binária nos tiles recalculados e os pixels das componentes afetadas nos demais.
+    Bitplane *region = &incremental->region;
+    if (resizeBitplane(region, x1 - x0, y1 - y0) != 0 ||
+        resizeLabelImage(&incremental->regionLabels, x1 - x0, y1 - y0) != 0) {
+        return -1;
+    }
+    int tail = (x1 - x0) % 64;
+    for (int h = y0; h < y1; h++) {
+        const uint64_t *src = bitplaneRow(&incremental->mask, h) + x0 / 64;
+        const uint32_t *row = labelRow(labels, h);
+        const uint8_t *tiles = incremental->tiles + (h / INCREMENTAL_TILE) * tilesX + x0 / 64;
+        uint64_t *dst = bitplaneRow(region, h - y0);
+        for (int i = 0; i < region->words; i++) {
+            uint64_t word = src[i];
+            if (!(tiles[i] & TILE_REGION) && word != 0) {
+                uint64_t kept = 0;
+                for (uint64_t bits = word; bits != 0; bits &= bits - 1) {
+                    int b = __builtin_ctzll(bits);
+                    if (marks[row[x0 + i * 64 + b]]) kept |= (uint64_t) 1 << b;
+                }
+                word = kept;
+            }
+            if (i == region->words - 1 && tail != 0) word &= ((uint64_t) 1 << tail) - 1;
+            dst[i] = word;
+        }
+    }
+    ComponentStats *found;
+    int count = labelComponents(&incremental->labeler, region, incremental->config.connectivity,
+                                &incremental->regionLabels, &found);
+    if (count < 0) return -1;
+
+    // Os rótulos das componentes afetadas são liberados, em ordem inversa, para que as componentes da janela os
+    // recebam na ordem em que foram encontrados (uma componente que apenas mudou de forma mantém o seu).
+    for (size_t i = affected; i > 0; i--) {
+        uint32_t label = incremental->affected[i - 1];
+        marks[label] = 0;
+        stats[label].area = 0;
+        incremental->freeLabels[incremental->freeCount++] = label;
+    }
+    incremental->components -= (int) affected;
+    uint32_t *map = incremental->map;
+    map[0] = 0;
+    for (int k = 1; k <= count; k++) {
+        uint32_t label = incremental->freeCount > 0 ? incremental->freeLabels[--incremental->freeCount]
+                                                    : ++incremental->maxLabel;
+        map[k] = label;
+        stats[label] = found[k];
+        translateComponentStats(&stats[label], x0, y0);
+    }
+    incremental->components += count;
+
+    for (int h = y0; h < y1; h++) {
+        uint32_t *row = labelRow(labels, h);
+        const uint32_t *sub = labelRow(&incremental->regionLabels, h - y0);
+        const uint8_t *tiles = incremental->tiles + (h / INCREMENTAL_TILE) * tilesX;
+        for (int w = x0; w < x1; w++) {
+            uint32_t label = sub[w - x0];
+            if (label != 0) {
+                row[w] = map[label];
+            } else if (tiles[w / INCREMENTAL_TILE] & TILE_REGION) {
+                row[w] = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @brief updateTiles processa apenas os tiles alterados e seus vizinhos.
+  * @return Retorna a quantidade de tiles recalculados, ou -1 em caso de erro.
+  */
+static int updateTiles (Incremental *incremental, const Image *gray, int threshold, const DirtyRect *rects,
+                        int count) {
+    PROFILE_START(start);
+    memset(incremental->tiles, 0, (size_t) incremental->tilesX * (size_t) incremental->tilesY);
+    if (rects != NULL) {
+        markRects(incremental, gray, rects, count);
+    } else {
+        diffTiles(incremental, gray);
+    }
+    int tiles = markRegion(incremental, gray);
+    for (int i = 0; i < incremental->runCount; i++) {
+        if (binarizeRun(incremental, gray, threshold, &incremental->runs[i]) != 0) return -1;
+    }
+    PROFILE_STOP(&incremental->profile, PROFILE_BINARIZE, start);
+    if (tiles == 0) return 0;
+
+    PROFILE_START(label);
+    if (relabel(incremental) != 0) return -1;
+    PROFILE_STOP(&incremental->profile, PROFILE_LABEL, label);
+    return tiles;
+}
+
+/*-----------------------------------------------END TILES-----------------------------------------------*/
+
+int incrementalUpdate (Incremental *incremental, const Image *gray, int threshold, const DirtyRect *rects, int count,
+                       IncrementalResult *result) {
+    resetProfileFrame(&incremental->profile);
+    const PipelineConfig *config = &incremental->config;
+    if (gray->width <= 0 || gray->height <= 0 || gray->width > config->maxWidth || gray->height > config->maxHeight) {
+        incremental->valid = 0;
+        return -1;
+    }
+    int local = isLocalThreshold(config->thresholding.method);
+    int full = !incremental->valid || gray->width != incremental->mask.width ||
+               gray->height != incremental->mask.height || (!local && threshold != incremental->threshold);
+    // O estado só volta a valer se o quadro for processado sem erros.
+    incremental->valid = 0;
+    int tiles = full ? updateFull(incremental, gray, threshold) : updateTiles(incremental, gray, threshold, rects, count);
+    if (tiles < 0) return -1;
+    incremental->valid = 1;
+    incremental->threshold = threshold;
+    PROFILE_ADD(&incremental->profile, PROFILE_TILES, tiles);
+
+    result->components = incremental->components;
+    result->maxLabel = incremental->maxLabel;
+    result->tiles = tiles;
+    result->full = full;
+    result->labels = &incremental->labels;
+    result->stats = incremental->stats;
+    return 0;
+}
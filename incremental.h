@@ -0,0 +1,107 @@
+/*
+ * Arquivo: incremental.h
+ *
+ * Descrição: Processamento incremental de quadros consecutivos de um vídeo. Quando apenas pequenas regiões mudam de
+ * um quadro para o seguinte, a limiarização, a operação morfológica e a rotulação são refeitas apenas nos tiles
+ * (blocos de INCREMENTAL_TILE x INCREMENTAL_TILE pixels) alterados e nos vizinhos alcançados por eles. Os tiles
+ * alterados são dados por quem chama, como uma lista de retângulos, ou encontrados comparando cada tile com o do
+ * quadro anterior.
+ *
+ * Os rótulos são estáveis: uma componente que não toca os tiles recalculados mantém seu rótulo e suas estatísticas,
+ * sem que seus pixels sejam lidos. As componentes que tocam esses tiles são rotuladas novamente dentro de uma janela
+ * que as contém, e recebem os rótulos liberados (ou novos). Por isso, ao contrário de labelComponents, os rótulos não
+ * seguem a ordem da varredura e podem ter lacunas. No primeiro quadro, e sempre que o limiar global muda, tudo é
+ * recalculado, e os rótulos são os de labelComponents.
+*/
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "components.h"
+#include "image.h"
+#include "label.h"
+#include "pipeline.h"
+#include "profile.h"
+
+#define INCREMENTAL_TILE 64 // Lado de um tile, em pixels (uma palavra de cada linha do bitplane).
+
+/*
+ * Retângulo alterado de um quadro, em pixels. É cortado nas bordas da imagem.
+*/
+typedef struct DirtyRect {
+    int x, y;
+    int width, height;
+} DirtyRect;
+
+typedef struct IncrementalResult {
+    int components;                 // Quantidade de componentes conexas.
+    uint32_t maxLabel;              // Maior rótulo em uso; rótulos sem componente têm área 0 em stats.
+    int tiles;                      // Tiles recalculados.
+    int full;                       // 1 se o quadro foi processado por inteiro.
+    const LabelImage *labels;       // Rótulo de cada pixel.
+    const ComponentStats *stats;    // Estatísticas de cada rótulo, de 1 a maxLabel.
+} IncrementalResult;
+
+typedef struct Incremental {
+    PipelineConfig config;          // Limiarização, operação morfológica, conectividade e dimensões máximas.
+    int margin;                     // Distância, em pixels, que uma mudança em tons de cinza alcança na imagem binária.
+    int tilesX, tilesY;             // Tiles do quadro atual.
+    uint8_t *tiles;                 // Estado de cada tile no quadro atual (ver incremental.c).
+    DirtyRect *runs;                // Tiles recalculados, como sequências de tiles vizinhos em uma linha de tiles.
+    int runCount;
+    int valid;                      // 1 se o estado corresponde ao quadro anterior.
+    int threshold;                  // Limiar do quadro anterior.
+    Image previous;                 // Quadro anterior, em tons de cinza.
+    Bitplane mask;                  // Imagem binária do quadro atual.
+    LabelImage labels;              // Rótulos do quadro atual.
+    ComponentStats *stats;          // Estatísticas por rótulo (área 0 para rótulos livres).
+    uint32_t maxLabel;
+    int components;
+    size_t capacity;                // Posições de stats, marks, freeLabels, affected e map.
+    uint32_t *freeLabels;           // Rótulos livres, abaixo de maxLabel.
+    size_t freeCount;
+    uint8_t *marks;                 // 1 para os rótulos das componentes sendo rotuladas novamente.
+    uint32_t *affected;             // Esses rótulos, em lista.
+    uint32_t *map;                  // Rótulo final de cada rótulo da janela.
+    Bitplane region;                // Janela da imagem binária (na morfologia e na rotulação).
+    LabelImage regionLabels;        // Rótulos da janela.
+    Labeler labeler;
+    uint64_t *scratch;              // Buffer de trabalho da morfologia.
+    uint32_t *window;               // Buffer de trabalho da limiarização local, ou NULL.
+    ProfileFrame profile;           // Medidas do último quadro, zeradas por incrementalUpdate.
+} Incremental;
+
+/** @brief A função createIncremental aloca, uma única vez, todos os buffers para quadros de até
+  * config->maxWidth x config->maxHeight pixels. São usados a limiarização, o elemento estruturante, a operação e a
+  * conectividade da configuração; threads e stats são ignorados (o processamento é serial, e as estatísticas são
+  * sempre mantidas, pois guiam a atualização).
+  * @return Retorna 0 em caso de sucesso, -1 caso a configuração seja inválida ou falte memória.
+  */
+int createIncremental (Incremental *incremental, const PipelineConfig *config);
+
+/** @brief A função freeIncremental libera os buffers.
+  */
+void freeIncremental (Incremental *incremental);
+
+/** @brief A função resetIncremental faz com que o próximo quadro seja processado por inteiro.
+  */
+void resetIncremental (Incremental *incremental);
+
+/** @brief A função incrementalUpdate processa um quadro a partir do anterior.
+  * @param *gray Quadro em tons de cinza.
+  * @param threshold Limiar global (ignorado com um método local). Se for diferente do quadro anterior, o quadro é
+  *        processado por inteiro.
+  * @param *rects Retângulos que contêm todos os pixels alterados desde o quadro anterior, ou NULL para compará-los
+  *        tile a tile com o quadro anterior.
+  * @param count Quantidade de retângulos.
+  * @param *result Resultado, retornado por referência; os ponteiros são válidos até a próxima chamada.
+  * @return Retorna 0 em caso de sucesso, -1 caso o quadro seja maior que as dimensões máximas ou falte memória (o
+  *         próximo quadro é então processado por inteiro).
+  */
+int incrementalUpdate (Incremental *incremental, const Image *gray, int threshold, const DirtyRect *rects, int count,
+                       IncrementalResult *result);
+
+#endif
@@ -0,0 +1,293 @@
+/*
+ * Arquivo: label.c
+ *
+ * Descrição: Implementação da rotulação de componentes conexas por union-find (ver label.h).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "components.h"
+#include "label.h"
+
+/*-------------------------------------------INIT UNION-FIND-------------------------------------------*/
+
+/** @brief findRoot retorna o representante de um rótulo provisório, encurtando o caminho percorrido (path halving).
+  */
+static inline uint32_t findRoot (uint32_t *parent, uint32_t r) {
+    while (parent[r] != r) {
+        parent[r] = parent[parent[r]];
+        r = parent[r];
+    }
+    return r;
+}
+
+/** @brief unite une as classes de dois rótulos e retorna o novo representante. O menor representante é sempre
+  * mantido, de forma que parent[r] <= r para todo r.
+  */
+static inline uint32_t unite (uint32_t *parent, uint32_t a, uint32_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+        return a;
+    }
+    parent[a] = b;
+    return b;
+}
+
+/*--------------------------------------------END UNION-FIND--------------------------------------------*/
+
+size_t labelTableSize (int width, int height) {
+    // No pior caso (um tabuleiro de xadrez, com 4-conectividade), metade dos pixels inicia um rótulo novo.
+    return stripTableSize(width, height) + 1;
+}
+
+size_t stripTableSize (int width, int rows) {
+    return ((size_t) width * (size_t) rows + 1) / 2;
+}
+
+int createLabelerWithCapacity (Labeler *labeler, size_t capacity) {
+    labeler->external = 0;
+    labeler->stats = NULL;
+    labeler->statsCapacity = 0;
+    labeler->capacity = capacity;
+    labeler->parent = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+    if (labeler->parent == NULL) {
+        labeler->capacity = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int createLabeler (Labeler *labeler, int width, int height) {
+    return createLabelerWithCapacity(labeler, labelTableSize(width, height));
+}
+
+void attachLabeler (Labeler *labeler, uint32_t *parent, size_t capacity, ComponentStats *stats, size_t statsCapacity) {
+    labeler->parent = parent;
+    labeler->capacity = capacity;
+    labeler->stats = stats;
+    labeler->statsCapacity = stats != NULL ? statsCapacity : 0;
+    labeler->external = 1;
+}
+
+int reserveLabeler (Labeler *labeler, size_t capacity) {
+    if (capacity <= labeler->capacity) return 0;
+    if (labeler->external) return -1;
+    uint32_t *parent = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+    if (parent == NULL) return -1;
+    free(labeler->parent);
+    labeler->parent = parent;
+    labeler->capacity = capacity;
+    return 0;
+}
+
+void freeLabeler (Labeler *labeler) {
+    if (!labeler->external) {
+        free(labeler->parent);
+        free(labeler->stats);
+    }
+    labeler->parent = NULL;
+    labeler->stats = NULL;
+    labeler->capacity = labeler->statsCapacity = 0;
+}
+
+int reserveStats (Labeler *labeler, size_t count) {
+    // O vetor cresce geometricamente, de forma que, após as primeiras imagens, nenhuma alocação é feita.
+    if (count <= labeler->statsCapacity) return 0;
+    if (labeler->external) return -1;
+    size_t capacity = labeler->statsCapacity > 0 ? labeler->statsCapacity : 64;
+    while (capacity < count) capacity *= 2;
+    ComponentStats *stats = (ComponentStats*) realloc(labeler->stats, capacity * sizeof(ComponentStats));
+    if (stats == NULL) return -1;
+    labeler->stats = stats;
+    labeler->statsCapacity = capacity;
+    return 0;
+}
+
+/*---------------------------------------------INIT FAIXAS---------------------------------------------*/
+
+uint32_t labelStrip (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                     int rowStart, int rowEnd, uint32_t base) {
+    return labelStripRows(labeler, mask, connectivity, labels, rowStart, rowStart, rowEnd, base);
+}
+
+uint32_t labelStripRows (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                         int stripStart, int rowStart, int rowEnd, uint32_t next) {
+    int width = mask->width;
+    uint32_t *parent = labeler->parent;
+
+    // Só os pixels de foreground são visitados, bit a bit, pulando-se as palavras vazias do bitplane.
+    for (int h = rowStart; h < rowEnd; h++) {
+        const uint64_t *bits = bitplaneRow(mask, h);
+        uint32_t *row = labelRow(labels, h);
+        const uint32_t *up = h > stripStart ? labelRow(labels, h - 1) : NULL;
+        memset(row, 0, (size_t) width * sizeof(uint32_t));
+
+        for (int i = 0; i < mask->words; i++) {
+            uint64_t word = bits[i];
+            while (word != 0) {
+                int w = i * 64 + __builtin_ctzll(word);
+                word &= word - 1;
+
+                uint32_t left = w > 0 ? row[w - 1] : 0;
+                uint32_t above = up != NULL ? up[w] : 0;
+                uint32_t label;
+                if (connectivity == CONNECTIVITY_8 && up != NULL) {
+                    // Com 8-conectividade, os vizinhos em cima à esquerda e em cima à direita também são considerados.
+                    uint32_t upLeft = w > 0 ? up[w - 1] : 0;
+                    uint32_t upRight = w + 1 < width ? up[w + 1] : 0;
+                    label = above ? above : (left ? left : upLeft);
+                    if (label == 0) label = upRight;
+                    if (label != 0) {
+                        if (left && left != label) label = unite(parent, label, left);
+                        if (upLeft && upLeft != label) label = unite(parent, label, upLeft);
+                        if (upRight && upRight != label) label = unite(parent, label, upRight);
+                    }
+                } else {
+                    label = above ? above : left;
+                    if (above && left && above != left) label = unite(parent, above, left);
+                }
+                if (label == 0) {   // Nenhum vizinho visitado: o pixel inicia um novo rótulo provisório.
+                    label = next++;
+                    parent[label] = label;
+                }
+                row[w] = label;
+            }
+        }
+    }
+    return next;
+}
+
+void mergeStripBorder (Labeler *labeler, const LabelImage *labels, int connectivity, int row) {
+    uint32_t *parent = labeler->parent;
+    const uint32_t *up = labelRow(labels, row - 1);
+    const uint32_t *cur = labelRow(labels, row);
+    int width = labels->width;
+    for (int w = 0; w < width; w++) {
+        if (cur[w] == 0) continue;
+        if (up[w]) unite(parent, cur[w], up[w]);
+        if (connectivity == CONNECTIVITY_8) {
+            if (w > 0 && up[w - 1]) unite(parent, cur[w], up[w - 1]);
+            if (w + 1 < width && up[w + 1]) unite(parent, cur[w], up[w + 1]);
+        }
+    }
+}
+
+uint32_t resolveLabels (Labeler *labeler, const uint32_t *ranges, int count) {
+    // Os rótulos provisórios são trocados por rótulos finais consecutivos. Como parent[r] <= r, percorrer a tabela em
+    // ordem garante que o representante de r já tenha seu rótulo final quando r é visitado.
+    uint32_t *parent = labeler->parent;
+    uint32_t total = 0;
+    parent[0] = 0;
+    for (int k = 0; k < count; k++) {
+        for (uint32_t r = ranges[2*k]; r < ranges[2*k + 1]; r++) {
+            parent[r] = parent[r] == r ? ++total : parent[parent[r]];
+        }
+    }
+    return total;
+}
+
+void relabelStrip (const Labeler *labeler, const Bitplane *mask, LabelImage *labels, int rowStart, int rowEnd,
+                   ComponentStats *stats, uint32_t statsBase) {
+    const uint32_t *parent = labeler->parent;
+    int width = mask->width;
+
+    if (stats == NULL) {
+        for (int h = rowStart; h < rowEnd; h++) {
+            uint32_t *row = labelRow(labels, h);
+            for (int w = 0; w < width; w++) row[w] = parent[row[w]];
+        }
+        return;
+    }
+
+    // Com estatísticas, percorremos apenas os pixels de foreground. O perímetro de cada pixel é a quantidade de
+    // vizinhos (em cima, em baixo, à esquerda e à direita) de fundo, lidos do bitplane.
+    for (int h = rowStart; h < rowEnd; h++) {
+        const uint64_t *bits = bitplaneRow(mask, h);
+        const uint64_t *up = h > 0 ? bitplaneRow(mask, h - 1) : NULL;
+        const uint64_t *down = h + 1 < mask->height ? bitplaneRow(mask, h + 1) : NULL;
+        uint32_t *row = labelRow(labels, h);
+
+        for (int i = 0; i < mask->words; i++) {
+            uint64_t word = bits[i];
+            // Vizinhos à esquerda e à direita de todos os pixels da palavra, com os bits das palavras adjacentes.
+            uint64_t left = (word << 1) | (i > 0 ? bits[i - 1] >> 63 : 0);
+            uint64_t right = (word >> 1) | (i + 1 < mask->words ? bits[i + 1] << 63 : 0);
+            uint64_t above = up != NULL ? up[i] : 0;
+            uint64_t below = down != NULL ? down[i] : 0;
+            while (word != 0) {
+                int b = __builtin_ctzll(word);
+                int w = i * 64 + b;
+                word &= word - 1;
+                int neighbors = (int) ((left >> b) & 1u) + (int) ((right >> b) & 1u) +
+                                (int) ((above >> b) & 1u) + (int) ((below >> b) & 1u);
+                uint32_t provisional = row[w];
+                uint32_t label = parent[provisional];
+                row[w] = label;
+                addComponentPixel(&stats[statsBase ? provisional - statsBase : label], w, h, 4 - neighbors);
+            }
+        }
+    }
+}
+
+/*----------------------------------------------END FAIXAS----------------------------------------------*/
+
+int labelComponents (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                     ComponentStats **stats) {
+    int width = mask->width;
+    int height = mask->height;
+    if (labels->width != width || labels->height != height) return -1;
+    if (connectivity != CONNECTIVITY_4 && connectivity != CONNECTIVITY_8) return -1;
+    if (labeler->capacity < labelTableSize(width, height)) return -1;
+
+    // A imagem inteira é uma única faixa, com rótulos provisórios a partir de 1 (o rótulo 0 é o fundo).
+    uint32_t range[2] = {1, 0};
+    range[1] = labelStrip(labeler, mask, connectivity, labels, 0, height, 1);
+    uint32_t count = resolveLabels(labeler, range, 1);
+
+    ComponentStats *accumulated = NULL;
+    if (stats != NULL) {
+        if (reserveStats(labeler, (size_t) count + 1) != 0) return -1;
+        for (uint32_t i = 0; i <= count; i++) resetComponentStats(&labeler->stats[i]);
+        accumulated = labeler->stats;
+        *stats = accumulated;
+    }
+    relabelStrip(labeler, mask, labels, 0, height, accumulated, 0);
+    return (int) count;
+}
+
+/*-------------------------------------------INIT PINTURA--------------------------------------------*/
+
+int componentColors (int count, uint8_t *colors) {
+    // Esta é a cor da primeira componente conexa.
+    int targetColor = 40;
+    int rate = (255 - 40) / (count > 0 ? count : 1);
+    // Este é o incremento de cor que é executado na pintura de uma componente para outra
+
+    colors[0] = 0;
+    for (int i = 1; i <= count; i++) {
+        if (targetColor >= 255) targetColor = 40;   // Se a cor a ser pintada extrapolar o limite, resetar.
+        targetColor += rate;                        // Cor da próxima componente conexa.
+        colors[i] = (uint8_t) targetColor;
+    }
+    return targetColor;
+}
+
+void stableColors (uint32_t count, uint8_t *colors) {
+    colors[0] = 0;
+    // 53 e 215 são primos entre si: os primeiros 215 rótulos recebem cores diferentes, espalhadas pela faixa.
+    for (uint32_t i = 1; i <= count; i++) colors[i] = (uint8_t) (41 + (i * 53) % 215);
+}
+
+void paintLabels (const LabelImage *labels, const uint8_t *colors, Image *output) {
+    for (int h = 0; h < labels->height; h++) {
+        const uint32_t *row = labelRow(labels, h);
+        uint8_t *out = imageRow(output, h);
+        for (int w = 0; w < labels->width; w++) out[w] = colors[row[w]];
+    }
+}
+
+/*--------------------------------------------END PINTURA---------------------------------------------*/
@@ -0,0 +1,164 @@
+/*
+ * Arquivo: label.h
+ *
+ * Descrição: Rotulação de componentes conexas por union-find, em duas passadas sobre a imagem binária. Na primeira,
+ * cada pixel de foreground recebe um rótulo provisório a partir de seus vizinhos já visitados, e rótulos que se
+ * encontram são unidos em uma tabela de equivalências. Na segunda, cada rótulo provisório é trocado pelo rótulo final.
+ * O resultado é uma imagem de rótulos densa, com as componentes numeradas de 1 a N na ordem em que aparecem na
+ * varredura (a mesma ordem em que o Flood Fill as encontrava), e a quantidade N de componentes. Opcionalmente, a segunda
+ * passada também acumula as estatísticas de cada componente (ver components.h).
+*/
+
+#ifndef LABEL_H
+#define LABEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "components.h"
+#include "image.h"
+
+#define CONNECTIVITY_4 4 // Vizinhos em cima, em baixo, à esquerda e à direita.
+#define CONNECTIVITY_8 8 // Também os vizinhos nas diagonais.
+
+/*
+ * O Labeler guarda a tabela de equivalências entre rótulos provisórios. Ela é alocada uma única vez, com capacidade
+ * para o pior caso de uma imagem de dimensões dadas, e reaproveitada entre imagens. O vetor de estatísticas cresce
+ * conforme a quantidade de componentes encontradas, e também é reaproveitado.
+*/
+typedef struct Labeler {
+    uint32_t *parent;       // parent[r] é o representante do rótulo provisório r (parent[r] <= r).
+    size_t capacity;        // Quantidade de posições em parent.
+    ComponentStats *stats;  // Estatísticas por rótulo final (a posição 0, do fundo, não é usada).
+    size_t statsCapacity;   // Quantidade de posições em stats.
+    int external;           // 1 se parent e stats pertencem a quem chama (ver attachLabeler).
+} Labeler;
+
+/** @brief A função labelTableSize retorna a quantidade máxima de rótulos provisórios (mais o rótulo 0, do fundo)
+  * que uma imagem width x height pode gerar.
+  */
+size_t labelTableSize (int width, int height);
+
+/** @brief A função stripTableSize retorna a quantidade máxima de rótulos provisórios que uma faixa de rows linhas,
+  * com largura width, pode gerar.
+  */
+size_t stripTableSize (int width, int rows);
+
+/** @brief A função createLabeler aloca a tabela de equivalências para imagens de até width x height pixels.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int createLabeler (Labeler *labeler, int width, int height);
+
+/** @brief A função createLabelerWithCapacity aloca uma tabela de equivalências com capacity posições (por exemplo,
+  * 1 mais a soma de stripTableSize de cada faixa, quando a imagem é rotulada em faixas).
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int createLabelerWithCapacity (Labeler *labeler, size_t capacity);
+
+/** @brief A função freeLabeler libera a tabela de equivalências e as estatísticas.
+  */
+void freeLabeler (Labeler *labeler);
+
+/** @brief A função labelComponents rotula as componentes conexas de uma imagem binária.
+  * @param *labeler Tabela de equivalências, com capacidade para as dimensões da imagem.
+  * @param *mask Imagem binária.
+  * @param connectivity CONNECTIVITY_4 ou CONNECTIVITY_8.
+  * @param *labels Imagem de rótulos de saída, com as mesmas dimensões de mask.
+  * @param **stats Se não for NULL, as estatísticas das componentes são acumuladas, e *stats passa a apontar para um
+  *        vetor (pertencente ao labeler, válido até a próxima chamada) indexado pelo rótulo, com N + 1 posições.
+  * @return Retorna a quantidade N de componentes conexas, ou -1 caso os parâmetros sejam inválidos ou falte memória
+  *         para as estatísticas.
+  */
+int labelComponents (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                     ComponentStats **stats);
+
+/** @brief A função attachLabeler inicia um labeler com buffers fornecidos por quem chama (por exemplo, a partir de
+  * uma arena). Eles não são realocados nem liberados: uma rotulação que precise de mais espaço falha.
+  * @param *parent Tabela de equivalências, com capacity posições.
+  * @param *stats Estatísticas por rótulo final, com statsCapacity posições, ou NULL.
+  */
+void attachLabeler (Labeler *labeler, uint32_t *parent, size_t capacity, ComponentStats *stats, size_t statsCapacity);
+
+/** @brief A função reserveLabeler garante que a tabela de equivalências tenha ao menos capacity posições,
+  * realocando-a apenas se for menor. O conteúdo da tabela não é preservado.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int reserveLabeler (Labeler *labeler, size_t capacity);
+
+/** @brief A função reserveStats garante que o vetor de estatísticas do labeler tenha ao menos count posições.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int reserveStats (Labeler *labeler, size_t count);
+
+/*
+ * Etapas da rotulação, usadas para rotular uma imagem em faixas horizontais, cada uma possivelmente em uma thread
+ * diferente (ver parallel.h). labelComponents equivale a: labelStrip sobre a imagem inteira, resolveLabels e
+ * relabelStrip. Com várias faixas, cada uma usa uma faixa disjunta de rótulos provisórios, crescentes de cima para
+ * baixo; as faixas são unidas com mergeStripBorder antes de resolveLabels. Como as uniões mantêm sempre o menor rótulo,
+ * o resultado é idêntico ao da rotulação da imagem inteira de uma só vez.
+*/
+
+/** @brief A função labelStrip executa a primeira passada (rótulos provisórios) sobre as linhas rowStart a
+  * rowEnd - 1, sem consultar a linha anterior à faixa. Faixas diferentes podem ser rotuladas ao mesmo tempo, desde que
+  * usem rótulos disjuntos.
+  * @param base Primeiro rótulo provisório da faixa (no mínimo 1).
+  * @return Retorna o rótulo seguinte ao último usado pela faixa.
+  */
+uint32_t labelStrip (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                     int rowStart, int rowEnd, uint32_t base);
+
+/** @brief A função labelStripRows continua a primeira passada de uma faixa que começa na linha stripStart, rotulando
+  * as linhas rowStart a rowEnd - 1 (as anteriores da faixa já devem ter sido rotuladas). Permite rotular cada linha
+  * assim que ela é produzida, por exemplo pela morfologia (ver morphThresholdStrip).
+  * @param next Próximo rótulo provisório da faixa (o retorno da chamada anterior, ou o primeiro da faixa).
+  * @return Retorna o rótulo seguinte ao último usado pela faixa.
+  */
+uint32_t labelStripRows (Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                         int stripStart, int rowStart, int rowEnd, uint32_t next);
+
+/** @brief A função mergeStripBorder une os rótulos provisórios da linha row aos de seus vizinhos na linha row - 1
+  * (a última linha da faixa anterior).
+  */
+void mergeStripBorder (Labeler *labeler, const LabelImage *labels, int connectivity, int row);
+
+/** @brief A função resolveLabels troca o representante de cada rótulo provisório pelo seu rótulo final.
+  * @param *ranges Pares [início, fim) com os rótulos provisórios usados por cada faixa, em ordem.
+  * @param count Quantidade de faixas.
+  * @return Retorna a quantidade de componentes conexas.
+  */
+uint32_t resolveLabels (Labeler *labeler, const uint32_t *ranges, int count);
+
+/** @brief A função relabelStrip executa a segunda passada sobre as linhas rowStart a rowEnd - 1, trocando cada rótulo
+  * provisório pelo final e, se stats não for NULL, acumulando as estatísticas de cada pixel.
+  * @param *stats Estatísticas a acumular, ou NULL.
+  * @param statsBase Se 0, stats é indexado pelo rótulo final. Caso contrário, stats é indexado pelo rótulo provisório
+  *        menos statsBase (útil para que cada faixa acumule em seu próprio vetor, sem disputa entre threads).
+  */
+void relabelStrip (const Labeler *labeler, const Bitplane *mask, LabelImage *labels, int rowStart, int rowEnd,
+                   ComponentStats *stats, uint32_t statsBase);
+
+/** @brief A função componentColors monta a tabela de cores usada para pintar as componentes conexas, de forma a haver
+  * uma distribuição uniforme de cores entre todas elas. O fundo (rótulo 0) é preto, a primeira componente recebe
+  * 40 + rate, e cada componente seguinte recebe a cor da anterior mais rate.
+  * @param count Quantidade de componentes conexas.
+  * @param *colors Tabela de cores, com count + 1 posições, preenchida pela função.
+  * @return Retorna a cor da última componente pintada.
+  */
+int componentColors (int count, uint8_t *colors);
+
+/** @brief A função stableColors monta uma tabela de cores em que a cor de cada rótulo depende apenas do próprio rótulo,
+  * e não da quantidade de componentes, de forma que um rótulo estável (ver incremental.h) mantém sua cor entre os
+  * quadros. As cores vão de 41 a 255, e rótulos consecutivos recebem cores distantes entre si.
+  * @param count Maior rótulo em uso.
+  * @param *colors Tabela de cores, com count + 1 posições, preenchida pela função (o fundo é preto).
+  */
+void stableColors (uint32_t count, uint8_t *colors);
+
+/** @brief A função paintLabels pinta uma imagem a partir de seus rótulos: cada pixel recebe colors[rótulo].
+  * @param *labels Imagem de rótulos.
+  * @param *colors Tabela de cores, com uma posição para o fundo (0) e uma para cada componente.
+  * @param *output Imagem de saída, com as mesmas dimensões de labels.
+  */
+void paintLabels (const LabelImage *labels, const uint8_t *colors, Image *output);
+
+#endif
@@ -42,423 +42,1006 @@
  * -------------------------------------------------
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "components.h"
+#include "image.h"
+#include "incremental.h"
+#include "label.h"
+#include "morph.h"
+#include "parallel.h"
+#include "pgm.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "runs.h"
+#include "threshold.h"
+
+/** @brief A função writeStats escreve as estatísticas das componentes em path: em CSV se o nome terminar em ".csv",
+  * em JSON caso contrário.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro.
+  */
+int writeStats (const char *path, const ComponentStats *stats, int count) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return -1;
+    size_t length = strlen(path);
+    int status = (length >= 4 && strcmp(path + length - 4, ".csv") == 0) ? writeComponentsCSV(file, stats, count)
+                                                                         : writeComponentsJSON(file, stats, count);
+    if (fclose(file) != 0) status = -1;
+    return status;
+}
+
+/** @brief A função writeProfile escreve o relatório da instrumentação em path: em CSV se o nome terminar em ".csv",
+  * em JSON caso contrário (ver profile.h).
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro.
+  */
+int writeProfile (const char *path, const Profile *profile) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return -1;
+    size_t length = strlen(path);
+    int status = (length >= 4 && strcmp(path + length - 4, ".csv") == 0) ? writeProfileCSV(file, profile)
+                                                                         : writeProfileJSON(file, profile);
+    if (fclose(file) != 0) status = -1;
+    return status;
+}
 
-/*----------------------------------------------INIT QUEUE----------------------------------------------*/
+
+/*---------------------------------------------INIT WORKER---------------------------------------------*/
 
 /*
- * Devido à restrição no uso de memória com a execução deste algoritmo, utilizamos uma fila baseada em array (ao invés 
- * de lista ligada), pois assim alocamos a matriz unidimensional da fila apenas uma vez, em sua inicialização na função
- * Flood Fill.
+ * Contexto usado para processar imagens (ver pipeline.h). A arena só é trocada quando chega uma imagem maior que todas
+ * as anteriores, de forma que, processando várias imagens com o mesmo Worker, nenhuma memória é alocada após a maior
+ * delas.
 */
+typedef struct Worker {
+    Pipeline pipeline;	// Contexto do algoritmo, com seus buffers na arena.
+    void *arena;	// Memória da arena, ou NULL se o contexto ainda não foi criado.
+    int threads;	// Threads usadas no processamento de cada imagem.
+    int stats;		// 1 se as estatísticas das componentes são acumuladas.
+    ThresholdConfig thresholding;	// Método de limiarização.
+    Image decoded;	// Imagem em tons de cinza convertida, quando não é possível usar o arquivo mapeado diretamente.
+    RunImage runs;	// Sequências da imagem binária, na saída em RLE.
+    ProfileFrame frame;	// Medidas da imagem atual.
+    Profile profile;	// Medidas agregadas de todas as imagens processadas com sucesso.
+    char outPath[PATH_MAX];	// Caminhos de saída montados no modo em lote.
+    char statsPath[PATH_MAX];
+} Worker;
 
-typedef struct Queue {
-    /*
-     * Utilizamos inteiros que representam a frente da fila, a sua traseira, e seu tamanho, para que não sejam perdidos
-     * durante a manipulação da fila.
-    */
-    int front, rear, size;
-    unsigned capacity; // Capacidade máxima da fila
-    int *arrayX; // Ponteiro para a fila que armazena uma coordenada no eixo X da imagem.
-    int *arrayY; // Idem, para o eixo Y.
-} Queue;
-
-/** @brief A função createQueue inicializa uma fila e a retorna como ponteiro. É executado apenas no Flood Fill, uma vez.
-  * @param capacity O tamanho do array a ser criado.
-  * @return Retorna um ponteiro para uma nova fila, inicializada.
+/*
+ * Resultado do processamento de uma imagem.
+*/
+typedef struct FrameResult {
+    int threshold;
+    int connectedComps;
+    int targetColor;
+    const char *error;	// Descrição do erro, quando processImage falha.
+} FrameResult;
+
+/** @brief A função createWorker inicia um Worker vazio; o contexto é criado com a primeira imagem.
+  * @param threads Quantidade de threads usadas no processamento de cada imagem.
+  * @param stats 1 para acumular as estatísticas das componentes.
+  * @param *thresholding Método de limiarização.
   */
-Queue *createQueue (unsigned capacity) {
-    struct Queue* queue = (struct Queue*) malloc(sizeof(struct Queue)); // Criamos a struct.
-    queue->capacity = capacity;         // Atribuimos sua capacidade.
-    queue->front = queue->size = 0;     // Dizemos que sua frente é a posição 0 do array.
-    queue->rear = capacity - 1;         // Sua traseira é a última posição do array.
-    queue->arrayX = (int*) malloc(queue->capacity * sizeof(int)); // Criamos uma fila para coordenadas X
-    queue->arrayY = (int*) malloc(queue->capacity * sizeof(int)); // e outra para coordenadas Y.
-    return queue;
+void createWorker (Worker *worker, int threads, int stats, const ThresholdConfig *thresholding) {
+    memset(worker, 0, sizeof(Worker));
+    worker->threads = threads;
+    worker->stats = stats;
+    worker->thresholding = *thresholding;
+    resetProfile(&worker->profile);
 }
 
-/** @brief A função isFull determina se a fila passada por parâmetro está cheia ou não.
-  * @param *queue Ponteiro para a fila
-  * @return Retorna 1 se a fila está cheia, 0 caso contrário.
+/** @brief A função freeWorker libera o contexto, a arena e os buffers de um Worker.
   */
-int isFull (Queue *queue) {
-    return (queue->size == queue->capacity);
+void freeWorker (Worker *worker) {
+    if (worker->arena != NULL) freePipeline(&worker->pipeline);
+    free(worker->arena);
+    freeImage(&worker->decoded);
+    freeRunImage(&worker->runs);
+    worker->arena = NULL;
 }
 
+/** @brief reserveWorker garante que o contexto comporte imagens de width x height pixels, recriando-o, com uma arena
+  * maior, apenas se necessário.
+  * @return Retorna PIPELINE_OK ou um código de erro (PIPELINE_*).
+  */
+static int reserveWorker (Worker *worker, int width, int height) {
+    const PipelineConfig *current = &worker->pipeline.config;
+    if (worker->arena != NULL && width <= current->maxWidth && height <= current->maxHeight) return PIPELINE_OK;
+
+    PipelineConfig config = defaultPipelineConfig(width, height);
+    if (worker->arena != NULL) {
+        if (current->maxWidth > width) config.maxWidth = current->maxWidth;
+        if (current->maxHeight > height) config.maxHeight = current->maxHeight;
+    }
+    config.threads = worker->threads;
+    config.stats = worker->stats;
+    config.thresholding = worker->thresholding;
+    if (worker->arena != NULL) freePipeline(&worker->pipeline);
+    free(worker->arena);
+    worker->arena = NULL;
 
-/** @brief A função isEmpty determina se a fila passada por parâmetro está vazia ou não.
-  * @param *queue Ponteiro para a fila
-  * @return Retorna 1 se a fila está vazia, 0 caso contrário.
+    size_t size = pipelineArenaSize(&config);
+    if (size == 0) return PIPELINE_ERR_CONFIG;
+    worker->arena = malloc(size);
+    if (worker->arena == NULL) return PIPELINE_ERR_ARENA;
+    int status = createPipeline(&worker->pipeline, &config, worker->arena, size);
+    if (status != PIPELINE_OK) {
+        free(worker->arena);
+        worker->arena = NULL;
+    }
+    return status;
+}
+
+/** @brief processRuns é a variante de processFrame com saída no formato RLE (ver runs.h): após a limiarização e a
+  * abertura, a imagem binária é convertida em sequências, cujas componentes são rotuladas, com as estatísticas
+  * calculadas por sequência, e escritas sem pintar a imagem (targetColor é 0).
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro (descrito em result->error).
   */
-int isEmpty (Queue *queue) {
-    return (queue->size == 0);
+static int processRuns (Worker *worker, const Image *gray, const char *outPath, const char *statsPath,
+                        FrameResult *result) {
+    Pipeline *pipeline = &worker->pipeline;
+    resetProfileFrame(&pipeline->profile);
+    PROFILE_START(process);
+    int threshold = pipelineThreshold(pipeline, gray);
+    int status = pipelineBinarize(pipeline, gray, threshold);
+    if (status != PIPELINE_OK) {
+        result->error = pipelineError(status);
+        return -1;
+    }
+    PROFILE_START(label);
+    ComponentStats *stats = NULL;
+    int count = extractRuns(&pipeline->mask, &worker->runs) != 0 ? -1
+              : labelRuns(&worker->runs, pipeline->config.connectivity, statsPath != NULL ? &stats : NULL);
+    PROFILE_STOP(&pipeline->profile, PROFILE_LABEL, label);
+    PROFILE_STOP(&pipeline->profile, PROFILE_PROCESS, process);
+    if (count < 0) {
+        result->error = "memoria insuficiente";
+        return -1;
+    }
+    PROFILE_ADD(&pipeline->profile, PROFILE_COMPONENTS, count);
+    result->threshold = threshold;
+    result->connectedComps = count;
+    result->targetColor = 0;
+    addProfileFrame(&worker->frame, &pipeline->profile);
+
+    PROFILE_START(start);
+    if (statsPath != NULL && writeStats(statsPath, stats, count) != 0) {
+        result->error = "falha ao escrever as estatisticas";
+        return -1;
+    }
+    FILE *file = fopen(outPath, "wb");
+    status = file != NULL ? writeRLE(file, &worker->runs) : -1;
+    if (file != NULL && fclose(file) != 0) status = -1;
+    if (status != 0) {
+        result->error = "falha ao escrever a saida";
+        return -1;
+    }
+    PROFILE_STOP(&worker->frame, PROFILE_WRITE, start);
+    PROFILE_ADD(&worker->frame, PROFILE_BYTES_WRITTEN, rleSize(&worker->runs));
+    return 0;
 }
 
-/** @brief A função push insere dois elementos, um na fila do eixo X, outro na fila do eixo Y.
-  * @param *queue Ponteiro para a fila que se deseja fazer push.
-  * @param X Inteiro a ser inserido em X.
-  * @param Y Inteiro a ser inserido em Y.
+/** @brief A função processFrame executa o algoritmo sobre uma imagem em tons de cinza já carregada: o histograma da
+  * imagem é gerado e passado para a função Threshold; com o valor ótimo de limiarização, gera-se uma imagem binária que
+  * passa por erosão e dilatação; por fim, as componentes conexas são rotuladas por union-find e pintadas de forma a
+  * haver uma distribuição uniforme de cores entre todas elas. As etapas são as de pipelineProcess; aqui ficam apenas a
+  * escrita dos resultados em arquivo. Se outPath terminar em ".rle", as componentes são escritas no formato RLE, sem
+  * pintura (ver processRuns).
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro (descrito em result->error).
   */
-void push (Queue *queue, int X, int Y) {
-    if (isFull(queue)) return;  // Não fazer nada se estiver cheia.
-    queue->rear = (queue->rear+1) % queue->capacity; // Array circular. A traseira é incrementada, módulo capacidade.
-    queue->arrayX[queue->rear] = X; // Inserimos X em arrayX.
-    queue->arrayY[queue->rear] = Y; // Inserimos Y em arrayY.
-    queue->size = queue->size + 1; // Incrementamos o tamanho da fila.
+int processFrame (Worker *worker, const Image *gray, const char *outPath, const char *statsPath, FrameResult *result) {
+    PipelineResult frame;
+    size_t length = strlen(outPath);
+    int rle = length >= 4 && strcmp(outPath + length - 4, ".rle") == 0;
+    int status = reserveWorker(worker, gray->width, gray->height);
+    if (status == PIPELINE_OK && rle) return processRuns(worker, gray, outPath, statsPath, result);
+    if (status == PIPELINE_OK) status = pipelineProcess(&worker->pipeline, gray, &frame);
+    if (status == PIPELINE_ERR_ARENA) {
+        result->error = "memoria insuficiente";
+        return -1;
+    }
+    if (status != PIPELINE_OK) {
+        result->error = pipelineError(status);
+        return -1;
+    }
+    result->threshold = frame.threshold;
+    result->connectedComps = frame.components;
+    result->targetColor = frame.targetColor;
+    addProfileFrame(&worker->frame, &worker->pipeline.profile);
+
+    // As estatísticas de cada componente, acumuladas durante a rotulação, são exportadas em JSON ou CSV.
+    PROFILE_START(start);
+    if (statsPath != NULL && writeStats(statsPath, frame.stats, frame.components) != 0) {
+        result->error = "falha ao escrever as estatisticas";
+        return -1;
+    }
+
+    // Escrevemos o resultado do algoritmo no arquivo de output.
+    status = writePGM(outPath, frame.output);
+    if (status != PGM_OK) {
+        result->error = pgmError(status);
+        return -1;
+    }
+    PROFILE_STOP(&worker->frame, PROFILE_WRITE, start);
+    PROFILE_ADD(&worker->frame, PROFILE_BYTES_WRITTEN, pgmFrameSize(frame.output));
+    return 0;
 }
 
-/** @brief dequeue Retira da fila elementos na frente da fila. Retorna esses elementos por referência.
-  * @param *x ponteiro para o elemento do eixo X a ser retornado
-  * @param *y ponteiro para o elemento do eixo Y a ser retornado
+/** @brief A função processImage lê um arquivo PGM (P2 ou P5) e executa o algoritmo sobre ele (ver processFrame). Para
+  * P5 com maxval 255, os pixels são lidos diretamente do arquivo mapeado em memória; nos demais casos, são convertidos
+  * para o buffer do Worker.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro (descrito em result->error).
   */
-void dequeue (Queue *queue, int *x, int *y) {
-    if (isEmpty(queue)) { // Não fazer nada se estiver vazia.
-        return;
+int processImage (Worker *worker, const char *path, const char *outPath, const char *statsPath, FrameResult *result) {
+    PgmMap map;		// Arquivo de entrada, mapeado em memória.
+    Image view;		// Imagem que aponta para os pixels do arquivo mapeado.
+    const Image *gray = &view;
+
+    resetProfileFrame(&worker->frame);
+    PROFILE_START(start);
+    int status = mapPGM(path, &map);
+    if (status == PGM_OK) PROFILE_ADD(&worker->frame, PROFILE_BYTES_READ, map.length);
+    if (status == PGM_OK && viewPGM(&map, &view) != PGM_OK) {
+        status = decodePGMInto(&map, &worker->decoded);
+        unmapPGM(&map);
+        gray = &worker->decoded;
+    }
+    if (status != PGM_OK) {
+        result->error = pgmError(status);
+        return -1;
     }
-    *x = queue->arrayX[queue->front]; // x recebe o valor que estava na frente da fila
-    *y = queue->arrayY[queue->front]; // Idem para y.
-    queue->front = (queue->front + 1)%queue->capacity; // Incrementamos a fila em 1.
-    queue->size = queue->size - 1; // Diminuimos em 1 o tamanho da fila.
+    PROFILE_STOP(&worker->frame, PROFILE_READ, start);
+    int ok = processFrame(worker, gray, outPath, statsPath, result);
+    unmapPGM(&map);
+    if (ok == 0) recordProfile(&worker->profile, &worker->frame);
+    return ok;
 }
 
-/*----------------------------------------------END QUEUE----------------------------------------------*/
-
-/*-----------------------------------------INIT OTSU THRESHOLD-----------------------------------------*/
-
-/** @brief A função Threshold executa o algoritmo de Otsu sobre um histograma,
- **        e com isso, determina o valor ótimo de limiarização para a imagem.
- ** @param *hist Ponteiro para array que representa o histograma dos pixels uma imagem
- ** @return Retorna um inteiro representando o valor ótimo de limiarização para uma imagem.
- **/
-int Threshold(int *hist){
-    int total = 160*120;//quantidade de pixels da imagem
-    double gsum = 0;	//soma ponderada global das ocorrencias do pixel por sua intensidade
-    double gavg;	//media global ponderada dos pixels
-    double n1=0;	//numero de pixels da classe C1
-    double n2=0;	//numero de pixels da classe C2
-    double m1=0;	//media ponderada dos pixels da classe C1
-    double m2=0;	//media ponderada dos pixels da classe C2
-    double var;		//variancia entre as classes C1 e C2
-    double maxVar=0;	//armazena a maior variância
-    int threshold;	//valor para o qual as classes C1 e C2 possuem variância máxima
-
-    for(int i=0;i<256;i++){
-        gsum += (double)hist[i]*i;
-    }
-    gavg = gsum/total;
-    for(int i=0;i<256;++i){
-
-	n1 += hist[i];
-	//n1-Número de pixels cujas intensidades variam de 0 a i (Classe C1)
-
-	m1 += (double)i*hist[i];
-	//m1-Soma usada para a média ponderada das intensidades dos pixels de C1
-
-	n2 = total - n1;
-	//n2-Número de pixels cujas intensidades variam de i+1 a 255 (Classe C2)
-
-	m2 = gsum - m1;
-	//m2-Soma usada para a média ponderada das intensidades dos pixels de C2
-
-	var = (n1/total)*((m1/n1)-gavg)*((m1/(n1))-gavg)+
-		(n2/total)*((m2/n2)-gavg)*((m2/n2)-gavg);
-	//var-Variância entre classes para essa aplicação conforme descrito em:
-	//GONZALEZ, Rafael C. WOODS, Richard E. EDDINS, Steven L. Digital Image
-	//Processing using MATLAB. 2a edicao. Gatesmark Publishing. 2009.
-
-	if(var > maxVar){
-	    maxVar = var;
-	    threshold = i;
-        }
+/*----------------------------------------------END WORKER----------------------------------------------*/
+
+/**
+ * @brief A função runAlgorithm executa todos os algoritmos já desenvolvidos sobre uma única imagem, no modo
+ * interativo. Primeiro é lido o caminho para um arquivo pgm (P2 ou P5) que se deseja que se execute as funções. Essa
+ * imagem é processada (ver processFrame) e o resultado é escrito em out.pgm. A imagem pode ter qualquer resolução.
+ * @param *statsPath Caminho para o arquivo onde as estatísticas das componentes são escritas (em CSV se terminar em
+ * ".csv", em JSON caso contrário), ou NULL para não escrevê-las.
+ * @param *profilePath Caminho para o relatório da instrumentação (ver profile.h), ou NULL para não escrevê-lo.
+ * @param *thresholding Método de limiarização.
+ * @param threads Quantidade de threads usadas no processamento da imagem.
+ * @return
+ */
+int runAlgorithm(const char *statsPath, const char *profilePath, const ThresholdConfig *thresholding, int threads) {
+    char path[256]="";  // Buffer usado para armazenar o caminho para o arquivo
+    printf("Informe o nome do arquivo, ou seu caminho e nome: ");
+    fflush(stdout);
+    scanf(" %255[^\n]",path); // Lemos a linha inteira, pois o caminho pode conter espaços.
+
+    Worker worker;
+    createWorker(&worker, threads, statsPath != NULL, thresholding);
+    FrameResult result;
+    if (processImage(&worker, path, "out.pgm", statsPath, &result) != 0) {
+        printf("Falha ao processar %s: %s\n", path, result.error);
+        exit(1);
+    }
+    if (result.connectedComps == 0) {
+        result.connectedComps = 1;
+    }
+
+    printf("t = %d", result.threshold);
+    printf("\nconnectedComps = %d", result.connectedComps);
+    printf("\ntargetColor = %d", result.targetColor);
+
+    if (profilePath != NULL && writeProfile(profilePath, &worker.profile) != 0) {
+        printf("\nFalha ao escrever %s", profilePath);
     }
-    return threshold;
+    freeWorker(&worker);
+    return 0;
 }
 
-/*-----------------------------------------END OTSU THRESHOLD-----------------------------------------*/
+/*--------------------------------------------INIT LOTE---------------------------------------------*/
 
-/*------------------------------------------INIT FLOOD FILL-------------------------------------------*/
+/*
+ * Lista de caminhos de entrada do modo em lote.
+*/
+typedef struct PathList {
+    char **paths;
+    int count;
+    int capacity;
+} PathList;
 
-/** @brief A função isValid serve tanto para determinar se valores x e y estão dentro dos limites de
-  * uma imagem 160x120, como para verificar se a posição indicada por esses dois números não foi já
-  * utilizada, e para se certificar que o valor dessa posição é o mesmo valor que um certo comp.
-  * @param binaryMatrix[120][160] Matriz binária representando a imagem passada a limiarização.
-  * @param x Posição x na matriz
-  * @param y Posição y na matriz
-  * @param visited[120][160] Matriz que indica se cada uma de suas posições já foi visitada no Flood Fill 
-  * @param comp Valor a ser comparado.
+/** @brief A função addPath acrescenta uma cópia de path à lista.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
   */
-int isValid (int binaryMatrix[120][160], int x, int y, int visited[120][160], int comp) {
-    // Se x e y forem posições válidas, com um valor correto e que não tenham sido visitadas, retorne 1.
-    if (x >= 0 && x < 120 && y >= 0 && y < 160 && binaryMatrix[x][y] == comp && visited[x][y] != 1) {
-        return 1;
+int addPath (PathList *list, const char *path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+        char **paths = (char**) realloc(list->paths, (size_t) capacity * sizeof(char*));
+        if (paths == NULL) return -1;
+        list->paths = paths;
+        list->capacity = capacity;
     }
+    size_t length = strlen(path);
+    char *copy = (char*) malloc(length + 1);
+    if (copy == NULL) return -1;
+    memcpy(copy, path, length + 1);
+    list->paths[list->count++] = copy;
     return 0;
 }
 
-/** @brief A função erode aplica uma transformação de erosão na imagem, que consiste em tirar um pixel
-  * do exterior de cada "objeto". Por exemplo:
-  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0 
-  *                 1 0 0 1 1 0 0               0 0 0 0 0 0 0     
-  *                 0 0 1 1 1 1 0     ---->     0 0 0 1 1 0 0
-  *                 0 0 1 1 1 1 0               0 0 0 1 1 0 0
-  *                 0 0 0 1 1 0 0               0 0 0 0 0 0 0
-  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0
-  * Com a execução dessa função, conseguimos eliminar pixels individuais que fiquem "soltos" na imagem,
-  * para que não sejam considerados uma componente conexa. É executada antes do dilate, para limpar a imagem.
-  * @param outBinaryMatrix[120][160] Matriz resultante da operação, passada por referência.
-  * @param visited[120][160] Matriz de visitados
+/** @brief hasPGMExtension determina se o nome de um arquivo termina em ".pgm" (sem diferenciar maiúsculas).
+  */
+static int hasPGMExtension (const char *name) {
+    size_t length = strlen(name);
+    if (length < 4) return 0;
+    const char *ext = name + length - 4;
+    return ext[0] == '.' && tolower((unsigned char) ext[1]) == 'p' && tolower((unsigned char) ext[2]) == 'g' &&
+           tolower((unsigned char) ext[3]) == 'm';
+}
+
+static int comparePaths (const void *a, const void *b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/** @brief A função addInput acrescenta à lista uma entrada da linha de comando: um arquivo, todos os arquivos .pgm de
+  * um diretório (em ordem alfabética), ou, para "-", os caminhos lidos da entrada padrão, um por linha.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou não seja possível ler o diretório.
   */
-void erode (int outBinaryMatrix[120][160], int visited[120][160]) {
-    int orBinaryMatrix[120][160]; // Criamos uma matriz para guardar os valores originais da matriz binária.
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            orBinaryMatrix[h][w] = outBinaryMatrix[h][w]; 
-            /* Armazenamos os valores originais, para comparação posterior.
-             * Isso é nececessário para que façamos a erosão sobre os pixels da imagem original, não da imagem
-             * alterada pela erosão.
-             */
+int addInput (PathList *list, const char *input) {
+    char path[PATH_MAX];
+    if (strcmp(input, "-") == 0) {
+        while (fgets(path, sizeof(path), stdin) != NULL) {
+            size_t length = strcspn(path, "\r\n");
+            path[length] = '\0';
+            if (length > 0 && addPath(list, path) != 0) return -1;
         }
+        return 0;
     }
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            if (orBinaryMatrix[h][w] == 255) {  // Se o pixel estiver "pintado"
-                if ( (isValid(orBinaryMatrix, h, w-1, visited, 0) ||
-                      isValid(orBinaryMatrix, h, w+1, visited, 0) || 
-                      isValid(orBinaryMatrix, h+1, w, visited, 0) ||
-                      isValid(orBinaryMatrix, h-1, w, visited, 0)     
-                      /* As verificações anteriores servem para determinar se algum dos vizinhos de um pixel branco
-                       * (vizinhos apenas em cima e em baixo, esquerda e direita), é preto. Se for, o pixel atual
-                       * fica preto, pois isso significa que estamos na borda de um objeto.
-                       */
-                )) {
-                    outBinaryMatrix[h][w] = 0;
-                }
-            }
+
+    struct stat st;
+    if (stat(input, &st) != 0 || !S_ISDIR(st.st_mode)) return addPath(list, input);
+
+    DIR *dir = opendir(input);
+    if (dir == NULL) return -1;
+    int first = list->count;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!hasPGMExtension(entry->d_name)) continue;
+        snprintf(path, sizeof(path), "%s/%s", input, entry->d_name);
+        if (addPath(list, path) != 0) {
+            closedir(dir);
+            return -1;
         }
     }
+    closedir(dir);
+    qsort(list->paths + first, (size_t) (list->count - first), sizeof(char*), comparePaths);
+    return 0;
 }
 
-/** @brief A função dilate é análoga à erode, fazendo, porém, o contrário. Ou seja, aplica uma transformação de 
-  * dilatação na imagem, que consiste em pintar de branco cada pixel do exterior imediato de cada "objeto". Exemplo:
-  *                 0 0 0 0 0 0 0               1 0 0 0 0 0 0 
-  *                 1 0 0 0 0 0 0               1 1 0 1 1 0 0
-  *                 0 0 0 1 1 0 0     ---->     1 0 1 1 1 1 0
-  *                 0 0 0 1 1 0 0               0 0 1 1 1 1 0
-  *                 0 0 0 0 0 0 0               0 0 0 1 1 0 0
-  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0
-  * Com a execução dessa função, conseguimos restaurar ao tamanho original cada objeto da imagem, após a execução do dilate.
-  * @param outBinaryMatrix[120][160] Matriz resultante da operação, passada por referência.
-  * @param visited[120][160] Matriz de visitados
+/*
+ * Argumentos compartilhados pelas tarefas do modo em lote. Cada tarefa processa uma imagem, com o Worker da thread
+ * que a executa.
+*/
+typedef struct BatchJob {
+    const PathList *inputs;
+    const char *outDir;
+    const char *statsFormat;	// "json", "csv" ou NULL.
+    int rle;			// 1 para escrever as componentes no formato RLE, em vez da imagem pintada.
+    Worker *workers;
+    int *failures;		// Falhas de cada thread.
+} BatchJob;
+
+/** @brief sameFile determina se dois caminhos se referem ao mesmo arquivo existente.
   */
-void dilate (int outBinaryMatrix[120][160], int visited[120][160]) {
-    int orBinaryMatrix[120][160]; // Criamos uma matriz para guardar os valores originais da matriz binária.
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            orBinaryMatrix[h][w] = outBinaryMatrix[h][w];
-            /* Armazenamos os valores originais, para comparação posterior.
-             * Isso é nececessário para que façamos a erosão sobre os pixels da imagem original, não da imagem
-             * alterada pela erosão.
-             */
-        }
+static int sameFile (const char *a, const char *b) {
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+static void batchTask (void *arg, int task, int thread) {
+    BatchJob *job = (BatchJob*) arg;
+    Worker *worker = &job->workers[thread];
+    const char *path = job->inputs->paths[task];
+
+    // A imagem de saída tem o mesmo nome da de entrada, no diretório de saída (em RLE, com a extensão .rle); as
+    // estatísticas, o mesmo nome com a extensão do formato escolhido.
+    const char *name = strrchr(path, '/');
+    name = name != NULL ? name + 1 : path;
+    int base = (int) (hasPGMExtension(name) ? strlen(name) - 4 : strlen(name));
+    if (job->rle) {
+        snprintf(worker->outPath, sizeof(worker->outPath), "%s/%.*s.rle", job->outDir, base, name);
+    } else {
+        snprintf(worker->outPath, sizeof(worker->outPath), "%s/%s", job->outDir, name);
     }
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            if (orBinaryMatrix[h][w] == 0) { // Se o pixel atual for preto.
-                if (isValid(orBinaryMatrix, h, w-1, visited, 255) ||
-                    isValid(orBinaryMatrix, h, w+1, visited, 255) ||
-                    isValid(orBinaryMatrix, h+1, w, visited, 255) ||
-                    isValid(orBinaryMatrix, h-1, w, visited, 255)
-                    /* As verificações anteriores servem para determinar se algum vizinho de um pixel preto é
-                     * branco. Se for, pintamos o pixel atual de branco.
-                     */
-                ) {
-                    outBinaryMatrix[h][w] = 255;
-                }
-            }
-        }
+    if (job->statsFormat != NULL) {
+        snprintf(worker->statsPath, sizeof(worker->statsPath), "%s/%.*s.%s", job->outDir, base, name,
+                 job->statsFormat);
+    }
+
+    FrameResult result;
+    if (sameFile(path, worker->outPath)) {
+        result.error = "a saida sobrescreveria a entrada";
+    } else if (processImage(worker, path, worker->outPath, job->statsFormat != NULL ? worker->statsPath : NULL,
+                            &result) == 0) {
+        printf("%s: t = %d, connectedComps = %d, targetColor = %d\n", path, result.threshold, result.connectedComps,
+               result.targetColor);
+        return;
     }
+    fprintf(stderr, "Falha ao processar %s: %s\n", path, result.error);
+    job->failures[thread]++;
 }
 
-/** @brief floodFill determina a area conectada a um dado pixel da imagem obtida.
-  * Se o pixel vizinho é de foreground (255) este é preenchido com targetColor e 
-  * inserido na fila sendo posteriormente marcado como visitado e removido da
-  * fila ao verificar seus vizinhos. A função encerra quando a fila for vazia.
-  *
-  * @param binaryMatrix[120][160] matriz de pixels da imagem binária
-  * @param x indica a posicão do pixel relativa às linhas da matriz
-  * @param y indica a posição do pixel relativas às colunas da matriz
-  * @param visited[120][160] visited[x][y] indica se o pixel (x,y) foi visitado (1) ou não (0)
-  * @param targetColor inteiro entre 0 e 255 indicando uma cor em gray scale para preenchimento
+/** @brief A função runBatch processa todas as imagens de uma lista, sem interação, escrevendo os resultados em
+  * outDir. As imagens são distribuídas entre as threads por roubo de tarefas (ver pool.h); cada thread processa uma
+  * imagem inteira por vez, com seu próprio Worker, de forma que seus buffers são reaproveitados entre as imagens.
+  * @param statsFormat "json" ou "csv" para escrever as estatísticas de cada imagem, ou NULL.
+  * @param rle 1 para escrever as componentes de cada imagem no formato RLE (ver runs.h), em vez da imagem pintada.
+  * @param *profilePath Caminho para o relatório da instrumentação, agregando todas as imagens, ou NULL.
+  * @param *thresholding Método de limiarização.
+  * @return Retorna 0 se todas as imagens foram processadas, 1 caso contrário.
   */
-void floodFill (int binaryMatrix[120][160], int x, int y, int visited[120][160], int targetColor) {
-    Queue *queue = createQueue((unsigned int) ((120 * 160) / 2));
-    push(queue, x, y);
-    int currentX = 0;
-    int currentY = 0;
-    while (!isEmpty(queue)) {
-        dequeue(queue, &currentX, &currentY);//remove da fila e atualiza a posicao atual
-        binaryMatrix[currentX][currentY] = targetColor;//preenche o pixel atual com targetColor
-        visited[currentX][currentY] = 1;//marca o pixel como visitado
-	//verifica vizinho acima, se ele for pixel de foreground e não
-	//foi visitado é preenchido e inserido na fila
-        if (isValid(binaryMatrix, currentX+1, currentY, visited, 255)){
-            binaryMatrix[currentX+1][currentY] = targetColor;
-            push(queue, currentX+1, currentY);
-        }
-	//verifica vizinho abaixo, análogo ao caso anterior
-        if (isValid(binaryMatrix, currentX-1, currentY, visited, 255)){
-            binaryMatrix[currentX-1][currentY] = targetColor;
-            push(queue, currentX-1, currentY);
-	}
-	//verifica vizinho a direita, análogo ao caso anterior
-        if (isValid(binaryMatrix, currentX, currentY+1, visited, 255)){
-            binaryMatrix[currentX][currentY+1] = targetColor;
-            push(queue, currentX, currentY+1);
-        }
-	//verifica vizinho a esquerda, análogo ao caso anterior
-        if (isValid(binaryMatrix, currentX, currentY-1, visited, 255)){
-            binaryMatrix[currentX][currentY-1] = targetColor;
-            push(queue, currentX, currentY-1);
-        }
+int runBatch (const PathList *inputs, const char *outDir, const char *statsFormat, int rle, const char *profilePath,
+              const ThresholdConfig *thresholding, int threads) {
+    Pool pool;
+    if (createPool(&pool, threads) != 0) {
+        fprintf(stderr, "Falha ao criar %d threads\n", threads);
+        return 1;
+    }
+    Worker *workers = (Worker*) malloc((size_t) pool.threads * sizeof(Worker));
+    int *failures = (int*) calloc((size_t) pool.threads, sizeof(int));
+    if (workers == NULL || failures == NULL) {
+        fprintf(stderr, "Falha ao alocar memoria\n");
+        free(workers);
+        free(failures);
+        freePool(&pool);
+        return 1;
+    }
+
+    for (int i = 0; i < pool.threads; i++) createWorker(&workers[i], 1, statsFormat != NULL, thresholding);
+
+    BatchJob job;
+    job.inputs = inputs;
+    job.outDir = outDir;
+    job.statsFormat = statsFormat;
+    job.rle = rle;
+    job.workers = workers;
+    job.failures = failures;
+    poolRun(&pool, inputs->count, batchTask, &job);
+
+    // As medidas de cada thread são somadas em um único relatório.
+    int total = 0;
+    for (int i = 0; i < pool.threads; i++) {
+        total += failures[i];
+        if (i > 0) mergeProfile(&workers[0].profile, &workers[i].profile);
     }
-    free(queue->arrayX);
-    free(queue->arrayY);
-    free(queue);
+    if (profilePath != NULL && writeProfile(profilePath, &workers[0].profile) != 0) {
+        fprintf(stderr, "Falha ao escrever %s\n", profilePath);
+        total++;
+    }
+    for (int i = 0; i < pool.threads; i++) freeWorker(&workers[i]);
+    free(workers);
+    free(failures);
+    freePool(&pool);
+    return total > 0 ? 1 : 0;
 }
 
+/*---------------------------------------------END LOTE----------------------------------------------*/
 
+/*--------------------------------------------INIT VÍDEO---------------------------------------------*/
 
-/**
- * @brief A função runAlgorithm executa todos os algoritmos já desenvolvidos. Primeiro é lido o caminho para um arquivo
- * pgm que se deseja que se execute as funções. Essa imagem é lida e armazenada na memória. Enquanto ela está sendo lida,
- * o histograma da imagem também está sendo gerado, histograma este que é posteriormente passado para a função Threshold.
- * Feito isso, e com o valor ótimo de limiarização obtido, gera-se uma imagem binária que posteriormente passa por erosão
- * e dilatação. Por fim, o Flood Fill é executado duas vezes, na primeira vez para se contar a quantidade de componentes
- * conexas, e na segunda para pintar essas componentes de forma a haver uma distribuição uniforme de cores entre todas
- * as componentes.
- * @return
- */
-int runAlgorithm() {
-    FILE *file2read;	// Ponteiro do arquivo para leitura
-    FILE *file2write;	// Ponteiro do arquivo para escrita
-    char path[256]="";  // Buffer usado para armazenar o caminho para o arquivo
-    printf("Informe o nome do arquivo, ou seu caminho e nome: ");
-    fflush(stdout);
-    scanf("%s",path);
-    file2read = fopen(path,"r");
-    file2write = fopen("out.pgm","w+");
+#define STREAM_FRAMES 4 // Quadros no buffer circular do modo de vídeo (limita a latência a poucos quadros).
 
-    if((file2read == NULL) || (file2write == NULL)){
-        printf("Falha ao abrir arquivos\n");
-        exit(1);
-    }
+// Estados de um quadro do buffer circular. Cada estágio só processa quadros no seu estado, em ordem, e os passa ao
+// estágio seguinte; o último devolve o quadro à leitura.
+#define FRAME_FREE   0  // Livre para a leitura.
+#define FRAME_READ   1  // Lido, aguardando limiarização e morfologia.
+#define FRAME_BINARY 2  // Binarizado, aguardando rotulação e escrita.
 
-    int hist[256];	       // Histograma de pixels
-    int matrix [120][160]; // Matriz usada para armazenar a imagem lida em memória. Operações são feitas nessa matriz.
-    int visited[120][160]; // Matriz que indica quais pixeis já foram visitados, em diferentes ocasiões.
+typedef struct StreamFrame {
+    Image gray;		// Pixels lidos, com stride igual à largura, de forma que um quadro é lido com um único read.
+    Bitplane mask;	// Imagem binária, após a abertura.
+    int index;		// Número do quadro no fluxo.
+    int threshold;	// Limiar usado no quadro.
+    int last;		// 1 no marcador de fim do fluxo (sem pixels).
+    int state;		// FRAME_FREE, FRAME_READ ou FRAME_BINARY.
+    ProfileFrame profile;	// Medidas do quadro, preenchidas por cada estágio.
+} StreamFrame;
 
-    for(int i=0;i<256;++i) hist[i] = 0; // Iniciamos o histograma apenas com 0s.
+typedef struct StreamOptions {
+    int rawWidth;	// Dimensões dos quadros crus, ou 0 para quadros P5 concatenados.
+    int rawHeight;
+    int interval;	// O limiar (e o histograma) é recalculado a cada interval quadros, e reaproveitado nos demais.
+    double smoothing;	// Peso de cada novo limiar na média móvel exponencial (1 = sem suavização).
+    const char *outPath;// Fluxo de saída, com os quadros pintados em P5 concatenados, "-" para a saída padrão, ou NULL.
+    int threads;	// Threads de cada estágio paralelo.
+    const char *profilePath;	// Relatório da instrumentação, agregando todos os quadros, ou NULL.
+    ThresholdConfig thresholding;	// Método de limiarização.
+    int incremental;	// 1 para rotular cada quadro a partir do anterior, apenas nos tiles alterados (ver incremental.h).
+} StreamOptions;
 
-    for (int j = 0; j < 15; j++) {
-        fgetc(file2read);
-        // Descartamos os primeiros 15 caracteres do arquivo, pois não importam para este algoritmo.
-    }
+typedef struct Stream {
+    StreamFrame frames[STREAM_FRAMES];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;	// Sinaliza mudanças no estado de algum quadro.
+    const StreamOptions *options;
+    Parallel binarize;		// Threads do estágio de limiarização e morfologia.
+    Parallel label;		// Threads do estágio de rotulação.
+    Labeler labeler;
+    LabelImage labels;
+    Image output;
+    uint8_t *colors;
+    Incremental incremental;	// Estado do modo incremental (usado apenas com options->incremental).
+    FILE *out;			// Fluxo de saída, ou NULL.
+    FILE *log;			// Onde são escritos os resultados de cada quadro.
+    Profile profile;		// Medidas agregadas dos quadros (atualizadas apenas pelo último estágio).
+    int failed;			// 1 após um erro em algum estágio; os quadros seguintes são descartados.
+} Stream;
+
+/** @brief waitFrame espera que o quadro k chegue ao estado dado e o retorna.
+  */
+static StreamFrame *waitFrame (Stream *stream, int k, int state) {
+    StreamFrame *frame = &stream->frames[k];
+    pthread_mutex_lock(&stream->lock);
+    while (frame->state != state) pthread_cond_wait(&stream->changed, &stream->lock);
+    pthread_mutex_unlock(&stream->lock);
+    return frame;
+}
+
+/** @brief passFrame passa um quadro ao estado dado, acordando o estágio que o espera.
+  */
+static void passFrame (Stream *stream, StreamFrame *frame, int state) {
+    pthread_mutex_lock(&stream->lock);
+    frame->state = state;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+/** @brief streamFailed retorna 1 se algum estágio falhou, marcando a falha se fail for 1.
+  */
+static int streamFailed (Stream *stream, int fail) {
+    pthread_mutex_lock(&stream->lock);
+    if (fail) stream->failed = 1;
+    int failed = stream->failed;
+    pthread_mutex_unlock(&stream->lock);
+    return failed;
+}
 
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            visited[h][w] = 0;              // Todos os visitados iniciados em 0.
-            int c = (unsigned char)fgetc(file2read);
-            matrix[h][w] = c;               // Armazenamos na memória o valor de um pixel.
-            hist[matrix[h][w]]++;           // Incrementamos a cor do pixel atual no histograma.
+/** @brief binarizeStage é o segundo estágio: limiariza cada quadro e aplica a abertura. O limiar é recalculado a cada
+  * options->interval quadros (nos demais, o histograma não é gerado) e suavizado por uma média móvel exponencial. Nos
+  * métodos locais, não há limiar global, e a limiarização e a abertura são etapas separadas. No modo incremental, apenas
+  * o limiar é calculado: a imagem binária é atualizada pelo último estágio, nos tiles alterados.
+  */
+static void *binarizeStage (void *arg) {
+    Stream *stream = (Stream*) arg;
+    const StreamOptions *options = stream->options;
+    StructuringElement cross = crossElement();
+    double level = -1;  // Limiar suavizado; negativo antes do primeiro quadro.
+
+    for (int k = 0; ; k = (k + 1) % STREAM_FRAMES) {
+        StreamFrame *frame = waitFrame(stream, k, FRAME_READ);
+        int last = frame->last;
+        if (!last && !streamFailed(stream, 0)) {
+            const Image *gray = &frame->gray;
+            int local = isLocalThreshold(options->thresholding.method);
+            if (!local && (level < 0 || frame->index % options->interval == 0)) {
+                int hist[256];
+                PROFILE_START(start);
+                parallelSampledHistogram(&stream->binarize, gray, options->thresholding.sampling, hist);
+                PROFILE_STOP(&frame->profile, PROFILE_HISTOGRAM, start);
+                PROFILE_START(otsu);
+                int t = globalThreshold(hist, &options->thresholding);
+                PROFILE_STOP(&frame->profile, PROFILE_OTSU, otsu);
+                level = level < 0 ? t : options->smoothing * t + (1 - options->smoothing) * level;
+            }
+            frame->threshold = local ? -1 : (int) (level + 0.5);
+            if (options->incremental) {
+                passFrame(stream, frame, FRAME_BINARY);
+                continue;
+            }
+            PROFILE_START(start);
+            int status = local ? parallelLocalThreshold(&stream->binarize, gray, &options->thresholding, &frame->mask)
+                               : 0;
+            if (status == 0) {
+                status = local ? parallelMorph(&stream->binarize, &frame->mask, &cross, MORPH_OPEN)
+                               : parallelBinarize(&stream->binarize, gray, frame->threshold, &frame->mask, &cross,
+                                                  MORPH_OPEN);
+            }
+            if (status != 0) {
+                fprintf(stderr, "Falha na morfologia do quadro %d\n", frame->index);
+                streamFailed(stream, 1);
+            }
+            PROFILE_STOP(&frame->profile, PROFILE_BINARIZE, start);
         }
+        passFrame(stream, frame, FRAME_BINARY);
+        if (last) return NULL;
     }
-    
-    int t = Threshold(hist);
-    printf("t = %d", t);
+}
 
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            if (matrix[h][w] < t) {           // Se o valor de um pixel for menor que o limiar, pintá-lo de preto.
-                matrix[h][w] = 0;
-            } else {                          // Se não, pintá-lo de branco.
-                matrix[h][w] = 255;
+/** @brief labelStage é o terceiro estágio: rotula e pinta cada quadro, escreve-o no fluxo de saída e informa a
+  * quantidade de componentes conexas. No modo incremental, o quadro é binarizado e rotulado apenas nos tiles que
+  * mudaram desde o anterior, e cada componente é pintada com a cor fixa de seu rótulo estável (ver stableColors), que
+  * não muda enquanto a componente não for alterada. O targetColor informado é o mesmo do modo normal (o de
+  * componentColors para a quantidade de componentes do quadro), para que os registros dos dois modos sejam comparáveis.
+  */
+static void *labelStage (void *arg) {
+    Stream *stream = (Stream*) arg;
+    for (int k = 0; ; k = (k + 1) % STREAM_FRAMES) {
+        StreamFrame *frame = waitFrame(stream, k, FRAME_BINARY);
+        int last = frame->last;
+        if (!last && !streamFailed(stream, 0)) {
+            ProfileFrame *profile = &frame->profile;
+            const LabelImage *labels = &stream->labels;
+            uint32_t maxLabel = 0;
+            int count;
+            if (stream->options->incremental) {
+                IncrementalResult result;
+                count = -1;
+                if (incrementalUpdate(&stream->incremental, &frame->gray, frame->threshold, NULL, 0, &result) == 0) {
+                    count = result.components;
+                    maxLabel = result.maxLabel;
+                    labels = result.labels;
+                }
+                addProfileFrame(profile, &stream->incremental.profile);
+            } else {
+                PROFILE_START(start);
+                count = parallelLabel(&stream->label, &stream->labeler, &frame->mask, CONNECTIVITY_4, &stream->labels,
+                                      NULL);
+                PROFILE_STOP(profile, PROFILE_LABEL, start);
+            }
+            PROFILE_START(paint);
+            int targetColor = count >= 0 ? componentColors(count, stream->colors) : 0;
+            if (count >= 0 && stream->options->incremental) stableColors(maxLabel, stream->colors);
+            if (count >= 0) paintLabels(labels, stream->colors, &stream->output);
+            PROFILE_STOP(profile, PROFILE_PAINT, paint);
+            // Cada quadro é enviado imediatamente, para que quem lê o fluxo não espere pelo buffer do arquivo.
+            PROFILE_START(write);
+            if (count < 0 || (stream->out != NULL &&
+                              (writePGMFrame(stream->out, &stream->output) != PGM_OK || fflush(stream->out) != 0))) {
+                fprintf(stderr, "Falha ao processar o quadro %d\n", frame->index);
+                streamFailed(stream, 1);
+            } else {
+                // Sem -w, nada é escrito, e a escrita não é medida.
+                if (stream->out != NULL) {
+                    PROFILE_STOP(profile, PROFILE_WRITE, write);
+                    PROFILE_ADD(profile, PROFILE_BYTES_WRITTEN, pgmFrameSize(&stream->output));
+                }
+                // O processamento de um quadro, como em pipelineProcess, vai do histograma à pintura.
+                PROFILE_ADD(profile, PROFILE_PROCESS, profile->value[PROFILE_HISTOGRAM] + profile->value[PROFILE_OTSU] +
+                            profile->value[PROFILE_BINARIZE] + profile->value[PROFILE_LABEL] +
+                            profile->value[PROFILE_PAINT]);
+                PROFILE_ADD(profile, PROFILE_COMPONENTS, count);
+                // No modo incremental, a tabela de equivalências de stream->label não é usada, e a medida, nunca
+                // registrada, fica fora do relatório (ver recordProfile).
+                if (!stream->options->incremental) PROFILE_PEAK(profile, PROFILE_LABELS, stream->label.labelsUsed);
+                recordProfile(&stream->profile, profile);
+                fprintf(stream->log, "quadro %d: t = %d, connectedComps = %d, targetColor = %d\n", frame->index,
+                        frame->threshold, count, targetColor);
+                fflush(stream->log);
             }
         }
+        passFrame(stream, frame, FRAME_FREE);
+        if (last) return NULL;
     }
+}
 
-    erode(matrix, visited);         // Realizamos uma erosão para limpar pixels "soltos" na imagem.
-    dilate(matrix, visited);        // Em seguida, uma dilatação, para preservar o tamanho dos elementos.
+/** @brief createStream aloca, uma única vez, todos os buffers do modo de vídeo para quadros de width x height pixels.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+static int createStream (Stream *stream, const StreamOptions *options, int width, int height) {
+    memset(stream, 0, sizeof(Stream));
+    stream->options = options;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+    if (createParallel(&stream->binarize, options->threads) != 0 ||
+        createParallel(&stream->label, options->threads) != 0) {
+        return -1;
+    }
+    size_t labels = parallelTableSize(&stream->label, width, height);
+    if (options->incremental) {
+        // Os rótulos do modo incremental vão até labelTableSize, com lacunas.
+        PipelineConfig config = defaultPipelineConfig(width, height);
+        config.thresholding = options->thresholding;
+        if (createIncremental(&stream->incremental, &config) != 0) return -1;
+        if (labelTableSize(width, height) > labels) labels = labelTableSize(width, height);
+    }
+    stream->colors = (uint8_t*) malloc(labels);
+    if (stream->colors == NULL || createLabelerWithCapacity(&stream->labeler, labels) != 0 ||
+        createLabelImage(&stream->labels, width, height) != 0 || createImage(&stream->output, width, height) != 0) {
+        return -1;
+    }
+    for (int k = 0; k < STREAM_FRAMES; k++) {
+        StreamFrame *frame = &stream->frames[k];
+        Image *gray = &frame->gray;
+        gray->data = (uint8_t*) malloc((size_t) width * (size_t) height);
+        if (gray->data == NULL || createBitplane(&frame->mask, width, height) != 0) return -1;
+        gray->width = gray->stride = width;
+        gray->height = height;
+        gray->capacity = (size_t) width * (size_t) height;
+    }
+    return 0;
+}
 
+/** @brief freeStream libera os buffers do modo de vídeo.
+  */
+static void freeStream (Stream *stream) {
+    for (int k = 0; k < STREAM_FRAMES; k++) {
+        freeImage(&stream->frames[k].gray);
+        freeBitplane(&stream->frames[k].mask);
+    }
+    freeImage(&stream->output);
+    freeLabelImage(&stream->labels);
+    freeLabeler(&stream->labeler);
+    free(stream->colors);
+    freeIncremental(&stream->incremental);
+    freeParallel(&stream->label);
+    freeParallel(&stream->binarize);
+    pthread_cond_destroy(&stream->changed);
+    pthread_mutex_destroy(&stream->lock);
+}
 
-    int connectedComps = 0;
+/** @brief A função runStream processa um fluxo contínuo de quadros lidos da entrada padrão (crus, com dimensões
+  * fixas, ou P5 concatenados, todos com as dimensões do primeiro). A leitura, a limiarização com morfologia e a
+  * rotulação com escrita são estágios de um pipeline, cada um em sua thread, que trocam quadros de um buffer circular
+  * alocado antes do primeiro quadro: nenhum estágio abre arquivos, aloca memória ou copia quadros inteiros.
+  * @return Retorna 0 se todo o fluxo foi processado, 1 caso contrário.
+  */
+int runStream (const StreamOptions *options) {
+    PgmStream input;
+    PgmHeader header;
+    openPGMStream(&input, STDIN_FILENO);
 
-    int originalMatrix [120][160];
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            originalMatrix[h][w] = matrix[h][w];
-            // Salvamos a matriz original, para que depois de contar o número de componentes conexas, possamos pintá-la
-            // na cor correta.
+    // As dimensões dos quadros P5 são as do primeiro cabeçalho.
+    int width = options->rawWidth;
+    int height = options->rawHeight;
+    int pending = 0;  // 1 se o cabeçalho do próximo quadro já foi lido.
+    if (width == 0) {
+        int status = readPGMStreamHeader(&input, &header);
+        if (status == PGM_END) return 0;
+        if (status != PGM_OK || header.maxval != 255) {
+            fprintf(stderr, "Falha ao ler o primeiro quadro: %s\n",
+                    status != PGM_OK ? pgmError(status) : "apenas P5 com maxval 255 e suportado");
+            return 1;
         }
+        width = header.width;
+        height = header.height;
+        pending = 1;
     }
 
-    int originalVisited[120][160];
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            originalVisited[h][w] = visited[h][w];
-            // Salvamos também a matriz de visitados, pelo mesmo motivo anterior.
-        }
+    Stream stream;
+    if (createStream(&stream, options, width, height) != 0) {
+        fprintf(stderr, "Falha ao alocar memoria para quadros %dx%d\n", width, height);
+        freeStream(&stream);
+        return 1;
     }
-
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            if (matrix[h][w] == 255 && !visited[h][w]) {    // Se o pixel atual for branco e não tiver sido visitado
-                connectedComps++;                           // aumentamos a contagem de componentes
-                floodFill(matrix, h, w, visited, 80);       // e preenchemos aquela componente com uma cor qualquer.
-            }
+    stream.log = stdout;
+    if (options->outPath != NULL) {
+        stream.out = strcmp(options->outPath, "-") == 0 ? stdout : fopen(options->outPath, "wb");
+        if (stream.out == stdout) stream.log = stderr;
+        if (stream.out == NULL) {
+            fprintf(stderr, "Falha ao abrir %s\n", options->outPath);
+            freeStream(&stream);
+            return 1;
         }
     }
 
-    // Esta é a cor da primeira componente conexa.
-    int targetColor = 40;
-    if (connectedComps == 0) {
-        connectedComps = 1;
+    pthread_t stages[2];
+    int started = 0;
+    if (pthread_create(&stages[0], NULL, binarizeStage, &stream) == 0) started++;
+    if (started == 1 && pthread_create(&stages[1], NULL, labelStage, &stream) == 0) started++;
+    if (started < 2) {
+        fprintf(stderr, "Falha ao criar as threads do pipeline\n");
+        streamFailed(&stream, 1);
+        if (started == 1) {
+            // O estágio já criado termina ao receber um quadro marcado como último.
+            StreamFrame *frame = waitFrame(&stream, 0, FRAME_FREE);
+            frame->last = 1;
+            passFrame(&stream, frame, FRAME_READ);
+            pthread_join(stages[0], NULL);
+        }
+        if (stream.out != NULL && stream.out != stdout) fclose(stream.out);
+        freeStream(&stream);
+        return 1;
     }
-    int rate = (255 - 40) / connectedComps;
-    // Este é o incremento de cor que é executado na pintura de uma componente para outra
 
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            if (originalMatrix[h][w] == 255 && !originalVisited[h][w]) {
-                if (targetColor >= 255) targetColor = 40;                      // Se a cor a ser pintada extrapolar o limite, resetar.
-                targetColor += rate;                                           // Cor da próxima componente conexa.
-                floodFill(originalMatrix, h, w, originalVisited, targetColor); // Pintamos a componente atual com targetColor.
+    // A leitura é o primeiro estágio, executado nesta thread. Um quadro marcado como último encerra os demais.
+    int error = 0;
+    for (int k = 0, index = 0; ; k = (k + 1) % STREAM_FRAMES, index++) {
+        StreamFrame *frame = waitFrame(&stream, k, FRAME_FREE);
+        resetProfileFrame(&frame->profile);
+        PROFILE_START(start);
+        int status = streamFailed(&stream, 0) ? PGM_END : PGM_OK;
+        if (status == PGM_OK && !pending && options->rawWidth == 0) {
+            status = readPGMStreamHeader(&input, &header);
+            if (status == PGM_OK && (header.width != width || header.height != height || header.maxval != 255)) {
+                fprintf(stderr, "Quadro %d com formato diferente do primeiro\n", index);
+                error = 1;
+                status = PGM_END;
             }
         }
+        pending = 0;
+        if (status == PGM_OK) {
+            status = readPGMStreamPixels(&input, frame->gray.data, (size_t) width * (size_t) height);
+            // Em P5, o cabeçalho já foi lido, então o fim do fluxo aqui significa um quadro truncado.
+            if (status == PGM_END && options->rawWidth == 0) status = PGM_ERR_FORMAT;
+        }
+        PROFILE_STOP(&frame->profile, PROFILE_READ, start);
+        PROFILE_ADD(&frame->profile, PROFILE_BYTES_READ, (size_t) width * (size_t) height);
+        if (status != PGM_OK && status != PGM_END) {
+            fprintf(stderr, "Falha ao ler o quadro %d: %s\n", index, pgmError(status));
+            error = 1;
+        }
+        frame->index = index;
+        frame->last = status != PGM_OK;
+        passFrame(&stream, frame, FRAME_READ);
+        if (frame->last) break;
     }
 
-    printf("\nconnectedComps = %d", connectedComps);
-    printf("\ntargetColor = %d", targetColor);
+    pthread_join(stages[0], NULL);
+    pthread_join(stages[1], NULL);
+    if (stream.failed) error = 1;
+    if (options->profilePath != NULL && writeProfile(options->profilePath, &stream.profile) != 0) {
+        fprintf(stderr, "Falha ao escrever %s\n", options->profilePath);
+        error = 1;
+    }
+    if (stream.out != NULL && stream.out != stdout && fclose(stream.out) != 0) error = 1;
+    freeStream(&stream);
+    return error;
+}
 
-    // Inicamos a escrita no arquivo de output do algoritmo.
-    fputs("P5\n", file2write);
-    fputs("160 120\n", file2write);
-    fputs("255\n", file2write);
+/*---------------------------------------------END VÍDEO----------------------------------------------*/
 
-    for (int h = 0; h < 120; h++) {
-        for (int w = 0; w < 160; w++) {
-            fputc(originalMatrix[h][w], file2write);
+/** @brief parseThreshold lê um método de limiarização na forma otsu, multi[:classes], bradley[:raio[:k]] ou
+  * sauvola[:raio[:k]].
+  * @return Retorna 0 em caso de sucesso, -1 caso o texto seja inválido.
+  */
+static int parseThreshold (const char *text, ThresholdConfig *config) {
+    static const char *names[] = {"otsu", "multi", "bradley", "sauvola"};
+    static const int methods[] = {THRESHOLD_OTSU, THRESHOLD_MULTI, THRESHOLD_BRADLEY, THRESHOLD_SAUVOLA};
+    for (int m = 0; m < 4; m++) {
+        size_t length = strlen(names[m]);
+        if (strncmp(text, names[m], length) != 0 || (text[length] != '\0' && text[length] != ':')) continue;
+        *config = defaultThresholdConfig(methods[m]);
+        const char *rest = text + length;
+        if (*rest == '\0') return 0;
+        char extra;
+        if (methods[m] == THRESHOLD_OTSU) return -1;
+        if (methods[m] == THRESHOLD_MULTI) {
+            if (sscanf(rest, ":%d%c", &config->classes, &extra) != 1) return -1;
+        } else {
+            int count = sscanf(rest, ":%d:%lf%c", &config->radius, &config->k, &extra);
+            if (count != 1 && count != 2) return -1;
         }
+        return validThresholdConfig(config) ? 0 : -1;
     }
+    return -1;
+}
 
-    fclose(file2read);
-    fclose(file2write);
-    return 0;
+/** @brief usage escreve as formas de uso do programa.
+  */
+static int usage (const char *program) {
+    fprintf(stderr, "Uso: %s [-s estatisticas.json|estatisticas.csv] [-j threads] [-p relatorio.json|relatorio.csv]\n"
+                    "        [-l metodo] [-a passo]\n"
+                    "     %s -o diretorio [-f json|csv] [-m pgm|rle] [-j threads] [-p relatorio.json|relatorio.csv]\n"
+                    "        [-l metodo] [-a passo] arquivo.pgm|diretorio|- ...\n"
+                    "     %s -v [-r larguraxaltura] [-t quadros] [-e alfa] [-w saida.pgm|-] [-j threads] [-i]\n"
+                    "        [-p relatorio.json|relatorio.csv] [-l metodo] [-a passo]\n"
+                    "Metodos: otsu, multi[:classes], bradley[:raio[:k]], sauvola[:raio[:k]]\n",
+            program, program, program);
+    return 1;
 }
 
-int main() {
-    runAlgorithm();
+/*
+ * Uso: main [-s estatisticas.json|estatisticas.csv] [-j threads] [-p relatorio.json|relatorio.csv] [-l metodo]
+ *              [-a passo]
+ *      main -o diretorio [-f json|csv] [-m pgm|rle] [-j threads] [-p relatorio.json|relatorio.csv]
+ *              [-l metodo] [-a passo] arquivo.pgm|diretorio|- ...
+ *      main -v [-r larguraxaltura] [-t quadros] [-e alfa] [-w saida.pgm|-] [-j threads] [-i]
+ *              [-p relatorio.json|relatorio.csv] [-l metodo] [-a passo]
+ * Sem -o, o caminho de uma imagem é lido interativamente e o resultado é escrito em out.pgm. Com -o (modo em lote),
+ * são processados os arquivos dados, todos os .pgm dos diretórios dados e, para "-", os caminhos lidos da entrada
+ * padrão, um por linha; cada resultado é escrito no diretório de saída, com o nome da imagem de entrada (e, com -f,
+ * as estatísticas com o mesmo nome e extensão .json ou .csv). Com -m rle, em vez da imagem pintada, as componentes
+ * são escritas no formato RLE (ver runs.h), com a extensão .rle. Por padrão, é usada uma thread por processador.
+ * Com -v (modo de vídeo), quadros são lidos continuamente da entrada padrão: P5 concatenados ou, com -r, pixels crus
+ * com as dimensões dadas. O resultado de cada quadro é escrito na saída padrão e, com -w, os quadros pintados são
+ * escritos como P5 concatenados (com "-", na saída padrão, e os resultados na saída de erro). Com -t, o limiar é
+ * recalculado apenas a cada tantos quadros; com -e, ele é suavizado por uma média móvel exponencial de peso alfa.
+ * Com -i (modo incremental, para câmeras fixas), cada quadro é comparado com o anterior, e apenas os tiles alterados
+ * são binarizados e rotulados novamente (ver incremental.h); um limiar global diferente do anterior refaz o quadro
+ * inteiro, então -t e -e evitam recálculos desnecessários. Nesse modo, cada componente é pintada com a cor fixa de seu
+ * rótulo, que se mantém entre os quadros enquanto ela não muda.
+ * Em todos os modos, -p escreve ao final o relatório da instrumentação das etapas (ver profile.h), em CSV se terminar em
+ * .csv e em JSON caso contrário.
+ * Em todos os modos, -l escolhe o método de limiarização (ver threshold.h): otsu (o padrão), multi[:classes] (Otsu
+ * multinível, com o foreground na classe mais clara), bradley[:raio[:k]] ou sauvola[:raio[:k]] (locais, para
+ * iluminação desigual; sem histograma, -t e -e não têm efeito). Com -a, o histograma dos métodos globais conta apenas
+ * as linhas e colunas múltiplas do passo dado, para um limiar aproximado em imagens grandes.
+*/
+int main(int argc, char **argv) {
+    const char *statsPath = NULL;
+    const char *outDir = NULL;
+    const char *statsFormat = NULL;
+    const char *profilePath = NULL;
+    int threads = defaultThreads();
+    int video = 0;
+    const char *outFormat = NULL;
+    ThresholdConfig thresholding = defaultThresholdConfig(THRESHOLD_OTSU);
+    int sampling = 1;
+    StreamOptions options = {0, 0, 1, 1.0, NULL, 1, NULL, thresholding, 0};
+    PathList inputs = {NULL, 0, 0};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc && parseThreshold(argv[i + 1], &thresholding) == 0) {
+            i++;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1 &&
+                   atoi(argv[i + 1]) <= THRESHOLD_MAX_SAMPLING) {
+            sampling = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "json") == 0 || strcmp(argv[i + 1], "csv") == 0)) {
+            statsFormat = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "pgm") == 0 || strcmp(argv[i + 1], "rle") == 0)) {
+            outFormat = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            video = 1;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%dx%d", &options.rawWidth, &options.rawHeight) == 2 &&
+                   options.rawWidth > 0 && options.rawHeight > 0) {
+            i++;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0 && atof(argv[i + 1]) <= 1) {
+            options.smoothing = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            options.outPath = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0) {
+            options.incremental = 1;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            if (addInput(&inputs, argv[i]) != 0) {
+                fprintf(stderr, "Falha ao ler %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    thresholding.sampling = sampling;
+    int streamOptions = options.rawWidth > 0 || options.interval != 1 || options.smoothing != 1.0 ||
+                        options.outPath != NULL || options.incremental;
+    if (video) {
+        if (outDir != NULL || statsPath != NULL || statsFormat != NULL || outFormat != NULL || inputs.count > 0) {
+            return usage(argv[0]);
+        }
+        options.threads = threads;
+        options.profilePath = profilePath;
+        options.thresholding = thresholding;
+        return runStream(&options);
+    }
+    if (streamOptions) return usage(argv[0]);
+    if (outDir == NULL) {
+        if (inputs.count > 0 || statsFormat != NULL || outFormat != NULL) return usage(argv[0]);
+        return runAlgorithm(statsPath, profilePath, &thresholding, threads);
+    }
+    if (statsPath != NULL) return usage(argv[0]);
+    int rle = outFormat != NULL && strcmp(outFormat, "rle") == 0;
+
+    int status = runBatch(&inputs, outDir, statsFormat, rle, profilePath, &thresholding, threads);
+    for (int i = 0; i < inputs.count; i++) free(inputs.paths[i]);
+    free(inputs.paths);
+    return status;
 }
@@ -0,0 +1,356 @@
+/*
+ * Arquivo: morph.c
+ *
+ * Descrição: Implementação das operações morfológicas bit-paralelas (ver morph.h).
+ *
+ * Toda operação é escrita como uma dilatação: para um pixel p, o resultado é o OR dos pixels p + s, para todo s
+ * coberto pelo elemento estruturante. A erosão é obtida pela mesma dilatação sobre o complemento da imagem (um pixel
+ * permanece branco apenas se nenhum vizinho for preto), complementando-se o resultado. Como pixels fora da imagem
+ * valem 0 no domínio em que a dilatação é feita, eles nunca alteram seus vizinhos, em nenhuma das duas operações.
+ *
+ * Cada operação é um estágio que recebe linhas em ordem, guarda em um buffer circular apenas as linhas que o elemento
+ * estruturante cobre, e produz a linha y assim que a linha y + bottom foi recebida. A abertura e o fechamento encadeiam
+ * dois estágios: cada linha produzida pelo primeiro é entregue imediatamente ao segundo. Em morphThresholdStrip, o
+ * primeiro estágio recebe as linhas recém-limiarizadas, e cada linha produzida pelo último é entregue a quem chama logo
+ * após ser escrita, enquanto ainda está no cache.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "morph.h"
+
+/*-------------------------------------INIT ELEMENTOS ESTRUTURANTES-------------------------------------*/
+
+StructuringElement crossElement (void) {
+    StructuringElement element = {3, 1, 1, {{-1, 0, 0}, {0, 1, 1}, {1, 0, 0}}};
+    return element;
+}
+
+StructuringElement squareElement (void) {
+    StructuringElement element = {3, 1, 1, {{-1, 1, 1}, {0, 1, 1}, {1, 1, 1}}};
+    return element;
+}
+
+int rectElement (int width, int height, StructuringElement *element) {
+    if (width < 1 || height < 1 || height > MORPH_MAX_ROWS) return -1;
+    element->rows = height;
+    element->top = (height - 1) / 2;
+    element->bottom = height / 2;
+    for (int i = 0; i < height; i++) {
+        element->spans[i].dy = i - element->top;
+        element->spans[i].left = (width - 1) / 2;
+        element->spans[i].right = width / 2;
+    }
+    return 0;
+}
+
+/** @brief reflectElement retorna o elemento refletido em relação ao pixel central (s passa a ser -s).
+  */
+static StructuringElement reflectElement (const StructuringElement *element) {
+    StructuringElement reflected = *element;
+    reflected.top = element->bottom;
+    reflected.bottom = element->top;
+    for (int i = 0; i < element->rows; i++) {
+        reflected.spans[i].dy = -element->spans[i].dy;
+        reflected.spans[i].left = element->spans[i].right;
+        reflected.spans[i].right = element->spans[i].left;
+    }
+    return reflected;
+}
+
+/*--------------------------------------END ELEMENTOS ESTRUTURANTES--------------------------------------*/
+
+/*-----------------------------------------INIT KERNELS DE LINHA-----------------------------------------*/
+
+/** @brief orShifted faz dst |= src deslocado de k pixels, ou seja, o pixel w de dst recebe o pixel w + k de src.
+  * Palavras fora da linha valem 0. Os laços não têm desvios por pixel, e são vetorizados pelo compilador.
+  * @param *dst Linha de destino.
+  * @param *src Linha de origem.
+  * @param words Quantidade de palavras por linha.
+  * @param k Deslocamento, em pixels (positivo: vizinho à direita; negativo: vizinho à esquerda).
+  */
+static void orShifted (uint64_t *restrict dst, const uint64_t *restrict src, int words, int k) {
+    int q = (k < 0 ? -k : k) >> 6;  // Deslocamento em palavras inteiras.
+    int b = (k < 0 ? -k : k) & 63;  // Deslocamento restante, em bits.
+    if (q >= words) return;
+
+    if (k >= 0) {
+        if (b == 0) {
+            for (int i = 0; i + q < words; i++) dst[i] |= src[i + q];
+        } else {
+            int i = 0;
+            for (; i + q + 1 < words; i++) dst[i] |= (src[i + q] >> b) | (src[i + q + 1] << (64 - b));
+            dst[i] |= src[i + q] >> b;
+        }
+    } else {
+        if (b == 0) {
+            for (int i = q; i < words; i++) dst[i] |= src[i - q];
+        } else {
+            dst[q] |= src[0] << b;
+            for (int i = q + 1; i < words; i++) dst[i] |= (src[i - q] << b) | (src[i - q - 1] >> (64 - b));
+        }
+    }
+}
+
+/*------------------------------------------END KERNELS DE LINHA------------------------------------------*/
+
+/*-------------------------------------------INIT ESTÁGIOS---------------------------------------------*/
+
+typedef struct MorphStage {
+    StructuringElement element;
+    int invert;         // 1 para a erosão (opera sobre o complemento), 0 para a dilatação.
+    int first;          // Primeira linha da janela processada.
+    int end;            // Linha seguinte à última da janela. Linhas fora da janela valem 0.
+    int words;          // Palavras por linha.
+    uint64_t lastMask;  // Bits válidos da última palavra de cada linha.
+    int ringRows;       // Linhas no buffer circular: top + bottom + 1.
+    uint64_t *ring;     // Últimas linhas recebidas (já complementadas, na erosão).
+    int next;           // Próxima linha a ser recebida.
+    int emitted;        // Próxima linha a ser produzida.
+} MorphStage;
+
+/** @brief stageInit prepara um estágio de erosão (invert = 1) ou dilatação (invert = 0) sobre as linhas first a
+  * end - 1, usando o buffer ring.
+  */
+static void stageInit (MorphStage *stage, const StructuringElement *element, int invert, const Bitplane *mask,
+                       int first, int end, uint64_t *ring) {
+    // A erosão usa o elemento como está; a dilatação usa o elemento refletido, para que a abertura e o fechamento
+    // correspondam às definições usuais também para elementos não simétricos.
+    stage->element = invert ? *element : reflectElement(element);
+    stage->invert = invert;
+    stage->first = first;
+    stage->end = end;
+    stage->words = mask->words;
+    stage->lastMask = (mask->width & 63) ? (((uint64_t) 1 << (mask->width & 63)) - 1) : ~(uint64_t) 0;
+    stage->ringRows = stage->element.top + stage->element.bottom + 1;
+    stage->ring = ring;
+    stage->next = first;
+    stage->emitted = first;
+}
+
+/** @brief stageSlot retorna a posição da linha y no buffer circular.
+  */
+static uint64_t *stageSlot (const MorphStage *stage, int y) {
+    return stage->ring + (size_t) ((y - stage->first) % stage->ringRows) * (size_t) stage->words;
+}
+
+/** @brief stageLoad guarda a próxima linha recebida no buffer circular.
+  */
+static void stageLoad (MorphStage *stage, const uint64_t *row) {
+    uint64_t *slot = stageSlot(stage, stage->next);
+    if (stage->invert) {
+        for (int i = 0; i < stage->words; i++) slot[i] = ~row[i];
+        slot[stage->words - 1] &= stage->lastMask;
+    } else {
+        memcpy(slot, row, (size_t) stage->words * sizeof(uint64_t));
+    }
+    stage->next++;
+}
+
+/** @brief stageReady indica se a próxima linha do estágio já pode ser produzida, ou seja, se todas as linhas que o
+  * elemento cobre abaixo dela já foram recebidas (ou estão fora da janela).
+  */
+static int stageReady (const MorphStage *stage) {
+    int y = stage->emitted;
+    return y < stage->end && (stage->next > y + stage->element.bottom || stage->next == stage->end);
+}
+
+/** @brief stageEmit produz a próxima linha do estágio em dst (ou apenas a descarta, se dst for NULL). dst pode ser a
+  * própria linha do bitplane, pois as linhas de entrada são lidas apenas do buffer circular.
+  */
+static void stageEmit (MorphStage *stage, uint64_t *dst) {
+    int y = stage->emitted++;
+    if (dst == NULL) return;
+    memset(dst, 0, (size_t) stage->words * sizeof(uint64_t));
+    for (int s = 0; s < stage->element.rows; s++) {
+        const MorphSpan *span = &stage->element.spans[s];
+        int ys = y + span->dy;
+        if (ys < stage->first || ys >= stage->end) continue;   // Linhas fora da janela valem 0.
+        const uint64_t *src = stageSlot(stage, ys);
+        for (int k = -span->left; k <= span->right; k++) orShifted(dst, src, stage->words, k);
+    }
+    if (stage->invert) {
+        for (int i = 0; i < stage->words; i++) dst[i] = ~dst[i];
+    }
+    dst[stage->words - 1] &= stage->lastMask;
+}
+
+/*
+ * Estado de uma execução: os estágios encadeados, as linhas intermediárias entre eles, e a faixa de linhas
+ * [rowStart, rowEnd) que o último estágio escreve no bitplane.
+*/
+typedef struct MorphRun {
+    MorphStage stages[2];
+    int count;
+    uint64_t *scratch;
+    Bitplane *mask;
+    int rowStart;
+    int rowEnd;
+    int first;          // Primeira e última + 1 linhas lidas (a faixa e seu halo).
+    int end;
+    uint64_t *buffer;   // Buffer de trabalho, alocado pela execução se quem chama não forneceu um.
+    int allocated;
+    MorphRowFn emit;    // Chamada para cada linha da faixa escrita no bitplane, ou NULL.
+    void *arg;
+} MorphRun;
+
+/** @brief pushRow entrega uma linha ao estágio index e, em cascata, propaga as linhas produzidas para os estágios
+  * seguintes. O último estágio escreve diretamente no bitplane, e descarta as linhas fora de sua faixa.
+  */
+static void pushRow (MorphRun *run, int index, const uint64_t *row) {
+    MorphStage *stage = &run->stages[index];
+    stageLoad(stage, row);
+    while (stageReady(stage)) {
+        if (index == run->count - 1) {
+            int y = stage->emitted;
+            int inside = y >= run->rowStart && y < run->rowEnd;
+            stageEmit(stage, inside ? bitplaneRow(run->mask, y) : NULL);
+            if (inside && run->emit != NULL) run->emit(run->arg, y);
+        } else {
+            uint64_t *out = run->scratch + (size_t) index * (size_t) run->mask->words;
+            stageEmit(stage, out);
+            pushRow(run, index + 1, out);
+        }
+    }
+}
+
+/** @brief operationStages descreve uma operação como uma sequência de estágios (1 para erosão, 0 para dilatação).
+  * @return Retorna a quantidade de estágios, ou 0 caso a operação seja inválida.
+  */
+static int operationStages (int operation, int *invert) {
+    switch (operation) {
+        case MORPH_ERODE:  invert[0] = 1; return 1;
+        case MORPH_DILATE: invert[0] = 0; return 1;
+        case MORPH_OPEN:   invert[0] = 1; invert[1] = 0; return 2;
+        case MORPH_CLOSE:  invert[0] = 0; invert[1] = 1; return 2;
+        default:           return 0;
+    }
+}
+
+/*--------------------------------------------END ESTÁGIOS---------------------------------------------*/
+
+int morphHalo (const StructuringElement *element, int operation, int *above, int *below) {
+    int invert[2];
+    int count = operationStages(operation, invert);
+    if (count == 0) return -1;
+    *above = *below = 0;
+    for (int s = 0; s < count; s++) {
+        // A dilatação usa o elemento refletido, que alcança acima o que o original alcança abaixo.
+        *above += invert[s] ? element->top : element->bottom;
+        *below += invert[s] ? element->bottom : element->top;
+    }
+    return 0;
+}
+
+size_t morphScratchWords (const StructuringElement *element, int operation, int words) {
+    int invert[2];
+    int count = operationStages(operation, invert);
+    // Os buffers circulares de todos os estágios, as linhas intermediárias entre eles e a linha de entrada de
+    // morphThresholdStrip.
+    size_t ringRows = (size_t) (element->top + element->bottom + 1);
+    return (ringRows * (size_t) count + (size_t) count) * (size_t) words;
+}
+
+/** @brief startRun prepara uma execução de uma operação sobre as linhas rowStart a rowEnd - 1 e seu halo.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou os parâmetros sejam inválidos.
+  */
+static int startRun (MorphRun *run, Bitplane *mask, const StructuringElement *element, int operation, int rowStart,
+                     int rowEnd, uint64_t *scratch) {
+    int invert[2];
+    int count = operationStages(operation, invert);
+    if (count == 0 || element->rows < 1 || element->rows > MORPH_MAX_ROWS) return -1;
+    if (rowStart < 0 || rowEnd > mask->height || rowStart >= rowEnd) return -1;
+
+    int haloAbove = 0, haloBelow = 0;
+    morphHalo(element, operation, &haloAbove, &haloBelow);
+    int aboveRows = haloAbove < rowStart ? haloAbove : rowStart;
+    int belowRows = haloBelow < mask->height - rowEnd ? haloBelow : mask->height - rowEnd;
+
+    // Um único bloco guarda os buffers circulares de todos os estágios, as linhas intermediárias entre eles e a linha
+    // de entrada.
+    size_t ringRows = (size_t) (element->top + element->bottom + 1);
+    run->buffer = scratch;
+    run->allocated = scratch == NULL;
+    if (run->buffer == NULL) {
+        run->buffer = (uint64_t*) malloc(morphScratchWords(element, operation, mask->words) * sizeof(uint64_t));
+        if (run->buffer == NULL) return -1;
+    }
+
+    run->count = count;
+    run->mask = mask;
+    run->rowStart = rowStart;
+    run->rowEnd = rowEnd;
+    run->first = rowStart - aboveRows;
+    run->end = rowEnd + belowRows;
+    run->emit = NULL;
+    run->arg = NULL;
+    for (int s = 0; s < count; s++) {
+        stageInit(&run->stages[s], element, invert[s], mask, run->first, run->end,
+                  run->buffer + (size_t) s * ringRows * (size_t) mask->words);
+    }
+    run->scratch = run->buffer + (size_t) count * ringRows * (size_t) mask->words;
+    return 0;
+}
+
+/** @brief endRun libera o buffer de trabalho, se a execução o alocou.
+  */
+static void endRun (MorphRun *run) {
+    if (run->allocated) free(run->buffer);
+}
+
+int morphStrip (Bitplane *mask, const StructuringElement *element, int operation, int rowStart, int rowEnd,
+                const uint64_t *above, const uint64_t *below, uint64_t *scratch) {
+    MorphRun run;
+    if (startRun(&run, mask, element, operation, rowStart, rowEnd, scratch) != 0) return -1;
+    for (int h = run.first; h < run.end; h++) {
+        // As linhas da faixa são lidas do bitplane antes de serem sobrescritas: o último estágio só escreve linhas já
+        // copiadas para o primeiro. As linhas vizinhas à faixa vêm das cópias above e below.
+        const uint64_t *row;
+        if (h < rowStart) {
+            row = above + (size_t) (h - run.first) * (size_t) mask->words;
+        } else if (h >= rowEnd) {
+            row = below + (size_t) (h - rowEnd) * (size_t) mask->words;
+        } else {
+            row = bitplaneRow(mask, h);
+        }
+        pushRow(&run, 0, row);
+    }
+    endRun(&run);
+    return 0;
+}
+
+int morphThresholdStrip (const Image *gray, int threshold, Bitplane *mask, const StructuringElement *element,
+                         int operation, int rowStart, int rowEnd, uint64_t *scratch, MorphRowFn emit, void *arg) {
+    if (gray->width != mask->width || gray->height != mask->height) return -1;
+    MorphRun run;
+    if (startRun(&run, mask, element, operation, rowStart, rowEnd, scratch) != 0) return -1;
+    run.emit = emit;
+    run.arg = arg;
+    // Cada linha, inclusive as do halo, é limiarizada diretamente da imagem em tons de cinza para a linha de entrada,
+    // logo antes de ser entregue ao primeiro estágio: o bitplane só é escrito pelo último.
+    uint64_t *input = run.scratch + (size_t) (run.count - 1) * (size_t) mask->words;
+    for (int h = run.first; h < run.end; h++) {
+        thresholdRow(imageRow(gray, h), gray->width, threshold, input);
+        pushRow(&run, 0, input);
+    }
+    endRun(&run);
+    return 0;
+}
+
+int morphErode (Bitplane *mask, const StructuringElement *element) {
+    return morphStrip(mask, element, MORPH_ERODE, 0, mask->height, NULL, NULL, NULL);
+}
+
+int morphDilate (Bitplane *mask, const StructuringElement *element) {
+    return morphStrip(mask, element, MORPH_DILATE, 0, mask->height, NULL, NULL, NULL);
+}
+
+int morphOpen (Bitplane *mask, const StructuringElement *element) {
+    return morphStrip(mask, element, MORPH_OPEN, 0, mask->height, NULL, NULL, NULL);
+}
+
+int morphClose (Bitplane *mask, const StructuringElement *element) {
+    return morphStrip(mask, element, MORPH_CLOSE, 0, mask->height, NULL, NULL, NULL);
+}
@@ -0,0 +1,165 @@
+/*
+ * Arquivo: morph.h
+ *
+ * Descrição: Operações morfológicas (erosão, dilatação, abertura e fechamento) sobre imagens binárias (Bitplane).
+ * As operações são bit-paralelas: cada instrução processa uma palavra de 64 pixels, usando deslocamentos, AND e OR
+ * entre palavras, sem verificações de limite por pixel. A imagem é percorrida uma linha por vez e alterada no próprio
+ * lugar; apenas as linhas cobertas pelo elemento estruturante são guardadas, em um buffer circular, de forma que
+ * nenhuma cópia da imagem inteira é feita.
+ *
+ * Pixels fora da imagem são ignorados: na erosão, não apagam seus vizinhos; na dilatação, não pintam seus vizinhos.
+*/
+
+#ifndef MORPH_H
+#define MORPH_H
+
+#include "image.h"
+
+#define MORPH_MAX_ROWS 63 // Altura máxima de um elemento estruturante.
+
+// Operações aceitas por morphHalo e morphStrip.
+#define MORPH_ERODE  0
+#define MORPH_DILATE 1
+#define MORPH_OPEN   2  // Erosão seguida de dilatação.
+#define MORPH_CLOSE  3  // Dilatação seguida de erosão.
+
+/*
+ * Uma linha de um elemento estruturante: cobre, na linha dy (relativa ao pixel central), as colunas de -left a right.
+*/
+typedef struct MorphSpan {
+    int dy;
+    int left;
+    int right;
+} MorphSpan;
+
+/*
+ * Um elemento estruturante é descrito por suas linhas. top e bottom são, respectivamente, a maior distância acima e
+ * abaixo do pixel central coberta por alguma linha.
+*/
+typedef struct StructuringElement {
+    int rows;                           // Quantidade de linhas em spans.
+    int top;
+    int bottom;
+    MorphSpan spans[MORPH_MAX_ROWS];
+} StructuringElement;
+
+/** @brief A função crossElement retorna o elemento estruturante em cruz 3x3 (o pixel e seus vizinhos em cima, em
+  * baixo, à esquerda e à direita).
+  */
+StructuringElement crossElement (void);
+
+/** @brief A função squareElement retorna o elemento estruturante quadrado 3x3 (o pixel e seus 8 vizinhos).
+  */
+StructuringElement squareElement (void);
+
+/** @brief A função rectElement retorna um elemento estruturante retangular de width x height pixels. Para dimensões
+  * pares, o pixel central é o da esquerda/de cima entre os dois centrais.
+  * @param width Largura do retângulo (no mínimo 1).
+  * @param height Altura do retângulo (de 1 a MORPH_MAX_ROWS).
+  * @param *element Elemento retornado por referência.
+  * @return Retorna 0 em caso de sucesso, -1 caso as dimensões sejam inválidas.
+  */
+int rectElement (int width, int height, StructuringElement *element);
+
+/** @brief A função morphErode aplica uma transformação de erosão na imagem: um pixel branco permanece branco apenas
+  * se todos os pixels cobertos pelo elemento estruturante forem brancos. Com a cruz 3x3, por exemplo:
+  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0
+  *                 1 0 0 1 1 0 0               0 0 0 0 0 0 0
+  *                 0 0 1 1 1 1 0     ---->     0 0 0 1 1 0 0
+  *                 0 0 1 1 1 1 0               0 0 0 1 1 0 0
+  *                 0 0 0 1 1 0 0               0 0 0 0 0 0 0
+  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0
+  * @param *mask Imagem binária, alterada no próprio lugar.
+  * @param *element Elemento estruturante.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int morphErode (Bitplane *mask, const StructuringElement *element);
+
+/** @brief A função morphDilate é análoga à morphErode, fazendo, porém, o contrário: um pixel fica branco se algum
+  * pixel coberto pelo elemento estruturante for branco. Com a cruz 3x3, por exemplo:
+  *                 0 0 0 0 0 0 0               1 0 0 0 0 0 0
+  *                 1 0 0 0 0 0 0               1 1 0 1 1 0 0
+  *                 0 0 0 1 1 0 0     ---->     1 0 1 1 1 1 0
+  *                 0 0 0 1 1 0 0               0 0 1 1 1 1 0
+  *                 0 0 0 0 0 0 0               0 0 0 1 1 0 0
+  *                 0 0 0 0 0 0 0               0 0 0 0 0 0 0
+  * @param *mask Imagem binária, alterada no próprio lugar.
+  * @param *element Elemento estruturante.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int morphDilate (Bitplane *mask, const StructuringElement *element);
+
+/** @brief A função morphOpen executa uma erosão seguida de uma dilatação, em uma única passada sobre a imagem: cada
+  * linha erodida é passada imediatamente à dilatação. Remove pixels "soltos" preservando o tamanho dos objetos.
+  * @param *mask Imagem binária, alterada no próprio lugar.
+  * @param *element Elemento estruturante.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int morphOpen (Bitplane *mask, const StructuringElement *element);
+
+/** @brief A função morphClose executa uma dilatação seguida de uma erosão, em uma única passada sobre a imagem.
+  * Preenche pequenos buracos preservando o tamanho dos objetos.
+  * @param *mask Imagem binária, alterada no próprio lugar.
+  * @param *element Elemento estruturante.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int morphClose (Bitplane *mask, const StructuringElement *element);
+
+/** @brief A função morphHalo retorna quantas linhas acima e abaixo de uma faixa uma operação precisa ler para
+  * produzir a faixa (a soma do alcance vertical de cada um de seus estágios).
+  * @param *element Elemento estruturante.
+  * @param operation MORPH_ERODE, MORPH_DILATE, MORPH_OPEN ou MORPH_CLOSE.
+  * @param *above Linhas necessárias acima da faixa, retornadas por referência.
+  * @param *below Linhas necessárias abaixo da faixa, retornadas por referência.
+  * @return Retorna 0 em caso de sucesso, -1 caso a operação seja inválida.
+  */
+int morphHalo (const StructuringElement *element, int operation, int *above, int *below);
+
+/** @brief A função morphScratchWords retorna o tamanho, em palavras, do buffer de trabalho usado por morphStrip e
+  * morphThresholdStrip para uma operação sobre um bitplane com words palavras por linha.
+  */
+size_t morphScratchWords (const StructuringElement *element, int operation, int words);
+
+/** @brief A função morphStrip aplica uma operação apenas às linhas rowStart a rowEnd - 1 da imagem. As linhas
+  * vizinhas à faixa (o halo, ver morphHalo) são lidas de cópias feitas previamente, e não do bitplane, de forma que
+  * várias faixas da mesma imagem podem ser processadas ao mesmo tempo, por threads diferentes. O resultado é idêntico
+  * ao da operação aplicada à imagem inteira.
+  * @param *mask Imagem binária, alterada no próprio lugar, apenas nas linhas da faixa.
+  * @param *element Elemento estruturante.
+  * @param operation MORPH_ERODE, MORPH_DILATE, MORPH_OPEN ou MORPH_CLOSE.
+  * @param rowStart Primeira linha da faixa.
+  * @param rowEnd Linha seguinte à última da faixa.
+  * @param *above Cópia das min(halo acima, rowStart) linhas anteriores à faixa, em ordem, ou NULL se não houver.
+  * @param *below Cópia das min(halo abaixo, altura - rowEnd) linhas seguintes à faixa, em ordem, ou NULL se não houver.
+  * @param *scratch Buffer de trabalho com ao menos morphScratchWords palavras, ou NULL para que a função aloque um.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou os parâmetros sejam inválidos.
+  */
+int morphStrip (Bitplane *mask, const StructuringElement *element, int operation, int rowStart, int rowEnd,
+                const uint64_t *above, const uint64_t *below, uint64_t *scratch);
+
+/*
+ * Função chamada por morphThresholdStrip para cada linha da faixa, logo após ela ser escrita no bitplane, em ordem.
+*/
+typedef void (*MorphRowFn) (void *arg, int row);
+
+/** @brief A função morphThresholdStrip limiariza a imagem e aplica uma operação morfológica em uma única passada, sobre
+  * as linhas rowStart a rowEnd - 1: cada linha da imagem (inclusive as do halo, ver morphHalo) é limiarizada para uma
+  * linha de trabalho e entregue diretamente ao primeiro estágio, de forma que a imagem binária sem a operação nunca é
+  * escrita na memória. O halo é lido da imagem em tons de cinza, que não é alterada, então faixas diferentes podem ser
+  * processadas ao mesmo tempo sem cópias prévias. O resultado é idêntico ao de thresholdRows seguida de morphStrip.
+  * @param *gray Imagem em tons de cinza.
+  * @param threshold Limiar (ver thresholdRows).
+  * @param *mask Imagem binária, com as mesmas dimensões de gray, escrita apenas nas linhas da faixa.
+  * @param *element Elemento estruturante.
+  * @param operation MORPH_ERODE, MORPH_DILATE, MORPH_OPEN ou MORPH_CLOSE.
+  * @param rowStart Primeira linha da faixa.
+  * @param rowEnd Linha seguinte à última da faixa.
+  * @param *scratch Buffer de trabalho com ao menos morphScratchWords palavras, ou NULL para que a função aloque um.
+  * @param emit Chamada para cada linha da faixa assim que ela é escrita (por exemplo, para rotulá-la), ou NULL.
+  * @param *arg Argumento repassado a emit.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou os parâmetros sejam inválidos.
+  */
+int morphThresholdStrip (const Image *gray, int threshold, Bitplane *mask, const StructuringElement *element,
+                         int operation, int rowStart, int rowEnd, uint64_t *scratch, MorphRowFn emit, void *arg);
+
+#endif
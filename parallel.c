@@ -0,0 +1,494 @@
+/*
+ * Arquivo: parallel.c
+ *
+ * Descrição: Implementação das etapas paralelas do algoritmo (ver parallel.h).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+/*
+ * Argumentos compartilhados pelas tarefas de uma etapa. Cada tarefa processa a faixa de número igual ao seu.
+*/
+typedef struct StripJob {
+    Parallel *parallel;
+    int strips;
+    int height;
+    const Image *image;
+    Bitplane *mask;
+    int threshold;
+    int step;                   // Passo da grade do histograma.
+    const ThresholdConfig *thresholding;
+    const StructuringElement *element;
+    int operation;
+    int above;                  // Halo acima e abaixo de cada faixa, na morfologia.
+    int below;
+    size_t stripWords;          // Palavras da área de cada faixa no buffer da morfologia (halo e buffer de trabalho).
+    Labeler *labeler;
+    LabelImage *labels;
+    int connectivity;
+    int withStats;
+} StripJob;
+
+/** @brief stripCount retorna em quantas faixas uma imagem de height linhas é dividida.
+  */
+static int stripCount (const Parallel *parallel, int height) {
+    return parallel->strips < height ? parallel->strips : height;
+}
+
+/** @brief stripsFailed junta, após poolRun, as falhas registradas por cada faixa em parallel->failed.
+  * @return Retorna 1 se alguma das strips faixas falhou, 0 caso contrário.
+  */
+static int stripsFailed (const Parallel *parallel, int strips) {
+    int failed = 0;
+    for (int k = 0; k < strips; k++) failed |= parallel->failed[k];
+    return failed;
+}
+
+/** @brief stripStart retorna a primeira linha da faixa k (ou, para k = strips, a altura da imagem).
+  */
+static int stripStart (int height, int strips, int k) {
+    return (int) ((int64_t) height * k / strips);
+}
+
+int createParallel (Parallel *parallel, int threads) {
+    if (threads < 1) threads = 1;
+    memset(parallel, 0, sizeof(Parallel));
+    if (createPool(&parallel->pool, threads) != 0) return -1;
+    parallel->strips = parallel->pool.threads;
+
+    int strips = parallel->strips;
+    parallel->hist = (int (*)[256]) malloc((size_t) strips * sizeof(*parallel->hist));
+    parallel->ranges = (uint32_t*) malloc((size_t) strips * 2 * sizeof(uint32_t));
+    parallel->offsets = (uint32_t*) malloc((size_t) strips * sizeof(uint32_t));
+    parallel->failed = (int*) malloc((size_t) strips * sizeof(int));
+    if (parallel->hist == NULL || parallel->ranges == NULL || parallel->offsets == NULL || parallel->failed == NULL) {
+        freeParallel(parallel);
+        return -1;
+    }
+    return 0;
+}
+
+void freeParallel (Parallel *parallel) {
+    freePool(&parallel->pool);
+    if (!parallel->external) {
+        free(parallel->window);
+        free(parallel->stats);
+        free(parallel->morph);
+    }
+    free(parallel->failed);
+    free(parallel->offsets);
+    free(parallel->ranges);
+    free(parallel->hist);
+    memset(parallel, 0, sizeof(Parallel));
+}
+
+void attachParallel (Parallel *parallel, uint64_t *morph, size_t morphCapacity, ComponentStats *stats,
+                     size_t statsCapacity, uint32_t *window, size_t windowCapacity) {
+    parallel->morph = morph;
+    parallel->morphCapacity = morphCapacity;
+    parallel->stats = stats;
+    parallel->statsCapacity = statsCapacity;
+    parallel->window = window;
+    parallel->windowCapacity = window != NULL ? windowCapacity : 0;
+    parallel->external = 1;
+}
+
+size_t parallelWindowWords (const Parallel *parallel, int width) {
+    return (size_t) parallel->strips * localThresholdWords(width);
+}
+
+size_t parallelMorphWords (const Parallel *parallel, const StructuringElement *element, int operation, int width) {
+    int above, below;
+    if (morphHalo(element, operation, &above, &below) != 0) return 0;
+    int words = (width + 63) / 64;
+    return (size_t) parallel->strips *
+           ((size_t) (above + below) * (size_t) words + morphScratchWords(element, operation, words));
+}
+
+size_t parallelTableSize (const Parallel *parallel, int width, int height) {
+    // Cada faixa pode usar até stripTableSize rótulos provisórios, mais o rótulo 0 (fundo).
+    int strips = stripCount(parallel, height);
+    size_t size = 1;
+    for (int k = 0; k < strips; k++) {
+        size += stripTableSize(width, stripStart(height, strips, k + 1) - stripStart(height, strips, k));
+    }
+    return size;
+}
+
+/*-------------------------------------INIT HISTOGRAMA E LIMIARIZAÇÃO-------------------------------------*/
+
+static void histogramTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    int *hist = job->parallel->hist[k];
+    memset(hist, 0, 256 * sizeof(int));
+    sampledHistogramRows(job->image, stripStart(job->height, job->strips, k),
+                         stripStart(job->height, job->strips, k + 1), job->step, hist);
+}
+
+void parallelHistogram (Parallel *parallel, const Image *image, int *hist) {
+    parallelSampledHistogram(parallel, image, 1, hist);
+}
+
+void parallelSampledHistogram (Parallel *parallel, const Image *image, int step, int *hist) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.image = image;
+    job.step = step;
+    job.height = image->height;
+    job.strips = stripCount(parallel, image->height);
+    poolRun(&parallel->pool, job.strips, histogramTask, &job);
+
+    // Os histogramas das faixas são somados em ordem.
+    for (int i = 0; i < 256; i++) hist[i] = 0;
+    for (int k = 0; k < job.strips; k++) {
+        for (int i = 0; i < 256; i++) hist[i] += parallel->hist[k][i];
+    }
+}
+
+static void thresholdTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    thresholdRows(job->image, job->threshold, job->mask, stripStart(job->height, job->strips, k),
+                  stripStart(job->height, job->strips, k + 1));
+}
+
+void parallelThreshold (Parallel *parallel, const Image *image, int threshold, Bitplane *mask) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.image = image;
+    job.mask = mask;
+    job.threshold = threshold;
+    job.height = image->height;
+    job.strips = stripCount(parallel, image->height);
+    poolRun(&parallel->pool, job.strips, thresholdTask, &job);
+}
+
+static void localThresholdTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    uint32_t *scratch = job->parallel->window + (size_t) k * localThresholdWords(job->image->width);
+    job->parallel->failed[k] = localThresholdRows(job->image, job->thresholding, job->mask,
+                                                  stripStart(job->height, job->strips, k),
+                                                  stripStart(job->height, job->strips, k + 1), scratch) != 0;
+}
+
+int parallelLocalThreshold (Parallel *parallel, const Image *image, const ThresholdConfig *config, Bitplane *mask) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.image = image;
+    job.mask = mask;
+    job.thresholding = config;
+    job.height = image->height;
+    job.strips = stripCount(parallel, image->height);
+
+    // Cada faixa tem suas somas de janela, em um buffer que, como o da morfologia, só cresce.
+    size_t needed = (size_t) job.strips * localThresholdWords(image->width);
+    if (needed > parallel->windowCapacity) {
+        if (parallel->external) return -1;
+        uint32_t *buffer = (uint32_t*) malloc(needed * sizeof(uint32_t));
+        if (buffer == NULL) return -1;
+        free(parallel->window);
+        parallel->window = buffer;
+        parallel->windowCapacity = needed;
+    }
+    poolRun(&parallel->pool, job.strips, localThresholdTask, &job);
+    return stripsFailed(parallel, job.strips) ? -1 : 0;
+}
+
+/*--------------------------------------END HISTOGRAMA E LIMIARIZAÇÃO--------------------------------------*/
+
+/*--------------------------------------------INIT MORFOLOGIA--------------------------------------------*/
+
+/** @brief stripHalo retorna quantas linhas do halo acima e abaixo da faixa k existem de fato na imagem.
+  */
+static void stripHalo (const StripJob *job, int k, int *above, int *below) {
+    int start = stripStart(job->height, job->strips, k);
+    int end = stripStart(job->height, job->strips, k + 1);
+    *above = job->above < start ? job->above : start;
+    *below = job->below < job->height - end ? job->below : job->height - end;
+}
+
+/** @brief haloSlot retorna o início da área da faixa k no buffer da morfologia: as linhas de halo de cima, seguidas
+  * das de baixo e do buffer de trabalho de morphStrip.
+  */
+static uint64_t *haloSlot (const StripJob *job, int k) {
+    return job->parallel->morph + (size_t) k * job->stripWords;
+}
+
+/** @brief reserveMorph garante que o buffer da morfologia tenha ao menos needed palavras. Ele só cresce, de forma que
+  * nenhuma memória é alocada a cada imagem.
+  */
+static int reserveMorph (Parallel *parallel, size_t needed) {
+    if (needed <= parallel->morphCapacity) return 0;
+    if (parallel->external) return -1;
+    uint64_t *buffer = (uint64_t*) malloc(needed * sizeof(uint64_t));
+    if (buffer == NULL) return -1;
+    free(parallel->morph);
+    parallel->morph = buffer;
+    parallel->morphCapacity = needed;
+    return 0;
+}
+
+static void copyHaloTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    int above, below;
+    stripHalo(job, k, &above, &below);
+    int start = stripStart(job->height, job->strips, k);
+    int end = stripStart(job->height, job->strips, k + 1);
+    size_t words = (size_t) job->mask->words;
+    uint64_t *slot = haloSlot(job, k);
+    // As linhas de cada halo são contíguas no bitplane, e podem ser copiadas de uma só vez.
+    if (above > 0) memcpy(slot, bitplaneRow(job->mask, start - above), (size_t) above * words * sizeof(uint64_t));
+    if (below > 0) memcpy(slot + (size_t) above * words, bitplaneRow(job->mask, end),
+                          (size_t) below * words * sizeof(uint64_t));
+}
+
+static void morphTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    int above, below;
+    stripHalo(job, k, &above, &below);
+    uint64_t *slot = haloSlot(job, k);
+    size_t words = (size_t) job->mask->words;
+    int status = morphStrip(job->mask, job->element, job->operation, stripStart(job->height, job->strips, k),
+                            stripStart(job->height, job->strips, k + 1), above > 0 ? slot : NULL,
+                            below > 0 ? slot + (size_t) above * words : NULL,
+                            slot + (size_t) (job->above + job->below) * words);
+    job->parallel->failed[k] = status != 0;
+}
+
+int parallelMorph (Parallel *parallel, Bitplane *mask, const StructuringElement *element, int operation) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.mask = mask;
+    job.element = element;
+    job.operation = operation;
+    job.height = mask->height;
+    job.strips = stripCount(parallel, mask->height);
+    if (morphHalo(element, operation, &job.above, &job.below) != 0) return -1;
+
+    // Cada faixa tem sua área no buffer da morfologia.
+    job.stripWords = (size_t) (job.above + job.below) * (size_t) mask->words +
+                     morphScratchWords(element, operation, mask->words);
+    if (reserveMorph(parallel, (size_t) job.strips * job.stripWords) != 0) return -1;
+    if (job.strips == 1) {
+        return morphStrip(mask, element, operation, 0, mask->height, NULL, NULL,
+                          parallel->morph + (size_t) (job.above + job.below) * (size_t) mask->words);
+    }
+
+    // Primeiro copiamos os halos de todas as faixas e, só depois, alteramos as faixas, pois o halo de uma faixa
+    // pertence às faixas vizinhas.
+    poolRun(&parallel->pool, job.strips, copyHaloTask, &job);
+    poolRun(&parallel->pool, job.strips, morphTask, &job);
+    return stripsFailed(parallel, job.strips) ? -1 : 0;
+}
+
+/*---------------------------------------------END MORFOLOGIA---------------------------------------------*/
+
+/*--------------------------------------------INIT ROTULAÇÃO--------------------------------------------*/
+
+static void labelTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    uint32_t *range = job->parallel->ranges + 2 * k;
+    range[1] = labelStrip(job->labeler, job->mask, job->connectivity, job->labels,
+                          stripStart(job->height, job->strips, k), stripStart(job->height, job->strips, k + 1),
+                          range[0]);
+}
+
+/** @brief reserveStripStats garante espaço para as estatísticas de count rótulos provisórios, somando todas as faixas.
+  */
+static int reserveStripStats (Parallel *parallel, size_t count) {
+    if (count <= parallel->statsCapacity) return 0;
+    if (parallel->external) return -1;
+    size_t capacity = parallel->statsCapacity > 0 ? parallel->statsCapacity : 64;
+    while (capacity < count) capacity *= 2;
+    ComponentStats *stats = (ComponentStats*) realloc(parallel->stats, capacity * sizeof(ComponentStats));
+    if (stats == NULL) return -1;
+    parallel->stats = stats;
+    parallel->statsCapacity = capacity;
+    return 0;
+}
+
+static void relabelTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    Parallel *parallel = job->parallel;
+    const uint32_t *range = parallel->ranges + 2 * k;
+    ComponentStats *stats = NULL;
+    uint32_t statsBase = 0;
+    if (job->withStats && job->strips == 1) {
+        // Com uma única faixa, as estatísticas são acumuladas diretamente por rótulo final.
+        stats = job->labeler->stats;
+    } else if (job->withStats) {
+        // Com várias, cada faixa acumula as estatísticas dos seus rótulos provisórios em sua parte do vetor.
+        stats = parallel->stats + parallel->offsets[k];
+        statsBase = range[0];
+        for (uint32_t r = range[0]; r < range[1]; r++) resetComponentStats(&stats[r - range[0]]);
+    }
+    relabelStrip(job->labeler, job->mask, job->labels, stripStart(job->height, job->strips, k),
+                 stripStart(job->height, job->strips, k + 1), stats, statsBase);
+}
+
+/** @brief startLabel valida os parâmetros de uma rotulação e reparte os rótulos provisórios entre as faixas.
+  * @return Retorna 0 em caso de sucesso, -1 caso os parâmetros sejam inválidos.
+  */
+static int startLabel (StripJob *job, Parallel *parallel, Labeler *labeler, const Bitplane *mask, int connectivity,
+                       LabelImage *labels) {
+    int width = mask->width;
+    int height = mask->height;
+    if (labels->width != width || labels->height != height) return -1;
+    if (connectivity != CONNECTIVITY_4 && connectivity != CONNECTIVITY_8) return -1;
+    if (labeler->capacity < parallelTableSize(parallel, width, height)) return -1;
+
+    job->parallel = parallel;
+    job->mask = (Bitplane*) mask;
+    job->labeler = labeler;
+    job->labels = labels;
+    job->connectivity = connectivity;
+    job->height = height;
+    job->strips = stripCount(parallel, height);
+
+    // Os rótulos provisórios de cada faixa começam após o maior que a faixa anterior pode usar, de forma que são
+    // crescentes de cima para baixo, como na rotulação serial.
+    uint32_t base = 1;
+    for (int k = 0; k < job->strips; k++) {
+        parallel->ranges[2 * k] = base;
+        base += (uint32_t) stripTableSize(width, stripStart(height, job->strips, k + 1) -
+                                                 stripStart(height, job->strips, k));
+    }
+    return 0;
+}
+
+int parallelLabel (Parallel *parallel, Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                   ComponentStats **stats) {
+    StripJob job = {0};
+    if (startLabel(&job, parallel, labeler, mask, connectivity, labels) != 0) return -1;
+    poolRun(&parallel->pool, job.strips, labelTask, &job);
+    return parallelResolveLabels(parallel, labeler, mask, connectivity, labels, stats);
+}
+
+int parallelResolveLabels (Parallel *parallel, Labeler *labeler, const Bitplane *mask, int connectivity,
+                           LabelImage *labels, ComponentStats **stats) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.mask = (Bitplane*) mask;
+    job.labeler = labeler;
+    job.labels = labels;
+    job.connectivity = connectivity;
+    job.height = mask->height;
+    job.strips = stripCount(parallel, mask->height);
+    job.withStats = stats != NULL;
+
+    for (int k = 1; k < job.strips; k++) {
+        mergeStripBorder(labeler, labels, connectivity, stripStart(job.height, job.strips, k));
+    }
+    uint32_t count = resolveLabels(labeler, parallel->ranges, job.strips);
+
+    uint32_t used = 0;
+    for (int k = 0; k < job.strips; k++) {
+        parallel->offsets[k] = used;
+        used += parallel->ranges[2 * k + 1] - parallel->ranges[2 * k];
+    }
+    parallel->labelsUsed = used;
+    if (job.withStats) {
+        if (job.strips > 1 && reserveStripStats(parallel, used) != 0) return -1;
+        if (reserveStats(labeler, (size_t) count + 1) != 0) return -1;
+        for (uint32_t i = 0; i <= count; i++) resetComponentStats(&labeler->stats[i]);
+    }
+    poolRun(&parallel->pool, job.strips, relabelTask, &job);
+
+    if (job.withStats && job.strips > 1) {
+        // As estatísticas de cada rótulo provisório são somadas às do seu rótulo final.
+        for (int k = 0; k < job.strips; k++) {
+            const uint32_t *range = parallel->ranges + 2 * k;
+            const ComponentStats *strip = parallel->stats + parallel->offsets[k];
+            for (uint32_t r = range[0]; r < range[1]; r++) {
+                mergeComponentStats(&labeler->stats[labeler->parent[r]], &strip[r - range[0]]);
+            }
+        }
+    }
+    if (job.withStats) *stats = labeler->stats;
+    return (int) count;
+}
+
+/*---------------------------------------------END ROTULAÇÃO---------------------------------------------*/
+
+/*---------------------------------------------INIT FUSÃO---------------------------------------------*/
+
+/*
+ * Estado da primeira passada da rotulação de uma faixa, feita linha a linha durante a binarização.
+*/
+typedef struct FusedStrip {
+    StripJob *job;
+    int start;          // Primeira linha da faixa.
+    uint32_t next;      // Próximo rótulo provisório da faixa.
+} FusedStrip;
+
+/** @brief labelEmittedRow rotula uma linha assim que a morfologia a escreve no bitplane (ver MorphRowFn).
+  */
+static void labelEmittedRow (void *arg, int row) {
+    FusedStrip *strip = (FusedStrip*) arg;
+    StripJob *job = strip->job;
+    strip->next = labelStripRows(job->labeler, job->mask, job->connectivity, job->labels, strip->start, row, row + 1,
+                                 strip->next);
+}
+
+static void binarizeTask (void *arg, int k, int thread) {
+    (void) thread;
+    StripJob *job = (StripJob*) arg;
+    FusedStrip strip;
+    strip.job = job;
+    strip.start = stripStart(job->height, job->strips, k);
+    strip.next = job->labeler != NULL ? job->parallel->ranges[2 * k] : 0;
+    int status = morphThresholdStrip(job->image, job->threshold, job->mask, job->element, job->operation, strip.start,
+                                     stripStart(job->height, job->strips, k + 1), haloSlot(job, k),
+                                     job->labeler != NULL ? labelEmittedRow : NULL, &strip);
+    job->parallel->failed[k] = status != 0;
+    if (job->labeler != NULL) job->parallel->ranges[2 * k + 1] = strip.next;
+}
+
+/** @brief binarizeStrips executa a passada fundida em todas as faixas de uma etapa já preparada.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou a operação seja inválida.
+  */
+static int binarizeStrips (StripJob *job, const Image *gray, int threshold, const StructuringElement *element,
+                           int operation) {
+    Parallel *parallel = job->parallel;
+    if (gray->width != job->mask->width || gray->height != job->mask->height) return -1;
+    if (morphHalo(element, operation, &job->above, &job->below) != 0) return -1;
+    job->image = gray;
+    job->threshold = threshold;
+    job->element = element;
+    job->operation = operation;
+    // O halo de cada faixa é limiarizado da imagem em tons de cinza, então cada faixa só precisa de seu buffer de
+    // trabalho.
+    job->stripWords = morphScratchWords(element, operation, job->mask->words);
+    if (reserveMorph(parallel, (size_t) job->strips * job->stripWords) != 0) return -1;
+    poolRun(&parallel->pool, job->strips, binarizeTask, job);
+    return stripsFailed(parallel, job->strips) ? -1 : 0;
+}
+
+int parallelBinarize (Parallel *parallel, const Image *gray, int threshold, Bitplane *mask,
+                      const StructuringElement *element, int operation) {
+    StripJob job = {0};
+    job.parallel = parallel;
+    job.mask = mask;
+    job.height = mask->height;
+    job.strips = stripCount(parallel, mask->height);
+    return binarizeStrips(&job, gray, threshold, element, operation);
+}
+
+int parallelBinarizeLabel (Parallel *parallel, Labeler *labeler, const Image *gray, int threshold, Bitplane *mask,
+                           const StructuringElement *element, int operation, int connectivity, LabelImage *labels) {
+    StripJob job = {0};
+    if (startLabel(&job, parallel, labeler, mask, connectivity, labels) != 0) return -1;
+    return binarizeStrips(&job, gray, threshold, element, operation);
+}
+
+/*----------------------------------------------END FUSÃO----------------------------------------------*/
@@ -0,0 +1,147 @@
+/*
+ * Arquivo: parallel.h
+ *
+ * Descrição: Versões paralelas das etapas do algoritmo (histograma, limiarização, morfologia e rotulação). A imagem é
+ * dividida em faixas horizontais, uma por thread, processadas por um thread pool (ver pool.h):
+ *  - histograma: cada faixa gera seu próprio histograma (ver sampledHistogramRows), e os histogramas são somados ao
+ *    final;
+ *  - limiarização: cada faixa escreve apenas as suas linhas do bitplane (na local, com suas próprias somas de janela);
+ *  - morfologia: as linhas vizinhas a cada faixa (halo) são copiadas antes da operação, que é então aplicada a todas
+ *    as faixas ao mesmo tempo;
+ *  - rotulação: cada faixa é rotulada com uma faixa disjunta de rótulos provisórios, as equivalências entre a última
+ *    linha de uma faixa e a primeira da seguinte são unidas, e os rótulos finais são atribuídos em paralelo.
+ * Em todas as etapas, o resultado é idêntico ao da versão serial.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdint.h>
+
+#include "components.h"
+#include "image.h"
+#include "label.h"
+#include "morph.h"
+#include "pool.h"
+#include "threshold.h"
+
+/*
+ * Estado da execução paralela: o pool e os buffers por faixa, reaproveitados entre imagens.
+*/
+typedef struct Parallel {
+    Pool pool;
+    int strips;                     // Quantidade máxima de faixas (igual à de threads).
+    int (*hist)[256];               // Histograma de cada faixa.
+    uint32_t *ranges;               // Rótulos provisórios [início, fim) de cada faixa.
+    uint32_t *offsets;              // Posição, em stats, das estatísticas de cada faixa.
+    int *failed;                    // 1 se a tarefa da faixa falhou na última etapa (cada faixa escreve apenas a sua).
+    uint64_t *morph;                // Linhas vizinhas (halo) e buffer de trabalho de cada faixa, na morfologia.
+    size_t morphCapacity;           // Capacidade de morph, em palavras.
+    ComponentStats *stats;          // Estatísticas de cada rótulo provisório, faixa após faixa.
+    size_t statsCapacity;           // Capacidade de stats.
+    uint32_t *window;               // Somas das janelas de cada faixa, na limiarização local.
+    size_t windowCapacity;          // Capacidade de window, em palavras.
+    int external;                   // 1 se morph, stats e window pertencem a quem chama (ver attachParallel).
+    size_t labelsUsed;              // Rótulos provisórios usados na última rotulação, somando todas as faixas.
+} Parallel;
+
+/** @brief A função createParallel cria o pool e os buffers para a quantidade de threads dada.
+  * @param threads Quantidade de threads (no mínimo 1; com 1, tudo é executado na thread que chama).
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou não seja possível criar as threads.
+  */
+int createParallel (Parallel *parallel, int threads);
+
+/** @brief A função freeParallel termina as threads e libera os buffers.
+  */
+void freeParallel (Parallel *parallel);
+
+/** @brief A função attachParallel faz com que os buffers que dependem do tamanho das imagens (o da morfologia, o das
+  * estatísticas por faixa e o da limiarização local) sejam os fornecidos por quem chama, por exemplo a partir de uma
+  * arena. Eles não são realocados nem liberados: uma etapa que precise de mais espaço falha.
+  * @param *morph Buffer da morfologia, com ao menos parallelMorphWords palavras para as maiores imagens.
+  * @param *stats Estatísticas por rótulo provisório (usadas apenas com mais de uma faixa), ou NULL.
+  * @param *window Buffer da limiarização local, com ao menos parallelWindowWords palavras, ou NULL se ela não for usada.
+  */
+void attachParallel (Parallel *parallel, uint64_t *morph, size_t morphCapacity, ComponentStats *stats,
+                     size_t statsCapacity, uint32_t *window, size_t windowCapacity);
+
+/** @brief A função parallelWindowWords retorna o tamanho, em palavras, do buffer usado por parallelLocalThreshold
+  * para imagens de até width pixels de largura.
+  */
+size_t parallelWindowWords (const Parallel *parallel, int width);
+
+/** @brief A função parallelMorphWords retorna o tamanho, em palavras, do buffer usado por parallelMorph para uma
+  * operação sobre imagens de até width pixels de largura.
+  */
+size_t parallelMorphWords (const Parallel *parallel, const StructuringElement *element, int operation, int width);
+
+/** @brief A função parallelTableSize retorna a capacidade de tabela de equivalências necessária para parallelLabel
+  * rotular uma imagem de width x height pixels (ver createLabelerWithCapacity).
+  */
+size_t parallelTableSize (const Parallel *parallel, int width, int height);
+
+/** @brief A função parallelHistogram gera o histograma da imagem.
+  * @param *hist Histograma com 256 posições, retornado por referência.
+  */
+void parallelHistogram (Parallel *parallel, const Image *image, int *hist);
+
+/** @brief A função parallelSampledHistogram gera o histograma dos pixels da grade de passo step (ver
+  * sampledHistogramRows); com step = 1, equivale a parallelHistogram.
+  */
+void parallelSampledHistogram (Parallel *parallel, const Image *image, int step, int *hist);
+
+/** @brief A função parallelThreshold gera a imagem binária (ver thresholdRows).
+  */
+void parallelThreshold (Parallel *parallel, const Image *image, int threshold, Bitplane *mask);
+
+/** @brief A função parallelLocalThreshold gera a imagem binária por um método local (ver localThresholdRows).
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou a configuração seja inválida.
+  */
+int parallelLocalThreshold (Parallel *parallel, const Image *image, const ThresholdConfig *config, Bitplane *mask);
+
+/** @brief A função parallelMorph aplica uma operação morfológica à imagem binária.
+  * @param operation MORPH_ERODE, MORPH_DILATE, MORPH_OPEN ou MORPH_CLOSE.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou a operação seja inválida.
+  */
+int parallelMorph (Parallel *parallel, Bitplane *mask, const StructuringElement *element, int operation);
+
+/** @brief A função parallelLabel é a versão paralela de labelComponents. O labeler deve ter sido criado com
+  * capacidade de ao menos parallelTableSize.
+  * @return Retorna a quantidade de componentes conexas, ou -1 em caso de erro.
+  */
+int parallelLabel (Parallel *parallel, Labeler *labeler, const Bitplane *mask, int connectivity, LabelImage *labels,
+                   ComponentStats **stats);
+
+/** @brief A função parallelResolveLabels conclui uma rotulação cuja primeira passada já foi feita em todas as faixas
+  * (por parallelBinarizeLabel): une as faixas, atribui os rótulos finais e, se stats não for NULL, acumula as
+  * estatísticas, como parallelLabel.
+  * @return Retorna a quantidade de componentes conexas, ou -1 em caso de erro.
+  */
+int parallelResolveLabels (Parallel *parallel, Labeler *labeler, const Bitplane *mask, int connectivity,
+                           LabelImage *labels, ComponentStats **stats);
+
+/*
+ * Etapas fundidas: em cada faixa, a limiarização, a operação morfológica e, opcionalmente, a primeira passada da
+ * rotulação são feitas em uma única passada sobre as linhas (ver morphThresholdStrip). Cada linha é limiarizada para
+ * um buffer de trabalho, passa pelos estágios da morfologia e é rotulada assim que é escrita no bitplane, de forma
+ * que a imagem em tons de cinza é lida uma vez e o bitplane e a imagem de rótulos são escritos uma vez, sem a cópia
+ * dos halos entre faixas. Os resultados são idênticos aos das etapas separadas.
+*/
+
+/** @brief A função parallelBinarize equivale a parallelThreshold seguida de parallelMorph, em uma única passada.
+  * @param *mask Imagem binária, com as mesmas dimensões de gray.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou os parâmetros sejam inválidos.
+  */
+int parallelBinarize (Parallel *parallel, const Image *gray, int threshold, Bitplane *mask,
+                      const StructuringElement *element, int operation);
+
+/** @brief A função parallelBinarizeLabel é análoga à parallelBinarize, fazendo também a primeira passada da rotulação
+  * de cada linha assim que ela é produzida. A rotulação é concluída por parallelResolveLabels, com os mesmos mask,
+  * connectivity e labels.
+  * @param *labels Imagem de rótulos, com as mesmas dimensões de gray.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória ou os parâmetros sejam inválidos.
+  */
+int parallelBinarizeLabel (Parallel *parallel, Labeler *labeler, const Image *gray, int threshold, Bitplane *mask,
+                           const StructuringElement *element, int operation, int connectivity, LabelImage *labels);
+
+#endif
@@ -0,0 +1,374 @@
+/*
+ * Arquivo: pgm.c
+ *
+ * Descrição: Implementação da leitura e escrita de arquivos PGM (ver pgm.h).
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pgm.h"
+
+/*-------------------------------------------INIT CABEÇALHO--------------------------------------------*/
+
+/** @brief isSpace determina se um byte é um dos caracteres de espaço aceitos pelo formato PGM.
+  */
+static int isSpace (unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/** @brief isDigit determina se um byte é um dígito decimal.
+  */
+static int isDigit (unsigned char c) {
+    return (unsigned) (c - '0') < 10u;
+}
+
+/** @brief skipSpaceAndComments avança *pos sobre espaços e comentários (de '#' até o fim da linha).
+  */
+static void skipSpaceAndComments (const unsigned char *data, size_t length, size_t *pos) {
+    while (*pos < length) {
+        unsigned char c = data[*pos];
+        if (isSpace(c)) {
+            (*pos)++;
+        } else if (c == '#') {
+            while (*pos < length && data[*pos] != '\n' && data[*pos] != '\r') (*pos)++;
+        } else {
+            break;
+        }
+    }
+}
+
+/** @brief readHeaderInt lê um inteiro não negativo do cabeçalho, ignorando espaços e comentários antes dele.
+  * @return Retorna 0 em caso de sucesso, -1 caso não haja um inteiro válido nessa posição.
+  */
+static int readHeaderInt (const unsigned char *data, size_t length, size_t *pos, int *value) {
+    skipSpaceAndComments(data, length, pos);
+    if (*pos >= length || !isDigit(data[*pos])) return -1;
+    long v = 0;
+    while (*pos < length && isDigit(data[*pos])) {
+        v = v * 10 + (data[*pos] - '0');
+        if (v > INT_MAX) return -1;
+        (*pos)++;
+    }
+    *value = (int) v;
+    return 0;
+}
+
+int parsePGMHeader (const unsigned char *data, size_t length, PgmHeader *header) {
+    if (length < 2 || data[0] != 'P' || (data[1] != '2' && data[1] != '5')) return PGM_ERR_FORMAT;
+    size_t pos = 2;
+
+    header->format = data[1] - '0';
+    if (readHeaderInt(data, length, &pos, &header->width) != 0 ||
+        readHeaderInt(data, length, &pos, &header->height) != 0 ||
+        readHeaderInt(data, length, &pos, &header->maxval) != 0) {
+        return PGM_ERR_FORMAT;
+    }
+    if (header->width <= 0 || header->height <= 0 || header->maxval <= 0 || header->maxval > 65535) {
+        return PGM_ERR_FORMAT;
+    }
+    if ((size_t) header->width > SIZE_MAX / 2 / (size_t) header->height) return PGM_ERR_FORMAT;
+
+    // Após o maxval há exatamente um caractere de espaço antes dos pixels. Em P2 o arquivo pode terminar aqui.
+    if (pos < length) {
+        if (!isSpace(data[pos])) return PGM_ERR_FORMAT;
+        pos++;
+    } else if (header->format == 5) {
+        return PGM_ERR_FORMAT;
+    }
+    header->dataOffset = pos;
+    return PGM_OK;
+}
+
+/*--------------------------------------------END CABEÇALHO--------------------------------------------*/
+
+/*--------------------------------------------INIT LEITURA---------------------------------------------*/
+
+int mapPGM (const char *path, PgmMap *map) {
+    map->base = NULL;
+    map->length = 0;
+    map->pixels = NULL;
+    map->pixelBytes = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return PGM_ERR_OPEN;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return PGM_ERR_OPEN;
+    }
+    if (st.st_size <= 0) {
+        close(fd);
+        return PGM_ERR_FORMAT;
+    }
+
+    size_t length = (size_t) st.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // O mapeamento continua válido após fechar o descritor.
+    if (base == MAP_FAILED) return PGM_ERR_OPEN;
+    posix_madvise(base, length, POSIX_MADV_SEQUENTIAL);
+
+    int status = parsePGMHeader((const unsigned char*) base, length, &map->header);
+    if (status != PGM_OK) {
+        munmap(base, length);
+        return status;
+    }
+    map->base = base;
+    map->length = length;
+    map->pixels = (const unsigned char*) base + map->header.dataOffset;
+    map->pixelBytes = length - map->header.dataOffset;
+    return PGM_OK;
+}
+
+void unmapPGM (PgmMap *map) {
+    if (map->base != NULL) munmap(map->base, map->length);
+    map->base = NULL;
+    map->length = 0;
+    map->pixels = NULL;
+    map->pixelBytes = 0;
+}
+
+/** @brief scaleSample converte um valor na faixa 0..maxval para a faixa 0..255, com arredondamento. Valores acima
+  * de maxval são saturados.
+  */
+static int scaleSample (int value, int maxval) {
+    if (value > maxval) value = maxval;
+    return (int) (((long) value * 255 + maxval / 2) / maxval);
+}
+
+/** @brief readP5 converte os pixels binários de um mapeamento para a imagem.
+  */
+static int readP5 (const PgmMap *map, Image *image) {
+    const PgmHeader *header = &map->header;
+    size_t bytesPerSample = header->maxval > 255 ? 2 : 1;
+    size_t rowBytes = (size_t) header->width * bytesPerSample;
+
+    for (int h = 0; h < header->height; h++) {
+        const unsigned char *src = map->pixels + (size_t) h * rowBytes;
+        uint8_t *row = imageRow(image, h);
+        if (header->maxval == 255) {
+            memcpy(row, src, rowBytes);
+        } else if (bytesPerSample == 1) {
+            for (int w = 0; w < header->width; w++) row[w] = (uint8_t) scaleSample(src[w], header->maxval);
+        } else {
+            // Amostras de 16 bits são armazenadas com o byte mais significativo primeiro.
+            for (int w = 0; w < header->width; w++) {
+                row[w] = (uint8_t) scaleSample((src[2*w] << 8) | src[2*w + 1], header->maxval);
+            }
+        }
+    }
+    return PGM_OK;
+}
+
+/** @brief readP2 interpreta os pixels em ASCII de um mapeamento. Cada número é lido diretamente dos bytes do
+  * arquivo, sem passar por scanf ou strtol.
+  */
+static int readP2 (const PgmMap *map, Image *image) {
+    const unsigned char *data = map->pixels;
+    size_t length = map->pixelBytes;
+    size_t pos = 0;
+    int maxval = map->header.maxval;
+
+    for (int h = 0; h < image->height; h++) {
+        uint8_t *row = imageRow(image, h);
+        for (int w = 0; w < image->width; w++) {
+            while (pos < length && !isDigit(data[pos])) {
+                if (data[pos] == '#') {
+                    skipSpaceAndComments(data, length, &pos);
+                } else if (isSpace(data[pos])) {
+                    pos++;
+                } else {
+                    return PGM_ERR_FORMAT; // Caractere inesperado (por exemplo, um sinal negativo).
+                }
+            }
+            if (pos >= length) return PGM_ERR_FORMAT; // Arquivo truncado.
+            int value = 0;
+            while (pos < length && isDigit(data[pos])) {
+                if (value <= 65535) value = value * 10 + (data[pos] - '0');
+                pos++;
+            }
+            row[w] = (uint8_t) (maxval == 255 ? (value > 255 ? 255 : value) : scaleSample(value, maxval));
+        }
+    }
+    return PGM_OK;
+}
+
+int viewPGM (const PgmMap *map, Image *image) {
+    const PgmHeader *header = &map->header;
+    if (header->format != 5 || header->maxval != 255) return PGM_ERR_FORMAT;
+    if (map->pixelBytes / (size_t) header->width < (size_t) header->height) return PGM_ERR_FORMAT;
+
+    image->width = header->width;
+    image->height = header->height;
+    image->stride = header->width;
+    image->data = (uint8_t*) map->pixels; // Somente leitura: o mapeamento é feito com PROT_READ.
+    image->capacity = 0;
+    return PGM_OK;
+}
+
+/** @brief pixelsFit indica se os pixels de um mapeamento podem conter a imagem do cabeçalho: em P5, todas as linhas
+  * completas; em P2, ao menos um dígito por pixel. Assim, um arquivo truncado (ou com dimensões falsas no cabeçalho)
+  * é recusado antes que a imagem seja alocada.
+  */
+static int pixelsFit (const PgmMap *map) {
+    const PgmHeader *header = &map->header;
+    size_t rowBytes = (size_t) header->width * (header->format == 5 && header->maxval > 255 ? 2 : 1);
+    return map->pixelBytes / rowBytes >= (size_t) header->height;
+}
+
+int decodePGM (const PgmMap *map, Image *image) {
+    if (!pixelsFit(map)) return PGM_ERR_FORMAT; // Arquivo truncado.
+    if (createImage(image, map->header.width, map->header.height) != 0) return PGM_ERR_MEMORY;
+    int status = map->header.format == 5 ? readP5(map, image) : readP2(map, image);
+    if (status != PGM_OK) freeImage(image);
+    return status;
+}
+
+int decodePGMInto (const PgmMap *map, Image *image) {
+    if (!pixelsFit(map)) return PGM_ERR_FORMAT;
+    if (resizeImage(image, map->header.width, map->header.height) != 0) return PGM_ERR_MEMORY;
+    return map->header.format == 5 ? readP5(map, image) : readP2(map, image);
+}
+
+int readPGM (const char *path, Image *image) {
+    PgmMap map;
+    int status = mapPGM(path, &map);
+    if (status != PGM_OK) return status;
+    status = decodePGM(&map, image);
+    unmapPGM(&map);
+    return status;
+}
+
+/*---------------------------------------------END LEITURA---------------------------------------------*/
+
+/*--------------------------------------------INIT ESCRITA---------------------------------------------*/
+
+int writePGMFrame (FILE *file, const Image *image) {
+    if (fprintf(file, "P5\n%d %d\n255\n", image->width, image->height) < 0) return PGM_ERR_IO;
+    if (image->stride == image->width) {
+        // Linhas contíguas: todos os pixels são escritos de uma só vez.
+        size_t size = (size_t) image->width * (size_t) image->height;
+        if (fwrite(image->data, 1, size, file) != size) return PGM_ERR_IO;
+        return PGM_OK;
+    }
+    // Caso contrário, cada linha é escrita no buffer do arquivo, sem cópia auxiliar da imagem.
+    for (int h = 0; h < image->height; h++) {
+        if (fwrite(imageRow(image, h), 1, (size_t) image->width, file) != (size_t) image->width) return PGM_ERR_IO;
+    }
+    return PGM_OK;
+}
+
+size_t pgmFrameSize (const Image *image) {
+    int header = snprintf(NULL, 0, "P5\n%d %d\n255\n", image->width, image->height);
+    return (size_t) header + (size_t) image->width * (size_t) image->height;
+}
+
+int writePGM (const char *path, const Image *image) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return PGM_ERR_OPEN;
+    int status = writePGMFrame(file, image);
+    if (fclose(file) != 0) status = PGM_ERR_IO;
+    return status;
+}
+
+/*---------------------------------------------END ESCRITA---------------------------------------------*/
+
+/*---------------------------------------------INIT FLUXO----------------------------------------------*/
+
+void openPGMStream (PgmStream *stream, int fd) {
+    stream->fd = fd;
+    stream->pos = stream->length = 0;
+    stream->eof = stream->error = 0;
+}
+
+/** @brief fillStream move os bytes ainda não consumidos para o início do buffer e lê mais bytes do descritor.
+  * @return Retorna a quantidade de bytes lidos (0 no fim do fluxo ou em caso de erro).
+  */
+static size_t fillStream (PgmStream *stream) {
+    if (stream->pos > 0) {
+        memmove(stream->buffer, stream->buffer + stream->pos, stream->length - stream->pos);
+        stream->length -= stream->pos;
+        stream->pos = 0;
+    }
+    while (!stream->eof && stream->length < PGM_STREAM_BUFFER) {
+        ssize_t count = read(stream->fd, stream->buffer + stream->length, PGM_STREAM_BUFFER - stream->length);
+        if (count > 0) {
+            stream->length += (size_t) count;
+            return (size_t) count;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) stream->error = 1;
+        stream->eof = 1;
+    }
+    return 0;
+}
+
+int readPGMStreamHeader (PgmStream *stream, PgmHeader *header) {
+    for (;;) {
+        while (stream->pos < stream->length && isSpace(stream->buffer[stream->pos])) stream->pos++;
+        if (stream->pos < stream->length) {
+            if (stream->buffer[stream->pos] != 'P') return PGM_ERR_FORMAT;
+            // Um cabeçalho P5 completo termina com um espaço após o maxval. Se o buffer terminar antes disso,
+            // parsePGMHeader falha, e tentamos de novo com mais bytes.
+            int status = parsePGMHeader(stream->buffer + stream->pos, stream->length - stream->pos, header);
+            if (status == PGM_OK && header->format != 5) return PGM_ERR_FORMAT;
+            if (status == PGM_OK) {
+                stream->pos += header->dataOffset;
+                return PGM_OK;
+            }
+            if (stream->pos == 0 && stream->length == PGM_STREAM_BUFFER) return PGM_ERR_FORMAT;
+        }
+        if (fillStream(stream) == 0) {
+            if (stream->error) return PGM_ERR_IO;
+            return stream->pos < stream->length ? PGM_ERR_FORMAT : PGM_END;
+        }
+    }
+}
+
+int readPGMStreamPixels (PgmStream *stream, uint8_t *dst, size_t bytes) {
+    // Primeiro os bytes que já estão no buffer; o restante é lido diretamente para o destino.
+    size_t done = stream->length - stream->pos < bytes ? stream->length - stream->pos : bytes;
+    memcpy(dst, stream->buffer + stream->pos, done);
+    stream->pos += done;
+    while (done < bytes) {
+        ssize_t count = read(stream->fd, dst + done, bytes - done);
+        if (count > 0) {
+            done += (size_t) count;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            stream->eof = 1;
+            if (count < 0) {
+                stream->error = 1;
+                return PGM_ERR_IO;
+            }
+            return done == 0 ? PGM_END : PGM_ERR_FORMAT;
+        }
+    }
+    return PGM_OK;
+}
+
+/*----------------------------------------------END FLUXO----------------------------------------------*/
+
+const char *pgmError (int code) {
+    switch (code) {
+        case PGM_OK:         return "sucesso";
+        case PGM_ERR_OPEN:   return "falha ao abrir o arquivo";
+        case PGM_ERR_FORMAT: return "arquivo PGM invalido ou truncado";
+        case PGM_ERR_MEMORY: return "memoria insuficiente";
+        case PGM_ERR_IO:     return "falha de leitura ou escrita";
+        case PGM_END:        return "fim do fluxo";
+        default:             return "erro desconhecido";
+    }
+}
@@ -0,0 +1,159 @@
+/*
+ * Arquivo: pgm.h
+ *
+ * Descrição: Leitura e escrita de imagens PGM (Portable GrayMap). São suportados os formatos ASCII (P2) e binário (P5),
+ * qualquer valor máximo (maxval) entre 1 e 65535, e comentários (linhas iniciadas por '#') no cabeçalho. O arquivo é
+ * lido através de mmap, sem chamadas de leitura por pixel, e a escrita é feita com um único fwrite.
+ *
+ * Também é possível ler uma sequência de quadros de um descritor (por exemplo, a entrada padrão ligada a uma câmera),
+ * seja como arquivos P5 concatenados, seja como pixels crus (PgmStream).
+*/
+
+#ifndef PGM_H
+#define PGM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "image.h"
+
+/*
+ * Códigos de retorno das funções deste módulo. PGM_OK indica sucesso; os demais são negativos, e sua descrição pode ser
+ * obtida com pgmError.
+*/
+#define PGM_OK           0
+#define PGM_ERR_OPEN    -1  // Não foi possível abrir ou mapear o arquivo.
+#define PGM_ERR_FORMAT  -2  // Cabeçalho inválido, formato não suportado ou arquivo truncado.
+#define PGM_ERR_MEMORY  -3  // Falta de memória.
+#define PGM_ERR_IO      -4  // Falha de leitura ou escrita.
+#define PGM_END          1  // Fim de um fluxo de quadros, antes do primeiro byte do próximo quadro (não é um erro).
+
+#define PGM_STREAM_BUFFER 4096 // Tamanho do buffer usado para ler os cabeçalhos de um fluxo.
+
+typedef struct PgmHeader {
+    int format;         // 2 para P2 (ASCII), 5 para P5 (binário).
+    int width;          // Largura da imagem.
+    int height;         // Altura da imagem.
+    int maxval;         // Valor máximo de um pixel (1 a 65535). Acima de 255, cada pixel P5 ocupa 2 bytes.
+    size_t dataOffset;  // Posição, no arquivo, do primeiro byte dos pixels.
+} PgmHeader;
+
+/*
+ * Um PgmMap é uma visão somente leitura de um arquivo PGM mapeado em memória. Para arquivos P5 com maxval até 255,
+ * pixels aponta diretamente para os pixels do arquivo (linha h começa em pixels + h * width), sem nenhuma cópia.
+*/
+typedef struct PgmMap {
+    PgmHeader header;
+    const unsigned char *pixels; // Primeiro byte dos pixels, dentro do mapeamento.
+    size_t pixelBytes;           // Quantidade de bytes disponíveis a partir de pixels.
+    void *base;                  // Início do mapeamento (uso interno).
+    size_t length;               // Tamanho do mapeamento (uso interno).
+} PgmMap;
+
+/*
+ * Leitor de um fluxo de quadros. Apenas os cabeçalhos passam pelo buffer interno; os pixels são lidos diretamente para
+ * o destino (exceto os poucos bytes que já estavam no buffer), sem cópia do quadro inteiro.
+*/
+typedef struct PgmStream {
+    int fd;                                     // Descritor lido.
+    unsigned char buffer[PGM_STREAM_BUFFER];
+    size_t pos;                                 // Próximo byte não consumido do buffer.
+    size_t length;                              // Bytes válidos no buffer.
+    int eof;                                    // 1 quando o descritor chegou ao fim.
+    int error;                                  // 1 se a leitura do descritor falhou.
+} PgmStream;
+
+/** @brief A função parsePGMHeader interpreta o cabeçalho de um PGM a partir de um buffer em memória.
+  * @param *data Ponteiro para o início do arquivo.
+  * @param length Quantidade de bytes em data.
+  * @param *header Cabeçalho lido, retornado por referência.
+  * @return Retorna PGM_OK, ou PGM_ERR_FORMAT caso o cabeçalho seja inválido.
+  */
+int parsePGMHeader (const unsigned char *data, size_t length, PgmHeader *header);
+
+/** @brief A função mapPGM mapeia um arquivo PGM em memória e interpreta seu cabeçalho, sem copiar os pixels.
+  * @param *path Caminho para o arquivo.
+  * @param *map Mapeamento retornado por referência. Deve ser liberado com unmapPGM.
+  * @return Retorna PGM_OK ou um código de erro.
+  */
+int mapPGM (const char *path, PgmMap *map);
+
+/** @brief A função unmapPGM desfaz um mapeamento criado por mapPGM.
+  * @param *map Ponteiro para o mapeamento.
+  */
+void unmapPGM (PgmMap *map);
+
+/** @brief A função viewPGM cria uma imagem que aponta diretamente para os pixels de um mapeamento, sem alocar nem
+  * copiar nada. Só é possível para arquivos P5 com maxval 255. A imagem é somente leitura, é válida enquanto o
+  * mapeamento existir, e não deve ser liberada com freeImage.
+  * @param *map Mapeamento criado por mapPGM.
+  * @param *image Imagem retornada por referência, com stride igual à largura.
+  * @return Retorna PGM_OK, ou PGM_ERR_FORMAT caso o arquivo não seja P5 com maxval 255 ou esteja truncado.
+  */
+int viewPGM (const PgmMap *map, Image *image);
+
+/** @brief A função decodePGM copia os pixels de um mapeamento (P2 ou P5) para uma nova imagem, convertendo-os para a
+  * faixa de 0 a 255 quando o maxval do arquivo é diferente de 255.
+  * @param *map Mapeamento criado por mapPGM.
+  * @param *image Imagem criada e preenchida. Deve ser liberada com freeImage.
+  * @return Retorna PGM_OK ou um código de erro.
+  */
+int decodePGM (const PgmMap *map, Image *image);
+
+/** @brief A função decodePGMInto é análoga à decodePGM, mas reaproveita uma imagem já existente (criada por
+  * createImage ou zerada), redimensionando-a com resizeImage. Não aloca memória se a imagem já for grande o suficiente.
+  * @return Retorna PGM_OK em caso de sucesso, ou um código de erro (PGM_ERR_*).
+  */
+int decodePGMInto (const PgmMap *map, Image *image);
+
+/** @brief A função readPGM lê um arquivo PGM (P2 ou P5) para uma nova imagem. Valores são convertidos para a faixa
+  * de 0 a 255 quando o maxval do arquivo é diferente de 255.
+  * @param *path Caminho para o arquivo.
+  * @param *image Imagem criada e preenchida. Deve ser liberada com freeImage.
+  * @return Retorna PGM_OK ou um código de erro.
+  */
+int readPGM (const char *path, Image *image);
+
+/** @brief A função writePGM escreve uma imagem no formato P5, com maxval 255. Os pixels são escritos com um único
+  * fwrite (ou um por linha, se as linhas da imagem não forem contíguas), sem alocar memória.
+  * @param *path Caminho para o arquivo de saída.
+  * @param *image Imagem a ser escrita.
+  * @return Retorna PGM_OK ou um código de erro.
+  */
+int writePGM (const char *path, const Image *image);
+
+/** @brief A função writePGMFrame escreve uma imagem no formato P5, com maxval 255, em um arquivo já aberto. Várias
+  * imagens escritas em sequência formam um fluxo de quadros legível por readPGMStreamHeader.
+  * @return Retorna PGM_OK ou PGM_ERR_IO.
+  */
+int writePGMFrame (FILE *file, const Image *image);
+
+/** @brief A função pgmFrameSize retorna a quantidade de bytes que writePGMFrame escreve para uma imagem (cabeçalho e
+  * pixels).
+  */
+size_t pgmFrameSize (const Image *image);
+
+/** @brief A função openPGMStream prepara a leitura de um fluxo de quadros a partir de um descritor aberto.
+  */
+void openPGMStream (PgmStream *stream, int fd);
+
+/** @brief A função readPGMStreamHeader lê o cabeçalho do próximo quadro P5 de um fluxo (espaços antes do cabeçalho
+  * são ignorados). Após ela, os pixels devem ser lidos com readPGMStreamPixels.
+  * @param *header Cabeçalho retornado por referência (dataOffset não é usado).
+  * @return Retorna PGM_OK, PGM_END se o fluxo terminou, ou um código de erro.
+  */
+int readPGMStreamHeader (PgmStream *stream, PgmHeader *header);
+
+/** @brief A função readPGMStreamPixels lê exatamente bytes bytes do fluxo para dst.
+  * @return Retorna PGM_OK, PGM_END se o fluxo terminou antes do primeiro byte, PGM_ERR_FORMAT se terminou no meio,
+  * ou PGM_ERR_IO em caso de falha de leitura.
+  */
+int readPGMStreamPixels (PgmStream *stream, uint8_t *dst, size_t bytes);
+
+/** @brief A função pgmError retorna uma descrição, em texto, de um código de retorno deste módulo.
+  * @param code Código retornado por alguma função deste módulo.
+  */
+const char *pgmError (int code);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Arquivo: pipeline.c
+ *
+ * Descrição: Implementação da interface de biblioteca do algoritmo (ver pipeline.h).
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "pipeline.h"
+#include "threshold.h"
+
+/*
+ * Buffers retirados da arena, na ordem em que são retirados.
+*/
+enum {
+    BUFFER_MASK,        // Imagem binária.
+    BUFFER_LABELS,      // Imagem de rótulos.
+    BUFFER_PARENT,      // Tabela de equivalências.
+    BUFFER_COLORS,      // Cor de cada rótulo.
+    BUFFER_OUTPUT,      // Imagem pintada.
+    BUFFER_MORPH,       // Halos e buffers de trabalho da morfologia.
+    BUFFER_STATS,       // Estatísticas por rótulo final.
+    BUFFER_STRIP_STATS, // Estatísticas por rótulo provisório, em cada faixa.
+    BUFFER_WINDOW,      // Somas das janelas da limiarização local, em cada faixa.
+    BUFFER_COUNT
+};
+
+PipelineConfig defaultPipelineConfig (int maxWidth, int maxHeight) {
+    PipelineConfig config;
+    memset(&config, 0, sizeof(PipelineConfig));
+    config.maxWidth = maxWidth;
+    config.maxHeight = maxHeight;
+    config.threads = 1;
+    config.thresholding = defaultThresholdConfig(THRESHOLD_OTSU);
+    config.connectivity = CONNECTIVITY_4;
+    config.element = crossElement();
+    config.operation = MORPH_OPEN;
+    config.stats = 0;
+    config.maxLabels = 0;
+    return config;
+}
+
+/** @brief labelCapacity retorna quantos rótulos (incluindo o 0, do fundo) as tabelas de cores e de estatísticas
+  * comportam.
+  */
+static size_t labelCapacity (const PipelineConfig *config) {
+    if (config->maxLabels > 0) return config->maxLabels + 1;
+    return labelTableSize(config->maxWidth, config->maxHeight);
+}
+
+/** @brief bufferSizes calcula o tamanho, em bytes, de cada buffer retirado da arena.
+  * @return Retorna 0 em caso de sucesso, -1 caso a configuração seja inválida.
+  */
+static int bufferSizes (const PipelineConfig *config, size_t sizes[BUFFER_COUNT]) {
+    if (config->threads < 1) return -1;
+    if (!validThresholdConfig(&config->thresholding)) return -1;
+    if (config->connectivity != CONNECTIVITY_4 && config->connectivity != CONNECTIVITY_8) return -1;
+    int above, below;
+    if (morphHalo(&config->element, config->operation, &above, &below) != 0) return -1;
+
+    int width = config->maxWidth;
+    int height = config->maxHeight;
+    sizes[BUFFER_MASK] = bitplaneBufferSize(width, height);
+    sizes[BUFFER_LABELS] = labelImageBufferSize(width, height);
+    sizes[BUFFER_OUTPUT] = imageBufferSize(width, height);
+    if (sizes[BUFFER_MASK] == 0 || sizes[BUFFER_LABELS] == 0 || sizes[BUFFER_OUTPUT] == 0) return -1;
+
+    // Cada faixa pode usar até um rótulo provisório a mais que sua parte de labelTableSize (ver parallelTableSize).
+    size_t labels = labelCapacity(config);
+    sizes[BUFFER_PARENT] = (labelTableSize(width, height) + (size_t) config->threads) * sizeof(uint32_t);
+    sizes[BUFFER_COLORS] = labels;
+
+    // Mesmo cálculo de parallelMorphWords, com uma faixa por thread.
+    int words = (width + 63) / 64;
+    sizes[BUFFER_MORPH] = (size_t) config->threads *
+                          ((size_t) (above + below) * (size_t) words +
+                           morphScratchWords(&config->element, config->operation, words)) * sizeof(uint64_t);
+
+    sizes[BUFFER_STATS] = config->stats ? labels * sizeof(ComponentStats) : 0;
+    sizes[BUFFER_STRIP_STATS] = config->stats && config->threads > 1 ? labels * sizeof(ComponentStats) : 0;
+    sizes[BUFFER_WINDOW] = isLocalThreshold(config->thresholding.method)
+                           ? (size_t) config->threads * localThresholdWords(width) * sizeof(uint32_t) : 0;
+    return 0;
+}
+
+size_t pipelineArenaSize (const PipelineConfig *config) {
+    size_t sizes[BUFFER_COUNT];
+    if (bufferSizes(config, sizes) != 0) return 0;
+    size_t total = 0;
+    for (int i = 0; i < BUFFER_COUNT; i++) total += arenaSize(sizes[i]);
+    return total;
+}
+
+int createPipeline (Pipeline *pipeline, const PipelineConfig *config, void *arena, size_t arenaSize) {
+    memset(pipeline, 0, sizeof(Pipeline));
+    size_t sizes[BUFFER_COUNT];
+    if (bufferSizes(config, sizes) != 0) return PIPELINE_ERR_CONFIG;
+
+    Arena memory;
+    initArena(&memory, arena, arenaSize);
+    void *buffers[BUFFER_COUNT];
+    for (int i = 0; i < BUFFER_COUNT; i++) {
+        buffers[i] = arenaAlloc(&memory, sizes[i]);
+        if (buffers[i] == NULL) return PIPELINE_ERR_ARENA;
+    }
+
+    if (createParallel(&pipeline->parallel, config->threads) != 0) return PIPELINE_ERR_THREADS;
+    pipeline->config = *config;
+    pipeline->labelCapacity = labelCapacity(config);
+    pipeline->colors = (uint8_t*) buffers[BUFFER_COLORS];
+    attachBitplane(&pipeline->mask, buffers[BUFFER_MASK], sizes[BUFFER_MASK]);
+    attachLabelImage(&pipeline->labels, buffers[BUFFER_LABELS], sizes[BUFFER_LABELS]);
+    attachImage(&pipeline->output, buffers[BUFFER_OUTPUT], sizes[BUFFER_OUTPUT]);
+    attachLabeler(&pipeline->labeler, (uint32_t*) buffers[BUFFER_PARENT], sizes[BUFFER_PARENT] / sizeof(uint32_t),
+                  config->stats ? (ComponentStats*) buffers[BUFFER_STATS] : NULL,
+                  sizes[BUFFER_STATS] / sizeof(ComponentStats));
+    attachParallel(&pipeline->parallel, (uint64_t*) buffers[BUFFER_MORPH], sizes[BUFFER_MORPH] / sizeof(uint64_t),
+                   sizes[BUFFER_STRIP_STATS] > 0 ? (ComponentStats*) buffers[BUFFER_STRIP_STATS] : NULL,
+                   sizes[BUFFER_STRIP_STATS] / sizeof(ComponentStats),
+                   sizes[BUFFER_WINDOW] > 0 ? (uint32_t*) buffers[BUFFER_WINDOW] : NULL,
+                   sizes[BUFFER_WINDOW] / sizeof(uint32_t));
+    return PIPELINE_OK;
+}
+
+void freePipeline (Pipeline *pipeline) {
+    // Os buffers pertencem à arena de quem chama; apenas as threads e seus vetores de controle são liberados.
+    freeParallel(&pipeline->parallel);
+    freeLabeler(&pipeline->labeler);
+    memset(pipeline, 0, sizeof(Pipeline));
+}
+
+/*---------------------------------------------INIT ETAPAS---------------------------------------------*/
+
+int pipelineThreshold (Pipeline *pipeline, const Image *gray) {
+    const ThresholdConfig *thresholding = &pipeline->config.thresholding;
+    if (isLocalThreshold(thresholding->method)) return -1;
+    int hist[256];
+    PROFILE_START(start);
+    parallelSampledHistogram(&pipeline->parallel, gray, thresholding->sampling, hist);
+    PROFILE_STOP(&pipeline->profile, PROFILE_HISTOGRAM, start);
+    PROFILE_START(otsu);
+    int threshold = globalThreshold(hist, thresholding);
+    PROFILE_STOP(&pipeline->profile, PROFILE_OTSU, otsu);
+    return threshold;
+}
+
+int pipelineBinarize (Pipeline *pipeline, const Image *gray, int threshold) {
+    if (gray->width > pipeline->config.maxWidth || gray->height > pipeline->config.maxHeight) {
+        return PIPELINE_ERR_SIZE;
+    }
+    if (resizeBitplane(&pipeline->mask, gray->width, gray->height) != 0) return PIPELINE_ERR_SIZE;
+    PROFILE_START(start);
+    int status;
+    if (isLocalThreshold(pipeline->config.thresholding.method)) {
+        status = parallelLocalThreshold(&pipeline->parallel, gray, &pipeline->config.thresholding, &pipeline->mask);
+        if (status == 0) {
+            status = parallelMorph(&pipeline->parallel, &pipeline->mask, &pipeline->config.element,
+                                   pipeline->config.operation);
+        }
+    } else {
+        status = parallelBinarize(&pipeline->parallel, gray, threshold, &pipeline->mask, &pipeline->config.element,
+                                  pipeline->config.operation);
+    }
+    PROFILE_STOP(&pipeline->profile, PROFILE_BINARIZE, start);
+    return status == 0 ? PIPELINE_OK : PIPELINE_ERR_CONFIG;
+}
+
+/** @brief resizeLabels ajusta a imagem de rótulos e a imagem pintada às dimensões da imagem binária.
+  * @return Retorna PIPELINE_OK ou PIPELINE_ERR_SIZE.
+  */
+static int resizeLabels (Pipeline *pipeline) {
+    int width = pipeline->mask.width;
+    int height = pipeline->mask.height;
+    if (width <= 0 || height <= 0) return PIPELINE_ERR_SIZE;
+    if (resizeLabelImage(&pipeline->labels, width, height) != 0 ||
+        resizeImage(&pipeline->output, width, height) != 0) {
+        return PIPELINE_ERR_SIZE;
+    }
+    return PIPELINE_OK;
+}
+
+/** @brief finishLabel pinta as componentes de uma rotulação já concluída e preenche o resultado.
+  * @param count Retorno da rotulação.
+  * @return Retorna PIPELINE_OK ou PIPELINE_ERR_CAPACITY.
+  */
+static int finishLabel (Pipeline *pipeline, int count, const ComponentStats *stats, PipelineResult *result) {
+    // Como todas as tabelas vêm da arena, a única falha possível da rotulação é exceder maxLabels.
+    if (count < 0 || (size_t) count + 1 > pipeline->labelCapacity) return PIPELINE_ERR_CAPACITY;
+    PROFILE_ADD(&pipeline->profile, PROFILE_COMPONENTS, count);
+    PROFILE_PEAK(&pipeline->profile, PROFILE_LABELS, pipeline->parallel.labelsUsed);
+
+    PROFILE_START(paint);
+    result->components = count;
+    result->targetColor = componentColors(count, pipeline->colors);
+    paintLabels(&pipeline->labels, pipeline->colors, &pipeline->output);
+    PROFILE_STOP(&pipeline->profile, PROFILE_PAINT, paint);
+    result->labels = &pipeline->labels;
+    result->output = &pipeline->output;
+    result->stats = stats;
+    return PIPELINE_OK;
+}
+
+int pipelineLabel (Pipeline *pipeline, PipelineResult *result) {
+    int status = resizeLabels(pipeline);
+    if (status != PIPELINE_OK) return status;
+    ComponentStats *stats = NULL;
+    PROFILE_START(start);
+    int count = parallelLabel(&pipeline->parallel, &pipeline->labeler, &pipeline->mask, pipeline->config.connectivity,
+                              &pipeline->labels, pipeline->config.stats ? &stats : NULL);
+    PROFILE_STOP(&pipeline->profile, PROFILE_LABEL, start);
+    return finishLabel(pipeline, count, stats, result);
+}
+
+int pipelineProcess (Pipeline *pipeline, const Image *gray, PipelineResult *result) {
+    if (gray->width > pipeline->config.maxWidth || gray->height > pipeline->config.maxHeight) {
+        return PIPELINE_ERR_SIZE;
+    }
+    resetProfileFrame(&pipeline->profile);
+    PROFILE_START(start);
+    result->threshold = pipelineThreshold(pipeline, gray);
+    if (isLocalThreshold(pipeline->config.thresholding.method)) {
+        // O limiar local depende da vizinhança de cada pixel, e não é fundido às etapas seguintes.
+        int status = pipelineBinarize(pipeline, gray, result->threshold);
+        if (status == PIPELINE_OK) status = pipelineLabel(pipeline, result);
+        PROFILE_STOP(&pipeline->profile, PROFILE_PROCESS, start);
+        return status;
+    }
+    if (resizeBitplane(&pipeline->mask, gray->width, gray->height) != 0) return PIPELINE_ERR_SIZE;
+    int status = resizeLabels(pipeline);
+    if (status != PIPELINE_OK) return status;
+
+    // A limiarização, a morfologia e a primeira passada da rotulação são feitas em uma única passada sobre a imagem
+    // (ver parallelBinarizeLabel); em seguida, a rotulação é concluída como em pipelineLabel.
+    PROFILE_START(binarize);
+    int fused = parallelBinarizeLabel(&pipeline->parallel, &pipeline->labeler, gray, result->threshold,
+                                      &pipeline->mask, &pipeline->config.element, pipeline->config.operation,
+                                      pipeline->config.connectivity, &pipeline->labels);
+    PROFILE_STOP(&pipeline->profile, PROFILE_BINARIZE, binarize);
+    if (fused != 0) return PIPELINE_ERR_CONFIG;
+    ComponentStats *stats = NULL;
+    PROFILE_START(label);
+    int count = parallelResolveLabels(&pipeline->parallel, &pipeline->labeler, &pipeline->mask,
+                                      pipeline->config.connectivity, &pipeline->labels,
+                                      pipeline->config.stats ? &stats : NULL);
+    PROFILE_STOP(&pipeline->profile, PROFILE_LABEL, label);
+    status = finishLabel(pipeline, count, stats, result);
+    PROFILE_STOP(&pipeline->profile, PROFILE_PROCESS, start);
+    return status;
+}
+
+/*----------------------------------------------END ETAPAS----------------------------------------------*/
+
+const char *pipelineError (int code) {
+    switch (code) {
+        case PIPELINE_OK:           return "sucesso";
+        case PIPELINE_ERR_CONFIG:   return "configuracao invalida";
+        case PIPELINE_ERR_ARENA:    return "arena menor que o necessario";
+        case PIPELINE_ERR_THREADS:  return "nao foi possivel criar as threads";
+        case PIPELINE_ERR_SIZE:     return "imagem maior que as dimensoes maximas";
+        case PIPELINE_ERR_CAPACITY: return "quantidade de rotulos acima do maximo";
+        default:                    return "erro desconhecido";
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * Arquivo: pipeline.h
+ *
+ * Descrição: Interface de biblioteca para o algoritmo completo (histograma, limiar de Otsu, limiarização, abertura,
+ * rotulação das componentes conexas e pintura), para ser usada por outros programas, como um serviço de captura em
+ * tempo real. Todo o estado fica em um contexto (Pipeline), e todos os buffers que dependem do tamanho das imagens são
+ * retirados de uma arena fornecida por quem chama, com tamanho calculado de antemão por pipelineArenaSize.
+ *
+ * Após createPipeline, processar um quadro não aloca memória, não faz entrada ou saída e não encerra o programa:
+ * erros são informados pelos códigos de retorno PIPELINE_*. A leitura e a escrita de arquivos ficam a cargo de quem
+ * chama (ver pgm.h).
+ *
+ * Uso típico:
+ *     PipelineConfig config = defaultPipelineConfig(640, 480);
+ *     void *memory = malloc(pipelineArenaSize(&config));
+ *     Pipeline pipeline;
+ *     createPipeline(&pipeline, &config, memory, pipelineArenaSize(&config));
+ *     for (cada quadro) pipelineProcess(&pipeline, &quadro, &result);
+ *     freePipeline(&pipeline);
+ *     free(memory);
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "components.h"
+#include "image.h"
+#include "label.h"
+#include "morph.h"
+#include "parallel.h"
+#include "profile.h"
+#include "threshold.h"
+
+/*
+ * Códigos de retorno. PIPELINE_OK indica sucesso; os demais são negativos, e sua descrição pode ser obtida com
+ * pipelineError.
+*/
+#define PIPELINE_OK             0
+#define PIPELINE_ERR_CONFIG    -1  // Configuração inválida.
+#define PIPELINE_ERR_ARENA     -2  // Arena menor que pipelineArenaSize.
+#define PIPELINE_ERR_THREADS   -3  // Não foi possível criar as threads.
+#define PIPELINE_ERR_SIZE      -4  // Imagem maior que as dimensões máximas da configuração.
+#define PIPELINE_ERR_CAPACITY  -5  // Mais rótulos que maxLabels.
+
+typedef struct PipelineConfig {
+    int maxWidth;               // Dimensões máximas das imagens processadas.
+    int maxHeight;
+    int threads;                // Threads usadas em cada etapa (1 para processar tudo na thread que chama).
+    ThresholdConfig thresholding; // Método de limiarização (ver threshold.h).
+    int connectivity;           // CONNECTIVITY_4 ou CONNECTIVITY_8.
+    StructuringElement element; // Elemento estruturante da operação morfológica.
+    int operation;              // MORPH_ERODE, MORPH_DILATE, MORPH_OPEN ou MORPH_CLOSE.
+    int stats;                  // 1 para acumular as estatísticas de cada componente (ver components.h).
+    size_t maxLabels;           // Máximo de rótulos provisórios por imagem, ou 0 para o pior caso. Limita o tamanho
+                                // das tabelas de cores e de estatísticas.
+} PipelineConfig;
+
+typedef struct PipelineResult {
+    int threshold;              // Limiar usado (com um método local, -1).
+    int components;             // Quantidade de componentes conexas.
+    int targetColor;            // Cor da última componente pintada.
+    const LabelImage *labels;   // Rótulo de cada pixel.
+    const Image *output;        // Imagem com as componentes pintadas.
+    const ComponentStats *stats;// Estatísticas (posições 1 a components), ou NULL se não configuradas.
+} PipelineResult;
+// Os ponteiros do resultado apontam para buffers do contexto, válidos até o próximo quadro.
+
+typedef struct Pipeline {
+    PipelineConfig config;
+    Parallel parallel;          // Threads e buffers por faixa.
+    Bitplane mask;              // Imagem binária.
+    LabelImage labels;          // Imagem de rótulos.
+    Labeler labeler;            // Tabela de equivalências e estatísticas.
+    Image output;               // Imagem pintada.
+    uint8_t *colors;            // Cor de cada rótulo.
+    size_t labelCapacity;       // Posições em colors (e nas tabelas de estatísticas).
+    ProfileFrame profile;       // Medidas do último quadro (ver profile.h), zeradas por pipelineProcess. Leitura e
+                                // escrita ficam a cargo de quem chama.
+} Pipeline;
+
+/** @brief A função defaultPipelineConfig retorna a configuração do programa original: limiar de Otsu, abertura com a
+  * cruz 3x3, 4-conectividade, uma thread e sem estatísticas.
+  */
+PipelineConfig defaultPipelineConfig (int maxWidth, int maxHeight);
+
+/** @brief A função pipelineArenaSize retorna o tamanho, em bytes, da arena necessária para uma configuração, ou 0 se a
+  * configuração for inválida.
+  */
+size_t pipelineArenaSize (const PipelineConfig *config);
+
+/** @brief A função createPipeline prepara um contexto. Esta é a única etapa que pode alocar memória fora da arena (as
+  * threads do pool e seus pequenos vetores de controle).
+  * @param *arena Bloco de memória de quem chama, com ao menos pipelineArenaSize bytes. Deve permanecer válido até
+  * freePipeline, e não é liberado por ela.
+  * @return Retorna PIPELINE_OK ou um código de erro.
+  */
+int createPipeline (Pipeline *pipeline, const PipelineConfig *config, void *arena, size_t arenaSize);
+
+/** @brief A função freePipeline termina as threads de um contexto. A arena continua pertencendo a quem chama.
+  */
+void freePipeline (Pipeline *pipeline);
+
+/** @brief A função pipelineThreshold gera o histograma de uma imagem e retorna o limiar global do método da
+  * configuração: o de Otsu ou, no Otsu multinível, o menor nível da classe mais clara menos 1 (ver multiThreshold).
+  * Com um método local, retorna -1 sem gerar o histograma.
+  */
+int pipelineThreshold (Pipeline *pipeline, const Image *gray);
+
+/** @brief A função pipelineBinarize gera a imagem binária com o limiar dado e aplica a operação morfológica da
+  * configuração, em uma única passada (ver parallelBinarize). Com um método local, threshold é ignorado, e a imagem é
+  * limiarizada por parallelLocalThreshold antes da operação morfológica. O resultado fica no contexto, para pipelineLabel.
+  * @return Retorna PIPELINE_OK ou um código de erro.
+  */
+int pipelineBinarize (Pipeline *pipeline, const Image *gray, int threshold);
+
+/** @brief A função pipelineLabel rotula as componentes conexas da imagem binária e as pinta.
+  * @param *result Preenchido com components, targetColor, labels, output e stats.
+  * @return Retorna PIPELINE_OK ou um código de erro.
+  */
+int pipelineLabel (Pipeline *pipeline, PipelineResult *result);
+
+/** @brief A função pipelineProcess executa todas as etapas sobre uma imagem, com o mesmo resultado de
+  * pipelineThreshold, pipelineBinarize e pipelineLabel. A limiarização, a morfologia e a primeira passada da rotulação
+  * são fundidas em uma única passada sobre a imagem (ver parallelBinarizeLabel), exceto com um método local.
+  * @return Retorna PIPELINE_OK ou um código de erro.
+  */
+int pipelineProcess (Pipeline *pipeline, const Image *gray, PipelineResult *result);
+
+/** @brief A função pipelineError retorna uma descrição, em texto, de um código de retorno deste módulo.
+  */
+const char *pipelineError (int code);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Arquivo: pool.c
+ *
+ * Descrição: Implementação do thread pool (ver pool.h).
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+/** @brief takeTask retira a próxima tarefa da fila da própria thread.
+  * @return Retorna o número da tarefa, ou -1 se a fila estiver vazia.
+  */
+static int takeTask (PoolQueue *queue) {
+    int task = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->begin < queue->end) task = queue->begin++;
+    pthread_mutex_unlock(&queue->lock);
+    return task;
+}
+
+/** @brief stealTasks move para a fila da thread a metade final da fila de alguma outra thread, percorrendo as
+  * demais a partir da seguinte.
+  * @return Retorna 1 se alguma tarefa foi roubada, 0 se todas as filas estavam vazias.
+  */
+static int stealTasks (Pool *pool, int thread) {
+    for (int i = 1; i < pool->threads; i++) {
+        PoolQueue *victim = &pool->queues[(thread + i) % pool->threads];
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->end - victim->begin;
+        if (left <= 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        int end = victim->end;
+        victim->end -= (left + 1) / 2;
+        int begin = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+
+        PoolQueue *own = &pool->queues[thread];
+        pthread_mutex_lock(&own->lock);
+        own->begin = begin;
+        own->end = end;
+        pthread_mutex_unlock(&own->lock);
+        return 1;
+    }
+    return 0;
+}
+
+/** @brief runTasks executa tarefas do lote atual, primeiro da própria fila e depois roubando das demais, até que
+  * não haja mais nenhuma a iniciar.
+  */
+static void runTasks (Pool *pool, int thread) {
+    for (;;) {
+        int task = takeTask(&pool->queues[thread]);
+        if (task >= 0) {
+            pool->task(pool->arg, task, thread);
+        } else if (!stealTasks(pool, thread)) {
+            return;
+        }
+    }
+}
+
+typedef struct WorkerArgs {
+    Pool *pool;
+    int thread;
+} WorkerArgs;
+
+/** @brief worker é o laço de cada thread auxiliar: espera um novo lote, executa tarefas dele, e avisa quando não há
+  * mais nada a fazer.
+  */
+static void *worker (void *data) {
+    WorkerArgs args = *(WorkerArgs*) data;
+    free(data);
+    Pool *pool = args.pool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stop) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        runTasks(pool, args.thread);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int createPool (Pool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    pool->threads = 1;
+    pool->workers = NULL;
+    pool->queues = NULL;
+    pool->queueCount = 0;
+    pool->running = 0;
+    pool->generation = 0;
+    pool->stop = 0;
+    pool->task = NULL;
+    pool->arg = NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    if (threads > 1) {
+        pool->workers = (pthread_t*) malloc((size_t) (threads - 1) * sizeof(pthread_t));
+        pool->queues = (PoolQueue*) malloc((size_t) threads * sizeof(PoolQueue));
+        if (pool->workers == NULL || pool->queues == NULL) {
+            freePool(pool);
+            return -1;
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_mutex_init(&pool->queues[i].lock, NULL);
+            pool->queues[i].begin = pool->queues[i].end = 0;
+        }
+        pool->queueCount = threads;
+        for (int i = 1; i < threads; i++) {
+            WorkerArgs *args = (WorkerArgs*) malloc(sizeof(WorkerArgs));
+            if (args == NULL) {
+                freePool(pool);
+                return -1;
+            }
+            args->pool = pool;
+            args->thread = i;
+            if (pthread_create(&pool->workers[i - 1], NULL, worker, args) != 0) {
+                free(args);
+                freePool(pool);
+                return -1;
+            }
+            pool->threads++;
+        }
+    }
+    return 0;
+}
+
+void freePool (Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->threads - 1; i++) pthread_join(pool->workers[i], NULL);
+    for (int i = 0; i < pool->queueCount; i++) pthread_mutex_destroy(&pool->queues[i].lock);
+    free(pool->workers);
+    free(pool->queues);
+    pool->workers = NULL;
+    pool->queues = NULL;
+    pool->queueCount = 0;
+    pool->threads = 1;
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void poolRun (Pool *pool, int tasks, PoolTask task, void *arg) {
+    if (pool->threads == 1 || tasks <= 1) {
+        for (int i = 0; i < tasks; i++) task(arg, i, 0);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    // Cada thread começa com um bloco contíguo de tarefas, o que mantém juntas faixas vizinhas de uma imagem.
+    for (int i = 0; i < pool->threads; i++) {
+        pool->queues[i].begin = (int) ((long long) tasks * i / pool->threads);
+        pool->queues[i].end = (int) ((long long) tasks * (i + 1) / pool->threads);
+    }
+    pool->running = pool->threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    runTasks(pool, 0);  // A thread que chama também executa tarefas.
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int defaultThreads (void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int) count : 1;
+}
@@ -0,0 +1,71 @@
+/*
+ * Arquivo: pool.h
+ *
+ * Descrição: Conjunto fixo de threads (thread pool) para executar laços paralelos. As threads são criadas uma única
+ * vez e reaproveitadas: cada chamada a poolRun distribui tarefas numeradas de 0 a tasks - 1 entre elas (a thread que
+ * chama também executa tarefas) e só retorna quando todas terminarem.
+ *
+ * A distribuição é feita por roubo de tarefas (work stealing): cada thread recebe um bloco contíguo de tarefas, em
+ * sua própria fila, e as executa em ordem. Uma thread cuja fila esvazia rouba a metade final da fila de outra thread.
+ * Assim, tarefas de duração muito diferente (por exemplo, imagens de tamanhos diferentes) não deixam threads ociosas,
+ * e a disputa por locks só ocorre quando alguma fila esvazia.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+/*
+ * Função executada para cada tarefa. arg é o mesmo ponteiro passado a poolRun, task é o número da tarefa e thread é
+ * o número da thread que a executa (de 0 a threads - 1), útil para indexar buffers por thread.
+*/
+typedef void (*PoolTask) (void *arg, int task, int thread);
+
+/*
+ * Fila de tarefas de uma thread: as tarefas begin a end - 1 ainda não foram iniciadas. A dona retira tarefas do
+ * início; as demais roubam do fim. O preenchimento evita que filas vizinhas dividam uma linha de cache.
+*/
+typedef struct PoolQueue {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+    char padding[64];
+} PoolQueue;
+
+typedef struct Pool {
+    int threads;            // Quantidade de threads, incluindo a que chama poolRun.
+    pthread_t *workers;     // threads - 1 threads auxiliares.
+    PoolQueue *queues;      // Uma fila por thread.
+    int queueCount;         // Filas iniciadas em queues.
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    // Sinaliza às threads auxiliares que há um novo lote de tarefas (ou que devem terminar).
+    pthread_cond_t done;    // Sinaliza à thread que chamou poolRun que o lote terminou.
+    PoolTask task;          // Lote atual.
+    void *arg;
+    int running;            // Threads auxiliares ainda trabalhando no lote atual.
+    unsigned generation;    // Incrementado a cada lote, para que cada thread participe de cada lote uma vez.
+    int stop;               // 1 quando o pool está sendo destruído.
+} Pool;
+
+/** @brief A função createPool cria um pool com a quantidade de threads dada.
+  * @param *pool Pool a ser inicializado.
+  * @param threads Quantidade de threads (no mínimo 1; com 1, poolRun executa tudo na thread que chama).
+  * @return Retorna 0 em caso de sucesso, -1 caso não seja possível criar as threads.
+  */
+int createPool (Pool *pool, int threads);
+
+/** @brief A função freePool termina e libera as threads do pool.
+  */
+void freePool (Pool *pool);
+
+/** @brief A função poolRun executa task(arg, i, thread) para todo i de 0 a tasks - 1, e retorna quando todas as
+  * tarefas terminarem.
+  */
+void poolRun (Pool *pool, int tasks, PoolTask task, void *arg);
+
+/** @brief A função defaultThreads retorna a quantidade de processadores disponíveis (no mínimo 1).
+  */
+int defaultThreads (void);
+
+#endif
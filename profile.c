@@ -0,0 +1,152 @@
+/*
+ * Arquivo: profile.c
+ *
+ * Descrição: Implementação da instrumentação das etapas (ver profile.h).
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "profile.h"
+
+static const char *metricNames[PROFILE_METRICS] = {
+    "leitura", "histograma", "otsu", "binarizacao", "rotulacao", "pintura", "escrita",
+    "processamento", "componentes", "rotulos_provisorios", "bytes_lidos", "bytes_escritos",
+    "tiles_recalculados", "pilha_preenchimento"
+};
+
+int64_t profileNow (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void resetProfileFrame (ProfileFrame *frame) {
+    memset(frame, 0, sizeof(ProfileFrame));
+}
+
+void addProfileFrame (ProfileFrame *dst, const ProfileFrame *src) {
+    for (int i = 0; i < PROFILE_METRICS; i++) dst->value[i] += src->value[i];
+    dst->measured |= src->measured;
+}
+
+void resetProfile (Profile *profile) {
+    memset(profile, 0, sizeof(Profile));
+}
+
+/*------------------------------------------INIT HISTOGRAMA LOG------------------------------------------*/
+
+/*
+ * Valores abaixo de 8 têm uma posição cada. Acima, cada potência de 2 é dividida em 8 posições de mesma largura, de
+ * forma que todos os valores de uma posição diferem em no máximo 1/8.
+*/
+
+/** @brief bucketOf retorna a posição do histograma de um valor.
+  */
+static int bucketOf (uint64_t value) {
+    if (value < 8) return (int) value;
+    int exponent = 63;
+    while (!(value >> exponent)) exponent--;
+    return 8 * (exponent - 2) + (int) ((value >> (exponent - 3)) & 7);
+}
+
+/** @brief bucketTop retorna o maior valor de uma posição do histograma.
+  */
+static uint64_t bucketTop (int bucket) {
+    if (bucket < 8) return (uint64_t) bucket;
+    int shift = bucket / 8 - 1;
+    uint64_t low = (uint64_t) (8 + bucket % 8) << shift;
+    return low + (((uint64_t) 1 << shift) - 1);
+}
+
+/*-------------------------------------------END HISTOGRAMA LOG-------------------------------------------*/
+
+static void recordValue (ProfileMetric *metric, uint64_t value) {
+    if (metric->count == 0 || value < metric->min) metric->min = value;
+    if (value > metric->max) metric->max = value;
+    metric->count++;
+    metric->sum += value;
+    metric->buckets[bucketOf(value)]++;
+}
+
+void recordProfile (Profile *profile, const ProfileFrame *frame) {
+    profile->frames++;
+    for (int i = 0; i < PROFILE_METRICS; i++) {
+        if ((frame->measured >> i) & 1) recordValue(&profile->metrics[i], frame->value[i]);
+    }
+}
+
+void mergeProfile (Profile *dst, const Profile *src) {
+    dst->frames += src->frames;
+    for (int i = 0; i < PROFILE_METRICS; i++) {
+        ProfileMetric *d = &dst->metrics[i];
+        const ProfileMetric *s = &src->metrics[i];
+        if (s->count == 0) continue;
+        if (d->count == 0 || s->min < d->min) d->min = s->min;
+        if (s->max > d->max) d->max = s->max;
+        d->count += s->count;
+        d->sum += s->sum;
+        for (int b = 0; b < PROFILE_BUCKETS; b++) d->buckets[b] += s->buckets[b];
+    }
+}
+
+uint64_t profileQuantile (const ProfileMetric *metric, double q) {
+    if (metric->count == 0) return 0;
+    // Posto do quantil (nearest-rank): o menor valor com ao menos q * count valores menores ou iguais a ele.
+    uint64_t rank = (uint64_t) (q * (double) metric->count);
+    if ((double) rank < q * (double) metric->count) rank++;
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += metric->buckets[b];
+        if (seen >= rank) {
+            uint64_t top = bucketTop(b);
+            return top < metric->max ? top : metric->max;
+        }
+    }
+    return metric->max;
+}
+
+const char *profileMetricName (int metric) {
+    return metric >= 0 && metric < PROFILE_METRICS ? metricNames[metric] : "";
+}
+
+/*--------------------------------------------INIT RELATÓRIO--------------------------------------------*/
+
+int writeProfileJSON (FILE *file, const Profile *profile) {
+    fprintf(file, "{\"enabled\": %s, \"frames\": %llu, \"time_unit\": \"ns\", \"metrics\": [",
+            PROFILE_ENABLED ? "true" : "false", (unsigned long long) profile->frames);
+    int first = 1;
+    for (int i = 0; i < PROFILE_METRICS && PROFILE_ENABLED; i++) {
+        const ProfileMetric *m = &profile->metrics[i];
+        if (m->count == 0) continue;    // Medida nunca registrada (por exemplo, uma etapa de outro modo).
+        fprintf(file, "%s\n  {\"name\": \"%s\", \"count\": %llu, \"sum\": %llu, \"mean\": %.1f, \"min\": %llu, "
+                "\"p50\": %llu, \"p99\": %llu, \"max\": %llu}",
+                first ? "" : ",", metricNames[i], (unsigned long long) m->count, (unsigned long long) m->sum,
+                m->count > 0 ? (double) m->sum / (double) m->count : 0.0, (unsigned long long) m->min,
+                (unsigned long long) profileQuantile(m, 0.50), (unsigned long long) profileQuantile(m, 0.99),
+                (unsigned long long) m->max);
+        first = 0;
+    }
+    fputs("\n]}\n", file);
+    return ferror(file) ? -1 : 0;
+}
+
+int writeProfileCSV (FILE *file, const Profile *profile) {
+    fputs("metric,count,sum,mean,min,p50,p99,max\n", file);
+    for (int i = 0; i < PROFILE_METRICS && PROFILE_ENABLED; i++) {
+        const ProfileMetric *m = &profile->metrics[i];
+        if (m->count == 0) continue;
+        fprintf(file, "%s,%llu,%llu,%.1f,%llu,%llu,%llu,%llu\n", metricNames[i], (unsigned long long) m->count,
+                (unsigned long long) m->sum, m->count > 0 ? (double) m->sum / (double) m->count : 0.0,
+                (unsigned long long) m->min, (unsigned long long) profileQuantile(m, 0.50),
+                (unsigned long long) profileQuantile(m, 0.99), (unsigned long long) m->max);
+    }
+    return ferror(file) ? -1 : 0;
+}
+
+/*---------------------------------------------END RELATÓRIO---------------------------------------------*/
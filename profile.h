@@ -0,0 +1,134 @@
+/*
+ * Arquivo: profile.h
+ *
+ * Descrição: Instrumentação das etapas do algoritmo: tempo de cada etapa, bytes lidos e escritos, quantidade de
+ * componentes, o pico de uso da tabela de rótulos provisórios e, no modo incremental, os tiles recalculados, medidos
+ * por quadro (ProfileFrame) e agregados ao longo de uma execução em lote ou de vídeo (Profile). Cada medida é agregada
+ * em um histograma logarítmico de tamanho fixo, de onde são obtidos p50 e p99 (com erro de no máximo 1/8 do valor), sem
+ * guardar as amostras nem alocar memória por quadro. Apenas as medidas registradas em um quadro (por PROFILE_STOP,
+ * PROFILE_ADD ou PROFILE_PEAK) são agregadas, de forma que uma etapa que não é executada não conta como uma amostra de
+ * valor 0; o relatório, escrito em JSON ou CSV, omite as medidas que nunca foram registradas.
+ *
+ * A instrumentação só é compilada com SEMB_PROFILE definido (opção SEMB_PROFILE do CMake, ligada por padrão). Sem ele,
+ * as macros PROFILE_* não geram código, e os relatórios indicam que a instrumentação está desligada.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef SEMB_PROFILE
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ENABLED 0
+#endif
+
+/*
+ * Medidas de um quadro. As de tempo, em nanossegundos, vêm primeiro.
+*/
+#define PROFILE_READ        0   // Leitura (e conversão) da imagem.
+#define PROFILE_HISTOGRAM   1   // Histograma.
+#define PROFILE_OTSU        2   // Cálculo do limiar (Threshold).
+#define PROFILE_BINARIZE    3   // Limiarização e morfologia, fundidas (em pipelineProcess, com a primeira passada da
+                                // rotulação).
+#define PROFILE_LABEL       4   // Rotulação das componentes conexas (em pipelineProcess, a partir da segunda passada).
+#define PROFILE_PAINT       5   // Pintura.
+#define PROFILE_WRITE       6   // Escrita do resultado.
+#define PROFILE_PROCESS     7   // Processamento completo, sem leitura e escrita (pipelineProcess).
+#define PROFILE_TIMES       8   // Quantidade de medidas de tempo.
+#define PROFILE_COMPONENTS  8   // Quantidade de componentes conexas.
+#define PROFILE_LABELS      9   // Rótulos provisórios usados (o pico de uso da tabela de equivalências).
+#define PROFILE_BYTES_READ  10  // Bytes lidos.
+#define PROFILE_BYTES_WRITTEN 11 // Bytes escritos.
+#define PROFILE_TILES       12  // Tiles recalculados no modo incremental (ver incremental.h).
+#define PROFILE_FILL_STACK  13  // Entradas usadas na pilha do preenchimento (o pico de Filler.peak; ver fill.h).
+#define PROFILE_METRICS     14  // No máximo 32 (ver ProfileFrame.measured).
+
+#define PROFILE_BUCKETS 512 // Posições do histograma de cada medida (8 por potência de 2, até 2^64).
+
+typedef struct ProfileFrame {
+    uint64_t value[PROFILE_METRICS];
+    uint32_t measured;      // Bit i em 1 se a medida i foi registrada no quadro.
+} ProfileFrame;
+
+typedef struct ProfileMetric {
+    uint64_t count;                     // Quantidade de quadros medidos.
+    uint64_t sum;                       // Soma dos valores.
+    uint64_t min, max;                  // Menor e maior valor (o maior é o pico, para as medidas de uso).
+    uint64_t buckets[PROFILE_BUCKETS];  // Histograma logarítmico dos valores.
+} ProfileMetric;
+
+typedef struct Profile {
+    uint64_t frames;
+    ProfileMetric metrics[PROFILE_METRICS];
+} Profile;
+
+#ifdef SEMB_PROFILE
+// Inicia a medição de um trecho, guardando o instante atual em name.
+#define PROFILE_START(name) int64_t name = profileNow()
+// Soma ao tempo da medida metric do quadro o tempo desde PROFILE_START(name).
+#define PROFILE_STOP(frame, metric, name) \
+    ((frame)->measured |= 1u << (metric), (frame)->value[(metric)] += (uint64_t) (profileNow() - (name)))
+// Soma amount à medida metric do quadro.
+#define PROFILE_ADD(frame, metric, amount) \
+    ((frame)->measured |= 1u << (metric), (frame)->value[(metric)] += (uint64_t) (amount))
+// Guarda em metric o maior entre seu valor atual e amount.
+#define PROFILE_PEAK(frame, metric, amount) \
+    ((frame)->measured |= 1u << (metric), \
+     (frame)->value[(metric)] = (uint64_t) (amount) > (frame)->value[(metric)] ? (uint64_t) (amount) \
+                                                                                 : (frame)->value[(metric)])
+#else
+#define PROFILE_START(name) ((void) 0)
+#define PROFILE_STOP(frame, metric, name) ((void) 0)
+#define PROFILE_ADD(frame, metric, amount) ((void) 0)
+#define PROFILE_PEAK(frame, metric, amount) ((void) 0)
+#endif
+
+/** @brief A função profileNow retorna o instante atual, em nanossegundos, de um relógio monotônico.
+  */
+int64_t profileNow (void);
+
+/** @brief A função resetProfileFrame zera as medidas de um quadro.
+  */
+void resetProfileFrame (ProfileFrame *frame);
+
+/** @brief A função addProfileFrame soma as medidas de src às de dst (por exemplo, as de uma etapa medida à parte). As
+  * medidas registradas em src passam a constar como registradas em dst.
+  */
+void addProfileFrame (ProfileFrame *dst, const ProfileFrame *src);
+
+/** @brief A função resetProfile zera um agregado.
+  */
+void resetProfile (Profile *profile);
+
+/** @brief A função recordProfile agrega as medidas registradas em um quadro; as demais não recebem amostra.
+  */
+void recordProfile (Profile *profile, const ProfileFrame *frame);
+
+/** @brief A função mergeProfile soma o agregado src ao agregado dst (por exemplo, os de cada thread do modo em lote).
+  */
+void mergeProfile (Profile *dst, const Profile *src);
+
+/** @brief A função profileQuantile retorna, aproximadamente, o quantil q (entre 0 e 1) dos valores de uma medida.
+  */
+uint64_t profileQuantile (const ProfileMetric *metric, double q);
+
+/** @brief A função profileMetricName retorna o nome de uma medida, usado nos relatórios.
+  */
+const char *profileMetricName (int metric);
+
+/** @brief A função writeProfileJSON escreve um agregado em JSON: para cada medida registrada em ao menos um quadro, a
+  * quantidade de quadros em que foi registrada, a média, p50, p99 e o máximo.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro de escrita.
+  */
+int writeProfileJSON (FILE *file, const Profile *profile);
+
+/** @brief A função writeProfileCSV escreve um agregado em CSV, com uma linha por medida registrada em ao menos um
+  * quadro.
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro de escrita.
+  */
+int writeProfileCSV (FILE *file, const Profile *profile);
+
+#endif
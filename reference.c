@@ -0,0 +1,275 @@
+/*
+ * Arquivo: reference.c
+ *
+ * Descrição: Implementação de referência do algoritmo original (ver reference.h). As funções seguem o código da
+ * primeira versão do programa; as únicas mudanças são:
+ *  - as dimensões da imagem, que deixam de ser fixas em 160x120;
+ *  - o registro do número de cada componente durante a contagem;
+ *  - a fila do Flood Fill, que não pode mais transbordar. No original, quando uma componente é pintada com a cor 255
+ *    (a mesma do foreground), pixels já na fila são inseridos de novo, as repetições se multiplicam, a fila enche e as
+ *    inserções seguintes são descartadas, deixando partes da componente para serem contadas como novas componentes na
+ *    pintura. Aqui, um pixel retirado da fila que já foi visitado é ignorado, e a fila comporta 4 inserções por pixel.
+ *    Com isso, a pintura passa a cobrir exatamente as componentes contadas, como pretendia o algoritmo original (nas
+ *    imagens 160x120 do trabalho, os resultados são os mesmos).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reference.h"
+
+/*
+ * Matrizes de inteiros com as dimensões da imagem, como as matrizes [120][160] do programa original.
+*/
+typedef struct Matrix {
+    int width, height;
+    int *data;
+} Matrix;
+
+#define AT(m, x, y) ((m)->data[(size_t) (x) * (size_t) (m)->width + (size_t) (y)])
+
+/*----------------------------------------------INIT QUEUE----------------------------------------------*/
+
+typedef struct Queue {
+    size_t front, rear, size;
+    size_t capacity;    // Capacidade máxima da fila
+    int *arrayX;        // Fila que armazena uma coordenada no eixo X (linha) da imagem.
+    int *arrayY;        // Idem, para o eixo Y (coluna).
+} Queue;
+
+static int createQueue (Queue *queue, size_t capacity) {
+    queue->capacity = capacity;
+    queue->front = queue->size = 0;
+    queue->rear = capacity - 1;
+    queue->arrayX = (int*) malloc(capacity * sizeof(int));
+    queue->arrayY = (int*) malloc(capacity * sizeof(int));
+    return queue->arrayX != NULL && queue->arrayY != NULL ? 0 : -1;
+}
+
+static void freeQueue (Queue *queue) {
+    free(queue->arrayX);
+    free(queue->arrayY);
+}
+
+static void push (Queue *queue, int x, int y) {
+    if (queue->size == queue->capacity) return;     // Não fazer nada se estiver cheia.
+    queue->rear = (queue->rear + 1) % queue->capacity;
+    queue->arrayX[queue->rear] = x;
+    queue->arrayY[queue->rear] = y;
+    queue->size++;
+}
+
+static void dequeue (Queue *queue, int *x, int *y) {
+    if (queue->size == 0) return;                   // Não fazer nada se estiver vazia.
+    *x = queue->arrayX[queue->front];
+    *y = queue->arrayY[queue->front];
+    queue->front = (queue->front + 1) % queue->capacity;
+    queue->size--;
+}
+
+/*----------------------------------------------END QUEUE----------------------------------------------*/
+
+/*-----------------------------------------INIT OTSU THRESHOLD-----------------------------------------*/
+
+/** @brief referenceThreshold é a função Threshold original, com o total de pixels como parâmetro. O limiar começa em
+  * 0 apenas para que imagens de uma só cor (em que nenhuma variância supera 0) tenham um resultado definido.
+  */
+static int referenceThreshold (const int *hist, int total) {
+    double gsum = 0;    //soma ponderada global das ocorrencias do pixel por sua intensidade
+    double gavg;        //media global ponderada dos pixels
+    double n1 = 0;      //numero de pixels da classe C1
+    double n2 = 0;      //numero de pixels da classe C2
+    double m1 = 0;      //media ponderada dos pixels da classe C1
+    double m2 = 0;      //media ponderada dos pixels da classe C2
+    double var;         //variancia entre as classes C1 e C2
+    double maxVar = 0;  //armazena a maior variância
+    int threshold = 0;  //valor para o qual as classes C1 e C2 possuem variância máxima
+
+    for (int i = 0; i < 256; i++) {
+        gsum += (double) hist[i] * i;
+    }
+    gavg = gsum / total;
+    for (int i = 0; i < 256; ++i) {
+        n1 += hist[i];
+        m1 += (double) i * hist[i];
+        n2 = total - n1;
+        m2 = gsum - m1;
+        var = (n1 / total) * ((m1 / n1) - gavg) * ((m1 / (n1)) - gavg) +
+              (n2 / total) * ((m2 / n2) - gavg) * ((m2 / n2) - gavg);
+        if (var > maxVar) {
+            maxVar = var;
+            threshold = i;
+        }
+    }
+    return threshold;
+}
+
+/*-----------------------------------------END OTSU THRESHOLD-----------------------------------------*/
+
+/*------------------------------------------INIT FLOOD FILL-------------------------------------------*/
+
+static int isValid (const Matrix *binaryMatrix, int x, int y, const Matrix *visited, int comp) {
+    // Se x e y forem posições válidas, com um valor correto e que não tenham sido visitadas, retorne 1.
+    return x >= 0 && x < binaryMatrix->height && y >= 0 && y < binaryMatrix->width && AT(binaryMatrix, x, y) == comp &&
+           AT(visited, x, y) != 1;
+}
+
+/** @brief erode é a erosão original: um pixel branco com algum vizinho (em cima, em baixo, à esquerda ou à direita,
+  * dentro da imagem) preto fica preto.
+  */
+static void erode (Matrix *outBinaryMatrix, const Matrix *visited, Matrix *orBinaryMatrix) {
+    size_t pixels = (size_t) outBinaryMatrix->width * (size_t) outBinaryMatrix->height;
+    memcpy(orBinaryMatrix->data, outBinaryMatrix->data, pixels * sizeof(int));
+    for (int h = 0; h < outBinaryMatrix->height; h++) {
+        for (int w = 0; w < outBinaryMatrix->width; w++) {
+            if (AT(orBinaryMatrix, h, w) == 255) {
+                if (isValid(orBinaryMatrix, h, w - 1, visited, 0) || isValid(orBinaryMatrix, h, w + 1, visited, 0) ||
+                    isValid(orBinaryMatrix, h + 1, w, visited, 0) || isValid(orBinaryMatrix, h - 1, w, visited, 0)) {
+                    AT(outBinaryMatrix, h, w) = 0;
+                }
+            }
+        }
+    }
+}
+
+/** @brief dilate é a dilatação original: um pixel preto com algum vizinho branco fica branco.
+  */
+static void dilate (Matrix *outBinaryMatrix, const Matrix *visited, Matrix *orBinaryMatrix) {
+    size_t pixels = (size_t) outBinaryMatrix->width * (size_t) outBinaryMatrix->height;
+    memcpy(orBinaryMatrix->data, outBinaryMatrix->data, pixels * sizeof(int));
+    for (int h = 0; h < outBinaryMatrix->height; h++) {
+        for (int w = 0; w < outBinaryMatrix->width; w++) {
+            if (AT(orBinaryMatrix, h, w) == 0) {
+                if (isValid(orBinaryMatrix, h, w - 1, visited, 255) ||
+                    isValid(orBinaryMatrix, h, w + 1, visited, 255) ||
+                    isValid(orBinaryMatrix, h + 1, w, visited, 255) ||
+                    isValid(orBinaryMatrix, h - 1, w, visited, 255)) {
+                    AT(outBinaryMatrix, h, w) = 255;
+                }
+            }
+        }
+    }
+}
+
+/** @brief floodFill é o Flood Fill original, por busca em largura a partir do pixel (x, y). Se labels não for NULL,
+  * cada pixel visitado recebe o número label.
+  */
+static void floodFill (Matrix *binaryMatrix, int x, int y, Matrix *visited, int targetColor, Queue *queue,
+                       uint32_t *labels, uint32_t label) {
+    push(queue, x, y);
+    int currentX = 0;
+    int currentY = 0;
+    while (queue->size > 0) {
+        dequeue(queue, &currentX, &currentY);
+        if (AT(visited, currentX, currentY)) continue;
+        AT(binaryMatrix, currentX, currentY) = targetColor;
+        AT(visited, currentX, currentY) = 1;
+        if (labels != NULL) labels[(size_t) currentX * (size_t) binaryMatrix->width + (size_t) currentY] = label;
+        if (isValid(binaryMatrix, currentX + 1, currentY, visited, 255)) {
+            AT(binaryMatrix, currentX + 1, currentY) = targetColor;
+            push(queue, currentX + 1, currentY);
+        }
+        if (isValid(binaryMatrix, currentX - 1, currentY, visited, 255)) {
+            AT(binaryMatrix, currentX - 1, currentY) = targetColor;
+            push(queue, currentX - 1, currentY);
+        }
+        if (isValid(binaryMatrix, currentX, currentY + 1, visited, 255)) {
+            AT(binaryMatrix, currentX, currentY + 1) = targetColor;
+            push(queue, currentX, currentY + 1);
+        }
+        if (isValid(binaryMatrix, currentX, currentY - 1, visited, 255)) {
+            AT(binaryMatrix, currentX, currentY - 1) = targetColor;
+            push(queue, currentX, currentY - 1);
+        }
+    }
+}
+
+/*-------------------------------------------END FLOOD FILL-------------------------------------------*/
+
+int referenceAlgorithm (const Image *gray, ReferenceResult *result) {
+    int width = gray->width;
+    int height = gray->height;
+    size_t pixels = (size_t) width * (size_t) height;
+    memset(result, 0, sizeof(ReferenceResult));
+    result->width = width;
+    result->height = height;
+
+    Matrix matrices[5];     // Imagem, visitados, cópia usada na erosão e na dilatação, imagem e visitados originais.
+    for (int i = 0; i < 5; i++) {
+        matrices[i].width = width;
+        matrices[i].height = height;
+        matrices[i].data = (int*) calloc(pixels, sizeof(int));
+    }
+    Matrix *matrix = &matrices[0], *visited = &matrices[1], *copy = &matrices[2];
+    Matrix *originalMatrix = &matrices[3], *originalVisited = &matrices[4];
+    Queue queue;
+    int status = createQueue(&queue, 4 * pixels + 1);
+    result->labels = (uint32_t*) calloc(pixels, sizeof(uint32_t));
+    result->output = (uint8_t*) malloc(pixels);
+    for (int i = 0; i < 5; i++) {
+        if (matrices[i].data == NULL) status = -1;
+    }
+    if (status != 0 || result->labels == NULL || result->output == NULL) {
+        for (int i = 0; i < 5; i++) free(matrices[i].data);
+        freeQueue(&queue);
+        freeReferenceResult(result);
+        return -1;
+    }
+
+    int hist[256] = {0};
+    for (int h = 0; h < height; h++) {
+        const uint8_t *row = imageRow(gray, h);
+        for (int w = 0; w < width; w++) {
+            AT(matrix, h, w) = row[w];
+            hist[row[w]]++;
+        }
+    }
+    int t = referenceThreshold(hist, width * height);
+    result->threshold = t;
+
+    for (size_t i = 0; i < pixels; i++) matrix->data[i] = matrix->data[i] < t ? 0 : 255;
+    erode(matrix, visited, copy);
+    dilate(matrix, visited, copy);
+
+    memcpy(originalMatrix->data, matrix->data, pixels * sizeof(int));
+    memcpy(originalVisited->data, visited->data, pixels * sizeof(int));
+
+    // Primeiro Flood Fill: contagem das componentes, registrando o número de cada uma.
+    int connectedComps = 0;
+    for (int h = 0; h < height; h++) {
+        for (int w = 0; w < width; w++) {
+            if (AT(matrix, h, w) == 255 && !AT(visited, h, w)) {
+                connectedComps++;
+                floodFill(matrix, h, w, visited, 80, &queue, result->labels, (uint32_t) connectedComps);
+            }
+        }
+    }
+    result->components = connectedComps;
+
+    // Segundo Flood Fill: pintura, com a distribuição de cores original.
+    int targetColor = 40;
+    int rate = (255 - 40) / (connectedComps > 0 ? connectedComps : 1);
+    for (int h = 0; h < height; h++) {
+        for (int w = 0; w < width; w++) {
+            if (AT(originalMatrix, h, w) == 255 && !AT(originalVisited, h, w)) {
+                if (targetColor >= 255) targetColor = 40;
+                targetColor += rate;
+                floodFill(originalMatrix, h, w, originalVisited, targetColor, &queue, NULL, 0);
+            }
+        }
+    }
+    result->targetColor = targetColor;
+    for (size_t i = 0; i < pixels; i++) result->output[i] = (uint8_t) originalMatrix->data[i];
+
+    for (int i = 0; i < 5; i++) free(matrices[i].data);
+    freeQueue(&queue);
+    return 0;
+}
+
+void freeReferenceResult (ReferenceResult *result) {
+    free(result->labels);
+    free(result->output);
+    result->labels = NULL;
+    result->output = NULL;
+}
@@ -0,0 +1,36 @@
+/*
+ * Arquivo: reference.h
+ *
+ * Descrição: Implementação de referência do algoritmo original (Otsu em ponto flutuante, erosão e dilatação pixel a
+ * pixel sobre matrizes de inteiros, e Flood Fill executado duas vezes), generalizada apenas para imagens de qualquer
+ * resolução. É lenta de propósito: serve para conferir, em golden.c, que as versões otimizadas produzem exatamente os
+ * mesmos rótulos, contagens e imagem de saída.
+*/
+
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <stdint.h>
+
+#include "image.h"
+
+typedef struct ReferenceResult {
+    int width, height;
+    int threshold;          // Limiar de Otsu.
+    int components;         // Quantidade de componentes conexas (0 se não houver nenhuma).
+    int targetColor;        // Cor da última componente pintada.
+    uint32_t *labels;       // Número de cada componente, na ordem em que o Flood Fill a encontra (0 para o fundo).
+    uint8_t *output;        // Imagem pintada, linha após linha, sem espaço entre as linhas.
+} ReferenceResult;
+
+/** @brief A função referenceAlgorithm executa o algoritmo original sobre uma imagem em tons de cinza.
+  * @param *result Resultado retornado por referência. Deve ser liberado com freeReferenceResult.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int referenceAlgorithm (const Image *gray, ReferenceResult *result);
+
+/** @brief A função freeReferenceResult libera os buffers de um resultado.
+  */
+void freeReferenceResult (ReferenceResult *result);
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * Arquivo: runs.c
+ *
+ * Descrição: Sequências de pixels, sua rotulação e o formato RLE (ver runs.h).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "label.h"
+#include "runs.h"
+
+#define RLE_MAGIC "SEMB-RLE 1"
+#define RLE_BUFFER 4096 // Bytes acumulados por writeRLE antes de cada fwrite.
+
+/*---------------------------------------------INIT BUFFERS---------------------------------------------*/
+
+/** @brief reserveRuns garante que runs e parent comportem count sequências, crescendo geometricamente.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+static int reserveRuns (RunImage *runs, size_t count) {
+    if (count <= runs->capacity) return 0;
+    size_t capacity = runs->capacity > 0 ? runs->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    Run *grown = (Run*) realloc(runs->runs, capacity * sizeof(Run));
+    if (grown == NULL) return -1;
+    runs->runs = grown;
+    uint32_t *parent = (uint32_t*) realloc(runs->parent, capacity * sizeof(uint32_t));
+    if (parent == NULL) return -1;
+    runs->parent = parent;
+    runs->capacity = capacity;
+    return 0;
+}
+
+/** @brief reserveRows garante que rows comporte imagens de height linhas.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+static int reserveRows (RunImage *runs, int height) {
+    if (height <= runs->rowCapacity) return 0;
+    size_t *rows = (size_t*) realloc(runs->rows, ((size_t) height + 1) * sizeof(size_t));
+    if (rows == NULL) return -1;
+    runs->rows = rows;
+    runs->rowCapacity = height;
+    return 0;
+}
+
+int createRunImage (RunImage *runs, int width, int height) {
+    memset(runs, 0, sizeof(RunImage));
+    if (width <= 0 || height <= 0) return -1;
+    // Capacidade inicial para uma sequência a cada 16 pixels; imagens mais fragmentadas fazem os vetores crescerem.
+    size_t initial = (size_t) width * (size_t) height / 16 + 1;
+    if (reserveRows(runs, height) != 0 || reserveRuns(runs, initial) != 0) {
+        freeRunImage(runs);
+        return -1;
+    }
+    return 0;
+}
+
+void freeRunImage (RunImage *runs) {
+    free(runs->runs);
+    free(runs->rows);
+    free(runs->parent);
+    free(runs->stats);
+    memset(runs, 0, sizeof(RunImage));
+}
+
+/*----------------------------------------------END BUFFERS----------------------------------------------*/
+
+/*--------------------------------------------INIT SEQUÊNCIAS--------------------------------------------*/
+
+/** @brief pushRun acrescenta uma sequência, ainda sem rótulo.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+static inline int pushRun (RunImage *runs, int x, int end) {
+    if (runs->count == runs->capacity && reserveRuns(runs, runs->count + 1) != 0) return -1;
+    Run *run = &runs->runs[runs->count++];
+    run->x = x;
+    run->length = end - x;
+    run->label = 0;
+    return 0;
+}
+
+int extractRuns (const Bitplane *mask, RunImage *runs) {
+    runs->width = mask->width;
+    runs->height = mask->height;
+    runs->count = 0;
+    runs->components = 0;
+    if (reserveRows(runs, mask->height) != 0) return -1;
+
+    for (int h = 0; h < mask->height; h++) {
+        const uint64_t *row = bitplaneRow(mask, h);
+        runs->rows[h] = runs->count;
+        int start = -1;     // Início da sequência aberta, ou -1 se não houver.
+        for (int i = 0; i < mask->words; i++) {
+            uint64_t ones = row[i];
+            if (ones == 0 && start < 0) continue;
+            if (ones == UINT64_MAX && start >= 0) continue;
+            // Alterna entre procurar o próximo 1 (início) e o próximo 0 (fim) a partir do bit b.
+            uint64_t from = UINT64_MAX;
+            for (;;) {
+                uint64_t bits = start < 0 ? ones & from : ~ones & from;
+                if (bits == 0) break;
+                int b = __builtin_ctzll(bits);
+                if (start < 0) {
+                    start = i * 64 + b;
+                } else {
+                    if (pushRun(runs, start, i * 64 + b) != 0) return -1;
+                    start = -1;
+                }
+                from = UINT64_MAX << b;
+            }
+        }
+        // Os bits após a largura são 0, então só continua aberta uma sequência que termina na borda.
+        if (start >= 0 && pushRun(runs, start, mask->width) != 0) return -1;
+    }
+    runs->rows[mask->height] = runs->count;
+    return 0;
+}
+
+/*---------------------------------------------END SEQUÊNCIAS---------------------------------------------*/
+
+/*--------------------------------------------INIT ROTULAÇÃO--------------------------------------------*/
+
+/** @brief findRoot retorna o representante de uma sequência, encurtando o caminho percorrido (path halving).
+  */
+static inline uint32_t findRoot (uint32_t *parent, uint32_t r) {
+    while (parent[r] != r) {
+        parent[r] = parent[parent[r]];
+        r = parent[r];
+    }
+    return r;
+}
+
+/** @brief unite une as classes de duas sequências, mantendo o menor representante (a primeira sequência da
+  * componente na varredura).
+  */
+static inline void unite (uint32_t *parent, uint32_t a, uint32_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+/** @brief addRunStats acumula uma sequência nas estatísticas de uma componente, com as somas em forma fechada. Cada
+  * sequência expõe suas duas pontas e, em princípio, o topo e a base de todos os seus pixels; as arestas em comum com
+  * as sequências vizinhas são descontadas por labelRuns.
+  */
+static inline void addRunStats (ComponentStats *stats, int y, const Run *run) {
+    uint64_t x = (uint64_t) run->x;
+    uint64_t n = (uint64_t) run->length;
+    uint64_t uy = (uint64_t) y;
+    // Somas de x e de x^2 para x de run->x a run->x + n - 1.
+    uint64_t sumX = n * x + n * (n - 1) / 2;
+    uint64_t sumXX = n * x * x + x * n * (n - 1) + (n - 1) * n * (2 * n - 1) / 6;
+    stats->area += n;
+    if (run->x < stats->minX) stats->minX = run->x;
+    if (run->x + run->length - 1 > stats->maxX) stats->maxX = run->x + run->length - 1;
+    if (y < stats->minY) stats->minY = y;
+    if (y > stats->maxY) stats->maxY = y;
+    stats->perimeter += 2 + 2 * n;
+    stats->sumX += sumX;
+    stats->sumY += n * uy;
+    stats->sumXX += sumXX;
+    stats->sumYY += n * uy * uy;
+    stats->sumXY += uy * sumX;
+}
+
+int labelRuns (RunImage *runs, int connectivity, ComponentStats **stats) {
+    if (connectivity != CONNECTIVITY_4 && connectivity != CONNECTIVITY_8) return -1;
+    // Com 8-conectividade, sequências que terminam na coluna anterior ao início da outra também se tocam.
+    int reach = connectivity == CONNECTIVITY_8 ? 1 : 0;
+    Run *list = runs->runs;
+    uint32_t *parent = runs->parent;
+    for (size_t i = 0; i < runs->count; i++) parent[i] = (uint32_t) i;
+
+    // As sequências de cada linha são comparadas com as da linha anterior, avançando sempre a que termina antes.
+    for (int h = 1; h < runs->height; h++) {
+        size_t i = runs->rows[h - 1], above = runs->rows[h];
+        size_t j = runs->rows[h], end = runs->rows[h + 1];
+        while (i < above && j < end) {
+            int aEnd = list[i].x + list[i].length;
+            int bEnd = list[j].x + list[j].length;
+            if (list[i].x < bEnd + reach && list[j].x < aEnd + reach) unite(parent, (uint32_t) i, (uint32_t) j);
+            if (aEnd < bEnd) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+    }
+
+    // O representante de cada componente é sua primeira sequência, então os rótulos seguem a ordem da varredura.
+    uint32_t count = 0;
+    for (size_t i = 0; i < runs->count; i++) {
+        uint32_t root = findRoot(parent, (uint32_t) i);
+        list[i].label = root == i ? ++count : list[root].label;
+    }
+    runs->components = (int) count;
+    if (stats == NULL) return (int) count;
+
+    if ((size_t) count + 1 > runs->statsCapacity) {
+        size_t capacity = runs->statsCapacity > 0 ? runs->statsCapacity : 64;
+        while (capacity < (size_t) count + 1) capacity *= 2;
+        ComponentStats *grown = (ComponentStats*) realloc(runs->stats, capacity * sizeof(ComponentStats));
+        if (grown == NULL) return -1;
+        runs->stats = grown;
+        runs->statsCapacity = capacity;
+    }
+    ComponentStats *accumulated = runs->stats;
+    for (uint32_t k = 0; k <= count; k++) resetComponentStats(&accumulated[k]);
+    for (int h = 0; h < runs->height; h++) {
+        for (size_t i = runs->rows[h]; i < runs->rows[h + 1]; i++) addRunStats(&accumulated[list[i].label], h, &list[i]);
+        if (h == 0) continue;
+        // Colunas em comum com a linha anterior: cada uma é uma aresta interna, contada como topo e como base.
+        size_t i = runs->rows[h - 1], above = runs->rows[h];
+        size_t j = runs->rows[h], end = runs->rows[h + 1];
+        while (i < above && j < end) {
+            int aEnd = list[i].x + list[i].length;
+            int bEnd = list[j].x + list[j].length;
+            int shared = (aEnd < bEnd ? aEnd : bEnd) - (list[i].x > list[j].x ? list[i].x : list[j].x);
+            if (shared > 0) accumulated[list[j].label].perimeter -= 2 * (uint64_t) shared;
+            if (aEnd < bEnd) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+    }
+    *stats = accumulated;
+    return (int) count;
+}
+
+void paintRuns (const RunImage *runs, const uint8_t *colors, Image *output) {
+    for (int h = 0; h < runs->height; h++) {
+        uint8_t *out = imageRow(output, h);
+        memset(out, colors[0], (size_t) runs->width);
+        for (size_t i = runs->rows[h]; i < runs->rows[h + 1]; i++) {
+            memset(out + runs->runs[i].x, colors[runs->runs[i].label], (size_t) runs->runs[i].length);
+        }
+    }
+}
+
+/*---------------------------------------------END ROTULAÇÃO---------------------------------------------*/
+
+/*-----------------------------------------------INIT RLE-----------------------------------------------*/
+
+/** @brief varintSize retorna a quantidade de bytes de um número em LEB128.
+  */
+static inline size_t varintSize (uint64_t value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+/** @brief putVarint codifica um número em LEB128 em out e retorna a quantidade de bytes escritos.
+  */
+static inline size_t putVarint (uint8_t *out, uint64_t value) {
+    size_t bytes = 0;
+    while (value >= 0x80) {
+        out[bytes++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    out[bytes++] = (uint8_t) value;
+    return bytes;
+}
+
+/** @brief getVarint lê um número em LEB128 de até 32 bits.
+  * @return Retorna 0 em caso de sucesso, -1 no fim do arquivo ou se o número não couber em 32 bits.
+  */
+static int getVarint (FILE *file, uint32_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = getc(file);
+        if (c == EOF) return -1;
+        result |= (uint64_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            if (result > UINT32_MAX) return -1;
+            *value = (uint32_t) result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/** @brief rleHeader escreve o cabeçalho do formato RLE em buffer e retorna seu tamanho.
+  */
+static int rleHeader (const RunImage *runs, char *buffer, size_t size) {
+    return snprintf(buffer, size, RLE_MAGIC "\n%d %d %d %zu\n", runs->width, runs->height, runs->components,
+                    runs->count);
+}
+
+size_t rleSize (const RunImage *runs) {
+    char header[128];
+    size_t bytes = (size_t) rleHeader(runs, header, sizeof(header));
+    for (int h = 0; h < runs->height; h++) {
+        bytes += varintSize(runs->rows[h + 1] - runs->rows[h]);
+        int previous = 0;
+        for (size_t i = runs->rows[h]; i < runs->rows[h + 1]; i++) {
+            const Run *run = &runs->runs[i];
+            bytes += varintSize((uint64_t) (run->x - previous)) + varintSize((uint64_t) run->length) +
+                     varintSize(run->label);
+            previous = run->x + run->length;
+        }
+    }
+    return bytes;
+}
+
+int writeRLE (FILE *file, const RunImage *runs) {
+    char header[128];
+    int length = rleHeader(runs, header, sizeof(header));
+    if (fwrite(header, 1, (size_t) length, file) != (size_t) length) return -1;
+
+    // Cada número ocupa no máximo 10 bytes; o buffer é esvaziado antes que uma linha ou sequência possa excedê-lo.
+    uint8_t buffer[RLE_BUFFER];
+    size_t used = 0;
+    for (int h = 0; h < runs->height; h++) {
+        if (used > RLE_BUFFER - 10) {
+            if (fwrite(buffer, 1, used, file) != used) return -1;
+            used = 0;
+        }
+        used += putVarint(buffer + used, runs->rows[h + 1] - runs->rows[h]);
+        int previous = 0;
+        for (size_t i = runs->rows[h]; i < runs->rows[h + 1]; i++) {
+            const Run *run = &runs->runs[i];
+            if (used > RLE_BUFFER - 30) {
+                if (fwrite(buffer, 1, used, file) != used) return -1;
+                used = 0;
+            }
+            used += putVarint(buffer + used, (uint64_t) (run->x - previous));
+            used += putVarint(buffer + used, (uint64_t) run->length);
+            used += putVarint(buffer + used, run->label);
+            previous = run->x + run->length;
+        }
+    }
+    if (used > 0 && fwrite(buffer, 1, used, file) != used) return -1;
+    return 0;
+}
+
+int readRLE (FILE *file, RunImage *runs) {
+    char magic[16];
+    int width, height, components;
+    size_t count;
+    if (fscanf(file, "%15[^\n]", magic) != 1 || strcmp(magic, RLE_MAGIC) != 0 ||
+        fscanf(file, "%d %d %d %zu", &width, &height, &components, &count) != 4) {
+        return -1;
+    }
+    int separator = getc(file);
+    if (width <= 0 || height <= 0 || components < 0 || separator == EOF || !(separator == ' ' || separator == '\n' ||
+        separator == '\r' || separator == '\t')) {
+        return -1;
+    }
+    // Cada sequência tem ao menos um pixel e é separada da seguinte por ao menos um pixel de fundo.
+    if (count > ((size_t) width + 1) / 2 * (size_t) height || (size_t) components > count) return -1;
+    runs->width = width;
+    runs->height = height;
+    runs->components = components;
+    runs->count = 0;
+
+    // Os vetores crescem à medida que o arquivo é lido, e não pelo cabeçalho: um arquivo truncado ou corrompido
+    // não provoca uma alocação maior que o seu conteúdo.
+    for (int h = 0; h < height; h++) {
+        uint32_t inRow;
+        if (getVarint(file, &inRow) != 0 || inRow > count - runs->count) return -1;
+        if (h >= runs->rowCapacity) {
+            int grow = h > 256 ? h : 256;
+            if (reserveRows(runs, grow < height - h ? h + grow : height) != 0) return -1;
+        }
+        runs->rows[h] = runs->count;
+        int previous = 0;
+        for (uint32_t k = 0; k < inRow; k++) {
+            uint32_t gap, length, label;
+            if (getVarint(file, &gap) != 0 || getVarint(file, &length) != 0 || getVarint(file, &label) != 0) return -1;
+            if ((k > 0 && gap == 0) || length == 0 || gap > (uint32_t) (width - previous) ||
+                length > (uint32_t) (width - previous) - gap || label == 0 || label > (uint32_t) components) {
+                return -1;
+            }
+            if (runs->count == runs->capacity && reserveRuns(runs, runs->count + 1) != 0) return -1;
+            Run *run = &runs->runs[runs->count++];
+            run->x = previous + (int) gap;
+            run->length = (int) length;
+            run->label = label;
+            previous = run->x + run->length;
+        }
+    }
+    runs->rows[height] = runs->count;
+    return runs->count == count ? 0 : -1;
+}
+
+/*------------------------------------------------END RLE------------------------------------------------*/
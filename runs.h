@@ -0,0 +1,105 @@
+/*
+ * Arquivo: runs.h
+ *
+ * Descrição: Representação de uma imagem binária por sequências horizontais de pixels de foreground (runs), rotulação
+ * das componentes conexas pela união das sequências que se tocam em linhas vizinhas, e exportação das componentes no
+ * formato RLE. O trabalho e o tamanho do resultado são proporcionais à quantidade de sequências, e não à de pixels, o
+ * que favorece imagens esparsas (poucos objetos sobre um fundo grande).
+ *
+ * Formato RLE: um cabeçalho em texto, como o do PGM,
+ *     SEMB-RLE 1
+ *     largura altura componentes sequencias
+ * seguido de um único caractere de espaço (em geral, '\n') e, para cada linha da imagem, em ordem, a quantidade de
+ * sequências da linha e, para cada sequência, em ordem de coluna, a distância entre o fim da anterior (ou a coluna 0) e
+ * o seu início, o seu comprimento e o seu rótulo. Todos esses números são inteiros sem sinal codificados em LEB128 (7
+ * bits por byte, do menos significativo para o mais, com o bit 7 indicando que há mais bytes). Os rótulos vão de 1 a
+ * componentes, na ordem em que as componentes aparecem na varredura, como em labelComponents.
+*/
+
+#ifndef RUNS_H
+#define RUNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "components.h"
+#include "image.h"
+
+/*
+ * Uma sequência de pixels de foreground consecutivos de uma linha, cercada por fundo (ou pelas bordas da imagem).
+*/
+typedef struct Run {
+    int x;              // Primeira coluna.
+    int length;         // Quantidade de pixels.
+    uint32_t label;     // Rótulo da componente, ou 0 antes da rotulação.
+} Run;
+
+/*
+ * Imagem binária como sequências, em ordem de linha e coluna. Os vetores crescem geometricamente, de forma que, após as
+ * primeiras imagens, nenhuma alocação é feita. Um RunImage zerado (por exemplo, com memset) é válido e vazio.
+*/
+typedef struct RunImage {
+    int width;              // Largura da imagem, em pixels.
+    int height;             // Altura da imagem, em pixels.
+    size_t count;           // Quantidade de sequências.
+    Run *runs;              // Sequências. As da linha h são runs[rows[h]] a runs[rows[h + 1] - 1].
+    size_t *rows;           // Início das sequências de cada linha, com height + 1 posições.
+    int components;         // Quantidade de componentes, após labelRuns ou readRLE.
+    size_t capacity;        // Posições alocadas em runs e parent.
+    int rowCapacity;        // Linhas comportadas por rows.
+    uint32_t *parent;       // Tabela de equivalências entre sequências (uso interno de labelRuns).
+    ComponentStats *stats;  // Estatísticas por rótulo (ver labelRuns).
+    size_t statsCapacity;   // Posições alocadas em stats.
+} RunImage;
+
+/** @brief A função createRunImage aloca os vetores de um RunImage para imagens de width x height pixels.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int createRunImage (RunImage *runs, int width, int height);
+
+/** @brief A função freeRunImage libera os vetores de um RunImage.
+  */
+void freeRunImage (RunImage *runs);
+
+/** @brief A função extractRuns converte uma imagem binária em sequências, sem rótulos. Palavras sem nenhum pixel de
+  * foreground são descartadas com uma única comparação, e as bordas das sequências são encontradas bit a bit apenas
+  * dentro das palavras que as contêm.
+  * @return Retorna 0 em caso de sucesso, -1 caso falte memória.
+  */
+int extractRuns (const Bitplane *mask, RunImage *runs);
+
+/** @brief A função labelRuns rotula as componentes conexas das sequências: duas sequências de linhas vizinhas
+  * pertencem à mesma componente se têm colunas em comum (CONNECTIVITY_4) ou se têm colunas em comum ou vizinhas
+  * (CONNECTIVITY_8). Os rótulos vão de 1 a N, na ordem da varredura, e são os mesmos de labelComponents sobre a imagem
+  * binária.
+  * @param connectivity CONNECTIVITY_4 ou CONNECTIVITY_8.
+  * @param **stats Se não for NULL, as estatísticas das componentes (as mesmas de labelComponents) são calculadas a
+  *        partir das sequências, sem percorrer os pixels, e *stats passa a apontar para um vetor (pertencente a runs,
+  *        válido até a próxima chamada) indexado pelo rótulo, com N + 1 posições.
+  * @return Retorna a quantidade N de componentes conexas, ou -1 caso os parâmetros sejam inválidos ou falte memória.
+  */
+int labelRuns (RunImage *runs, int connectivity, ComponentStats **stats);
+
+/** @brief A função paintRuns pinta as sequências com a cor de seu rótulo (ver componentColors) e o fundo com colors[0].
+  * @param *output Imagem com as dimensões das sequências.
+  */
+void paintRuns (const RunImage *runs, const uint8_t *colors, Image *output);
+
+/** @brief A função rleSize retorna a quantidade de bytes que writeRLE escreve para as sequências.
+  */
+size_t rleSize (const RunImage *runs);
+
+/** @brief A função writeRLE escreve sequências rotuladas no formato RLE (ver o início deste arquivo).
+  * @return Retorna 0 em caso de sucesso, -1 em caso de erro de escrita.
+  */
+int writeRLE (FILE *file, const RunImage *runs);
+
+/** @brief A função readRLE lê sequências rotuladas no formato RLE, sem gerar a imagem binária. Os rótulos e a
+  * quantidade de componentes são os do arquivo; as estatísticas podem ser recalculadas com labelRuns.
+  * @param *runs RunImage criado por createRunImage (ou zerado), reaproveitado.
+  * @return Retorna 0 em caso de sucesso, -1 caso o arquivo seja inválido ou falte memória.
+  */
+int readRLE (FILE *file, RunImage *runs);
+
+#endif
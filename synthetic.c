@@ -0,0 +1,52 @@
+/*
+ * Arquivo: synthetic.c
+ *
+ * Descrição: Implementação da geração de imagens sintéticas (ver synthetic.h).
+*/
+
+#include <stdint.h>
+
+#include "synthetic.h"
+
+uint32_t nextRandom (uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void fillSynthetic (Image *image, uint32_t seed) {
+    int width = image->width;
+    int height = image->height;
+    uint32_t state = seed != 0 ? seed : 1;
+
+    // Fundo escuro em degradê, com ruído de até 48 níveis: alguns pixels isolados passam do limiar.
+    for (int h = 0; h < height; h++) {
+        uint8_t *row = imageRow(image, h);
+        for (int w = 0; w < width; w++) {
+            int base = 30 + (int) ((int64_t) 50 * (w + h) / (width + height));
+            row[w] = (uint8_t) (base + (int) (nextRandom(&state) % 48));
+        }
+    }
+
+    // Um disco claro para cada 3000 pixels, com raio entre 1 e 1/16 da menor dimensão.
+    int minSide = width < height ? width : height;
+    int maxRadius = minSide / 16 > 1 ? minSide / 16 : 1;
+    long disks = (long) width * height / 3000 + 1;
+    for (long d = 0; d < disks; d++) {
+        int cx = (int) (nextRandom(&state) % (uint32_t) width);
+        int cy = (int) (nextRandom(&state) % (uint32_t) height);
+        int r = 1 + (int) (nextRandom(&state) % (uint32_t) maxRadius);
+        int level = 170 + (int) (nextRandom(&state) % 80);
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y < 0 || y >= height) continue;
+            uint8_t *row = imageRow(image, y);
+            for (int x = cx - r; x <= cx + r; x++) {
+                if (x < 0 || x >= width || (x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r) continue;
+                row[x] = (uint8_t) (level + (int) (nextRandom(&state) % 6));
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ * Arquivo: synthetic.h
+ *
+ * Descrição: Geração de imagens sintéticas, determinísticas, para o benchmark e a verificação de saída (bench.c e
+ * golden.c): um fundo em degradê com ruído e discos claros de tamanhos variados, de forma que a limiarização, a
+ * morfologia e a rotulação encontrem componentes grandes, pequenas e pixels isolados em qualquer resolução.
+*/
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <stdint.h>
+
+#include "image.h"
+
+/** @brief A função nextRandom é um gerador xorshift de 32 bits, suficiente para gerar cenas reprodutíveis.
+  * @param *state Estado do gerador, diferente de 0, atualizado a cada chamada.
+  * @return Retorna o próximo valor da sequência.
+  */
+uint32_t nextRandom (uint32_t *state);
+
+/** @brief A função fillSynthetic preenche uma imagem já criada com uma cena sintética. A mesma semente gera sempre a
+  * mesma imagem.
+  */
+void fillSynthetic (Image *image, uint32_t seed);
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * Arquivo: threshold.c
+ *
+ * Descrição: Implementação dos métodos de limiarização (ver threshold.h).
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "threshold.h"
+
+ThresholdConfig defaultThresholdConfig (int method) {
+    ThresholdConfig config;
+    config.method = method;
+    config.classes = 3;
+    config.radius = 15;
+    config.k = method == THRESHOLD_SAUVOLA ? 0.34 : 0.15;
+    config.sampling = 1;
+    return config;
+}
+
+int validThresholdConfig (const ThresholdConfig *config) {
+    if (config->sampling < 1 || config->sampling > THRESHOLD_MAX_SAMPLING) return 0;
+    switch (config->method) {
+        case THRESHOLD_OTSU:
+            return 1;
+        case THRESHOLD_MULTI:
+            return config->classes >= 2 && config->classes <= THRESHOLD_MAX_CLASSES;
+        case THRESHOLD_BRADLEY:
+        case THRESHOLD_SAUVOLA:
+            return config->radius >= 1 && config->radius <= THRESHOLD_MAX_RADIUS && config->k >= 0 && config->k <= 1;
+        default:
+            return 0;
+    }
+}
+
+/*-----------------------------------------INIT OTSU THRESHOLD-----------------------------------------*/
+
+/*
+ * A variância entre as classes C1 (níveis 0 a i) e C2 (níveis i + 1 a 255) é proporcional a
+ * (n2 * m1 - n1 * m2)^2 / (n1 * n2), sendo n1 e n2 as quantidades de pixels de cada classe e m1 e m2 as somas de suas
+ * intensidades (ver GONZALEZ, Rafael C. WOODS, Richard E. EDDINS, Steven L. Digital Image Processing using MATLAB.
+ * 2a edicao. Gatesmark Publishing. 2009). As somas são acumuladas em inteiros, e apenas a razão final é calculada em
+ * ponto flutuante, sem divisões por zero: divisões com uma classe vazia são ignoradas.
+*/
+
+int Threshold(int *hist, int total){
+    (void) total;
+    int64_t n = 0;      //numero total de pixels
+    int64_t sum = 0;    //soma das intensidades de todos os pixels
+    for (int i = 0; i < 256; i++) {
+        n += hist[i];
+        sum += (int64_t) i * hist[i];
+    }
+
+    // Até 2^27 pixels, n2 * m1 e n1 * m2 (no máximo 255 * n^2) cabem em 64 bits, e a diferença é exata.
+    int exact = n < ((int64_t) 1 << 27);
+    int64_t n1 = 0, m1 = 0;
+    double maxVar = 0;  //armazena a maior variância
+    int threshold = 0;  //valor para o qual as classes C1 e C2 possuem variância máxima
+    for (int i = 0; i < 255; i++) {
+        n1 += hist[i];
+        m1 += (int64_t) i * hist[i];
+        int64_t n2 = n - n1;
+        int64_t m2 = sum - m1;
+        if (n1 == 0 || n2 == 0) continue;
+        double diff = exact ? (double) (n2 * m1 - n1 * m2) : (double) n2 * (double) m1 - (double) n1 * (double) m2;
+        double var = diff * diff / ((double) n1 * (double) n2);
+        if (var > maxVar) {
+            maxVar = var;
+            threshold = i;
+        }
+    }
+    return threshold;
+}
+
+int multiThreshold (const int *hist, int classes, int *thresholds) {
+    if (classes < 2 || classes > THRESHOLD_MAX_CLASSES) return -1;
+
+    // count[i] e sum[i]: quantidade de pixels e soma das intensidades dos níveis 0 a i - 1.
+    int64_t count[257], sum[257];
+    count[0] = sum[0] = 0;
+    for (int i = 0; i < 256; i++) {
+        count[i + 1] = count[i] + hist[i];
+        sum[i + 1] = sum[i] + (int64_t) i * hist[i];
+    }
+
+    // Maximizar a variância entre as classes equivale a maximizar a soma, sobre as classes, de (soma)^2 / quantidade.
+    // best[j][i] é o maior valor dessa soma dividindo os níveis 0 a i - 1 em j + 1 classes, e split[j][i] é o
+    // primeiro nível da última delas.
+    static const int levels = 256;
+    double best[THRESHOLD_MAX_CLASSES][257];
+    int16_t split[THRESHOLD_MAX_CLASSES][257];
+    for (int i = 1; i <= levels; i++) {
+        best[0][i] = count[i] > 0 ? (double) sum[i] * (double) sum[i] / (double) count[i] : 0;
+        split[0][i] = 0;
+    }
+    for (int j = 1; j < classes; j++) {
+        for (int i = j + 1; i <= levels; i++) {
+            best[j][i] = -1;
+            for (int p = j; p < i; p++) {
+                int64_t n = count[i] - count[p];
+                double s = (double) (sum[i] - sum[p]);
+                double value = best[j - 1][p] + (n > 0 ? s * s / (double) n : 0);
+                if (value > best[j][i]) {
+                    best[j][i] = value;
+                    split[j][i] = (int16_t) p;
+                }
+            }
+        }
+    }
+
+    // Cada limiar é o maior nível de sua classe, ou seja, o primeiro nível da classe seguinte menos 1.
+    int end = levels;
+    for (int j = classes - 1; j > 0; j--) {
+        end = split[j][end];
+        thresholds[j - 1] = end - 1;
+    }
+    return 0;
+}
+
+int globalThreshold (int *hist, const ThresholdConfig *config) {
+    if (!validThresholdConfig(config) || isLocalThreshold(config->method)) return -1;
+    if (config->method == THRESHOLD_MULTI) {
+        int thresholds[THRESHOLD_MAX_CLASSES - 1];
+        multiThreshold(hist, config->classes, thresholds);
+        return thresholds[config->classes - 2];
+    }
+    int total = 0;
+    for (int i = 0; i < 256; i++) total += hist[i];
+    return Threshold(hist, total);
+}
+
+/*-----------------------------------------END OTSU THRESHOLD-----------------------------------------*/
+
+/*-----------------------------------------INIT LIMIAR LOCAL------------------------------------------*/
+
+/*
+ * As somas de cada coluna sobre as linhas da janela (das intensidades e de seus quadrados) são atualizadas a cada linha,
+ * somando a linha que entra e subtraindo a que sai; as somas de uma janela são então diferenças de somas acumuladas
+ * dessas colunas. Todas as somas são de 32 bits sem sinal: as acumuladas podem dar a volta, mas a diferença entre duas
+ * delas, que é a soma de uma janela com no máximo 255^2 * 255^2 < 2^32, é exata.
+*/
+
+size_t localThresholdWords (int width) {
+    // Somas das colunas e suas somas acumuladas ao longo da linha, das intensidades e de seus quadrados, e uma linha de
+    // bytes (0 ou 1) com o resultado de cada pixel, completada até um múltiplo de 64.
+    return 4 * ((size_t) width + 1) + ((size_t) width + 63) / 64 * 16;
+}
+
+/** @brief addWindowRow soma (sign = 1) ou subtrai (sign = -1) uma linha das somas das colunas (e, se colSquares não
+  * for NULL, das somas dos quadrados).
+  */
+static void addWindowRow (const uint8_t *row, int width, uint32_t sign, uint32_t *colSum, uint32_t *colSquares) {
+    if (colSquares == NULL) {
+        for (int w = 0; w < width; w++) colSum[w] += sign * row[w];
+        return;
+    }
+    for (int w = 0; w < width; w++) {
+        uint32_t p = row[w];
+        colSum[w] += sign * p;
+        colSquares[w] += sign * p * p;
+    }
+}
+
+/*
+ * Sauvola sem divisões nem raiz por pixel: com n pixels na janela, S e Q as somas das intensidades e de seus quadrados,
+ * W = 255 * n - S a soma do negativo e P o negativo do pixel, a condição P <= (W / n) * (1 + k * (s / 128 - 1)), com
+ * s = sqrt(n * Q - S^2) / n, equivale a A <= B * sqrt(n * Q - S^2), sendo A = P * n - W * (1 - k) e
+ * B = W * k / (128 * n) >= 0. Ela vale se A <= 0 e, caso contrário, se A^2 * (128 * n)^2 <= (W * k)^2 * (n * Q - S^2).
+*/
+
+typedef struct LocalRow {
+    const uint8_t *pixels;
+    const uint32_t *sum;        // Somas acumuladas das colunas (sum[w] é a soma das colunas 0 a w - 1).
+    const uint32_t *squares;    // Idem, dos quadrados (apenas no método de Sauvola).
+    uint8_t *flags;             // Resultado de cada pixel: 1 se for foreground.
+    int rows;                   // Linhas da janela.
+    double keep;                // Bradley: 1 - k, em ponto fixo (16 bits de fração).
+    float kFloat;               // Sauvola: k e 1 - k.
+    float keepFloat;
+} LocalRow;
+
+/** @brief localSpan calcula os pixels first a last - 1 de uma linha, com as janelas entre as colunas
+  * w - radius e w + radius, cortadas em 0 e width. O método e clip (0 se nenhuma janela do trecho é cortada) são
+  * parâmetros constantes, de forma que cada chamada é especializada pelo compilador, e o meio da linha é vetorizado.
+  */
+static inline void localSpan (const LocalRow *row, int sauvola, int clip, int first, int last, int radius,
+                              int width) {
+    // Campos copiados para variáveis locais: as escritas em flags (bytes) poderiam alterá-los, o que impediria a
+    // vetorização.
+    const uint8_t *pixels = row->pixels;
+    const uint32_t *sum = row->sum;
+    const uint32_t *squares = row->squares;
+    uint8_t *flags = row->flags;
+    int rows = row->rows;
+    double keep = row->keep;
+    float k = row->kFloat;
+    float keepFloat = row->keepFloat;
+    for (int w = first; w < last; w++) {
+        int left = w - radius;
+        int right = w + radius + 1;
+        if (clip) {
+            left = left > 0 ? left : 0;
+            right = right < width ? right : width;
+        }
+        // Todas as somas de uma janela cabem em 32 bits (ver THRESHOLD_MAX_RADIUS).
+        int32_t n = rows * (right - left);
+        int32_t s = (int32_t) (sum[right] - sum[left]);
+        // Negativos do pixel e da soma da janela (ver localThresholdRows).
+        int32_t pixel = 255 - pixels[w];
+        int32_t window = 255 * n - s;
+        if (!sauvola) {
+            // Os dois produtos são inteiros menores que 2^53, exatos em double: o resultado é o da comparação inteira,
+            // mas o laço pode ser vetorizado.
+            flags[w] = (uint8_t) ((double) (pixel * n) * 65536.0 <= (double) window * keep);
+        } else {
+            // Em float (os maiores valores, perto de 10^29, cabem), como a versão com raiz. A variância (vezes n^2) é
+            // calculada em inteiros, pois a diferença de dois valores próximos em float perderia todos os dígitos em
+            // janelas quase uniformes; apenas o resultado, nunca negativo, é convertido.
+            uint32_t q = squares[right] - squares[left];
+            float a = (float) (pixel * n) - (float) window * keepFloat;
+            float limit = (float) window * k;
+            float spread = 128.0f * (float) n;
+            float variance = (float) ((int64_t) n * q - (int64_t) s * s);
+            flags[w] = (uint8_t) ((a <= 0) | (a * a * spread * spread <= limit * limit * variance));
+        }
+    }
+}
+
+/** @brief localRow calcula uma linha inteira: as bordas, onde as janelas são cortadas, e o meio.
+  */
+static void localRow (const LocalRow *row, int sauvola, int radius, int width) {
+    int first = radius < width ? radius : width;
+    int last = width - radius - 1 > first ? width - radius - 1 : first;
+    if (sauvola) {
+        localSpan(row, 1, 1, 0, first, radius, width);
+        localSpan(row, 1, 0, first, last, radius, width);
+        localSpan(row, 1, 1, last, width, radius, width);
+    } else {
+        localSpan(row, 0, 1, 0, first, radius, width);
+        localSpan(row, 0, 0, first, last, radius, width);
+        localSpan(row, 0, 1, last, width, radius, width);
+    }
+}
+
+int localThresholdRows (const Image *gray, const ThresholdConfig *config, Bitplane *mask, int rowStart, int rowEnd,
+                        uint32_t *scratch) {
+    if (!isLocalThreshold(config->method) || !validThresholdConfig(config)) return -1;
+    if (gray->width != mask->width || gray->height != mask->height) return -1;
+    int width = gray->width;
+    int height = gray->height;
+    int radius = config->radius;
+    int sauvola = config->method == THRESHOLD_SAUVOLA;
+    uint32_t *colSum = scratch;
+    uint32_t *colSquares = sauvola ? colSum + width + 1 : NULL;
+    uint32_t *sum = colSum + 2 * ((size_t) width + 1);
+    uint32_t *squares = sum + width + 1;
+    uint8_t *flags = (uint8_t *) (squares + width + 1);
+
+    memset(colSum, 0, 2 * ((size_t) width + 1) * sizeof(uint32_t));
+    memset(flags + width, 0, (size_t) mask->words * 64 - (size_t) width);
+    int top = rowStart - radius > 0 ? rowStart - radius : 0;
+    int bottom = rowStart + radius + 1 < height ? rowStart + radius + 1 : height;
+    for (int h = top; h < bottom; h++) addWindowRow(imageRow(gray, h), width, 1, colSum, colSquares);
+
+    // No método de Bradley, k é usado em ponto fixo (16 bits de fração), e a comparação, feita em double, é exata.
+    LocalRow row = {NULL, sum, squares, flags, 0, (double) (65536 - (int64_t) (config->k * 65536 + 0.5)), (float) config->k,
+                    (float) (1 - config->k)};
+    for (int h = rowStart; h < rowEnd; h++) {
+        if (h > rowStart) {
+            if (h + radius < height) addWindowRow(imageRow(gray, h + radius), width, 1, colSum, colSquares);
+            if (h - radius - 1 >= 0) addWindowRow(imageRow(gray, h - radius - 1), width, (uint32_t) -1, colSum,
+                                                  colSquares);
+        }
+        row.rows = (h + radius + 1 < height ? h + radius + 1 : height) - (h - radius > 0 ? h - radius : 0);
+        row.pixels = imageRow(gray, h);
+        sum[0] = 0;
+        for (int w = 0; w < width; w++) sum[w + 1] = sum[w] + colSum[w];
+        if (sauvola) {
+            squares[0] = 0;
+            for (int w = 0; w < width; w++) squares[w + 1] = squares[w] + colSquares[w];
+        }
+        localRow(&row, sauvola, radius, width);
+
+        // Cada 8 bytes (0 ou 1) são juntados em 8 bits com uma multiplicação, como em thresholdRow.
+        uint64_t *bits = bitplaneRow(mask, h);
+        for (int i = 0; i < mask->words; i++) {
+            uint64_t word = 0;
+            for (int b = 0; b < 8; b++) {
+                uint64_t x;
+                memcpy(&x, flags + i * 64 + b * 8, sizeof(x));
+                word |= ((x * 0x0102040810204080ull) >> 56) << (b * 8);
+            }
+            bits[i] = word;
+        }
+    }
+    return 0;
+}
+
+/*------------------------------------------END LIMIAR LOCAL------------------------------------------*/
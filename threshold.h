@@ -0,0 +1,102 @@
+/*
+ * Arquivo: threshold.h
+ *
+ * Descrição: Cálculo do nível de limiarização de uma imagem. Os métodos globais partem do histograma: o algoritmo de
+ * Otsu, com dois níveis (Threshold) ou com várias classes (multiThreshold), ambos com somas acumuladas inteiras e
+ * resultado definido para qualquer histograma. Os métodos locais (Bradley e Sauvola) comparam cada pixel com a média
+ * (e, no de Sauvola, o desvio padrão) de uma janela ao seu redor, para imagens com iluminação desigual; as somas de cada
+ * janela são atualizadas linha a linha, sem guardar uma imagem integral inteira.
+*/
+
+#ifndef THRESHOLD_H
+#define THRESHOLD_H
+
+#include <stdint.h>
+
+#include "image.h"
+
+// Métodos de limiarização.
+#define THRESHOLD_OTSU      0   // Otsu com dois níveis (o do programa original).
+#define THRESHOLD_MULTI     1   // Otsu com várias classes: o foreground é a classe mais clara.
+#define THRESHOLD_BRADLEY   2   // Local: média da janela.
+#define THRESHOLD_SAUVOLA   3   // Local: média e desvio padrão da janela.
+
+#define THRESHOLD_MAX_CLASSES 8     // Máximo de classes do Otsu multinível.
+#define THRESHOLD_MAX_RADIUS  127   // Maior raio das janelas locais (as somas de uma janela cabem em 32 bits).
+#define THRESHOLD_MAX_SAMPLING 64   // Maior passo da grade do histograma.
+
+typedef struct ThresholdConfig {
+    int method;     // THRESHOLD_OTSU, THRESHOLD_MULTI, THRESHOLD_BRADLEY ou THRESHOLD_SAUVOLA.
+    int classes;    // Classes do Otsu multinível (2 a THRESHOLD_MAX_CLASSES).
+    int radius;     // Raio das janelas locais: cada janela tem (2 * radius + 1)^2 pixels, cortada nas bordas.
+    double k;       // Sensibilidade dos métodos locais, entre 0 e 1.
+    int sampling;   // Métodos globais: o histograma conta apenas as linhas e colunas múltiplas de sampling (1 conta
+                    // todos os pixels; ver sampledHistogramRows), para um limiar aproximado em imagens grandes.
+} ThresholdConfig;
+
+/** @brief A função defaultThresholdConfig retorna a configuração padrão de um método: 3 classes no Otsu multinível,
+  * janelas de 31x31 pixels, k = 0.15 no método de Bradley e k = 0.34 no de Sauvola, e histograma com todos os pixels.
+  */
+ThresholdConfig defaultThresholdConfig (int method);
+
+/** @brief A função validThresholdConfig indica se uma configuração é válida.
+  * @return Retorna 1 se for válida, 0 caso contrário.
+  */
+int validThresholdConfig (const ThresholdConfig *config);
+
+/** @brief A função isLocalThreshold indica se um método é local (e, portanto, não usa o histograma).
+  */
+static inline int isLocalThreshold (int method) {
+    return method == THRESHOLD_BRADLEY || method == THRESHOLD_SAUVOLA;
+}
+
+/** @brief A função Threshold executa o algoritmo de Otsu sobre um histograma,
+ **        e com isso, determina o valor ótimo de limiarização para a imagem.
+ ** @param *hist Ponteiro para array que representa o histograma dos pixels uma imagem
+ ** @param total Quantidade de pixels da imagem (soma de todas as posições do histograma). Mantido por compatibilidade:
+ **        o total é recalculado a partir do histograma.
+ ** @return Retorna o maior nível da classe mais escura (pixels maiores ou iguais a ele formam o foreground), ou 0 se
+ **         o histograma tiver menos de duas cores (nenhuma divisão em duas classes é possível).
+ **/
+int Threshold(int *hist, int total);
+
+/** @brief A função multiThreshold executa o algoritmo de Otsu com várias classes: divide os níveis de cinza em classes
+  * consecutivas de forma a maximizar a variância entre elas, por programação dinâmica sobre as somas acumuladas.
+  * @param *hist Histograma com 256 posições.
+  * @param classes Quantidade de classes (2 a THRESHOLD_MAX_CLASSES).
+  * @param *thresholds classes - 1 limiares, em ordem crescente, retornados por referência. Como em Threshold, cada um é
+  *        o maior nível de sua classe. Com menos cores que classes, as classes que sobram ficam vazias, no topo.
+  * @return Retorna 0 em caso de sucesso, -1 caso a quantidade de classes seja inválida.
+  */
+int multiThreshold (const int *hist, int classes, int *thresholds);
+
+/** @brief A função globalThreshold retorna o limiar global de um método: o de Threshold ou, no Otsu multinível, o
+  * último limiar de multiThreshold (o foreground é a classe mais clara).
+  * @param *hist Histograma com 256 posições.
+  * @return Retorna o limiar, ou -1 se o método for local ou a configuração for inválida.
+  */
+int globalThreshold (int *hist, const ThresholdConfig *config);
+
+/** @brief A função localThresholdWords retorna o tamanho, em palavras de 32 bits, do buffer de trabalho usado por
+  * localThresholdRows para imagens de até width pixels de largura.
+  */
+size_t localThresholdWords (int width);
+
+/** @brief A função localThresholdRows gera as linhas rowStart a rowEnd - 1 da imagem binária por um método local.
+  * Como nos métodos globais, o foreground são os pixels claros: o pixel é comparado com o limiar do método calculado
+  * sobre o negativo da imagem (os métodos de Bradley e Sauvola procuram objetos escuros sobre fundo claro), de forma
+  * que regiões uniformes são fundo.
+  *  - Bradley: foreground se 255 - p <= (255 - m) * (1 - k), sendo m a média da janela;
+  *  - Sauvola: foreground se 255 - p <= (255 - m) * (1 + k * (s / 128 - 1)), sendo s o desvio padrão da janela.
+  * As linhas de uma faixa dependem apenas da imagem em tons de cinza, então faixas diferentes podem ser processadas ao
+  * mesmo tempo, cada uma com seu buffer.
+  * @param *gray Imagem em tons de cinza.
+  * @param *config Configuração, com um método local.
+  * @param *mask Imagem binária, com as mesmas dimensões de gray.
+  * @param *scratch Buffer de trabalho com ao menos localThresholdWords palavras.
+  * @return Retorna 0 em caso de sucesso, -1 caso a configuração seja inválida.
+  */
+int localThresholdRows (const Image *gray, const ThresholdConfig *config, Bitplane *mask, int rowStart, int rowEnd,
+                        uint32_t *scratch);
+
+#endif